@@ -5,21 +5,73 @@ CONFIG += c++14
 DEFINES += QT_DEPRECATED_WARNINGS
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Uncomment to build the 4-lane AVX (or 8-lane AVX-512) versions of the batch kernels; the default is 2-lane SSE2.
+# NOTE: -ffp-contract=off stops the compiler from fusing a*b+c in the scalar functions, which would
+#       make them differ from the batch kernels. Explicit std::fma() calls are unaffected.
+#QMAKE_CXXFLAGS += -mavx2 -mfma -ffp-contract=off
+#QMAKE_CXXFLAGS += -mavx512f -ffp-contract=off
+
+# Uncomment to count how often each code path of the intersection functions is taken (see pathcounters.h).
+# The speed benchmarks then print the counts, but they are also slowed down by the counting.
+#DEFINES += PATHCOUNTERS_ENABLED
+
+# NOTE: gridintersection.cpp compiles to nothing without a 128-bit integer type (e.g. on MSVC or 32-bit
+#       targets), and --benchmark=grid then says that it isn't available
 SOURCES += \
     algorithms.cpp \
+    allpairs.cpp \
+    benchmarkresults.cpp \
+    exactpredicates.cpp \
+    gridintersection.cpp \
     gui/draggablecircle.cpp \
+    gui/heatmapitem.cpp \
+    gui/segmentscene.cpp \
     gui/widget.cpp \
+    incrementalintersections.cpp \
     main.cpp \
     mylinef.cpp \
-    tests.cpp
+    pathcounters.cpp \
+    perfcounters.cpp \
+    preparedline.cpp \
+    quantizedsegments.cpp \
+    referenceintersection.cpp \
+    segmentbatch.cpp \
+    segmentbvh.cpp \
+    segmentcorpus.cpp \
+    testcasegenerators.cpp \
+    tests.cpp \
+    uniformgrid.cpp \
+    worstcasesearch.cpp
 
 HEADERS += \
     algorithms.h \
+    allpairs.h \
+    benchmarkresults.h \
+    benchmarkutils.h \
+    counterrng.h \
+    doubledouble.h \
+    exactpredicates.h \
+    gridintersection.h \
     gui/draggablecircle.h \
     gui/flexibledoublespinbox.h \
+    gui/heatmapitem.h \
+    gui/segmentscene.h \
     gui/widget.h \
+    incrementalintersections.h \
     mylinef.h \
-    tests.h
+    pathcounters.h \
+    perfcounters.h \
+    preparedline.h \
+    quantizedsegments.h \
+    referenceintersection.h \
+    segmentbatch.h \
+    segmentbvh.h \
+    segmentcorpus.h \
+    simd.h \
+    testcasegenerators.h \
+    tests.h \
+    uniformgrid.h \
+    worstcasesearch.h
 
 FORMS += \
 	gui/widget.ui
@@ -1,17 +1,7 @@
 #include "algorithms.h"
 #include "mylinef.h"
 
-struct TaggedPoint
-{
-	QPointF point;
-	uint8_t parentId;
-
-	static bool lessX(const TaggedPoint& a, const TaggedPoint& b)
-	{ return a.point.x() < b.point.x(); }
-
-	static bool lessY(const TaggedPoint& a, const TaggedPoint& b)
-	{ return a.point.y() < b.point.y(); }
-};
+#include <utility>
 
 MyLineF::SegmentRelations
 Algo::analyzeCollinearSegments(const QLineF& s1, const QLineF& s2, QPointF* oneIntersectionPoint, qreal zeroTolerance)
@@ -19,34 +9,46 @@ Algo::analyzeCollinearSegments(const QLineF& s1, const QLineF& s2, QPointF* oneI
 	// ASSUMPTION: The segments are guaranteed to be valid and collinear
 	MyLineF::SegmentRelations relations = MyLineF::Parallel | MyLineF::LinesIntersect;
 
-	std::vector<TaggedPoint> endPoints
-	{
-		TaggedPoint{s1.p1(), 1},
-		TaggedPoint{s1.p2(), 1},
-		TaggedPoint{s2.p1(), 2},
-		TaggedPoint{s2.p2(), 2}
-	};	
+	// Endpoints 0 and 1 belong to s1; endpoints 2 and 3 belong to s2
+	const QPointF endPoints[4] = {s1.p1(), s1.p2(), s2.p1(), s2.p2()};
 
 	// Sort the endpoints by their coordinates on one axis
 	const bool vertical = Algo::robustFuzzyCompare(s1.p1().x(), s1.p2().x(), zeroTolerance);
-	std::sort(endPoints.begin(), endPoints.end(),
-			vertical ? &TaggedPoint::lessY : &TaggedPoint::lessX);
-	// TODO: Sort array-of-pointers instead?
+	qreal keys[4];
+	for (int i = 0; i < 4; ++i)
+		keys[i] = vertical ? endPoints[i].y() : endPoints[i].x();
+
+	// NOTE: Ties are broken by the original position, so this gives the same order as a stable sort.
+	//       This is a fixed sorting network, so nothing is allocated.
+	int order[4] = {0, 1, 2, 3};
+	const auto compareExchange = [&](int a, int b)
+	{
+		const int i = order[a];
+		const int j = order[b];
+		if (keys[j] < keys[i] || (keys[j] == keys[i] && j < i))
+			std::swap(order[a], order[b]);
+	};
+	compareExchange(0, 1);
+	compareExchange(2, 3);
+	compareExchange(0, 2);
+	compareExchange(1, 3);
+	compareExchange(1, 2);
 
 	// This calculation yields:
 	// - (If the segments overlap      ) The midpoint of the overlap, OR
 	// - (If the segments don't overlap) The midpoint of the gap between the 2 segments
 	if (oneIntersectionPoint)
-		*oneIntersectionPoint = (endPoints[1].point + endPoints[2].point) / 2;
+		*oneIntersectionPoint = (endPoints[order[1]] + endPoints[order[2]]) / 2;
 
-	if (endPoints[0].parentId != endPoints[1].parentId)
+	const auto parentId = [](int endPoint) { return endPoint / 2; };
+	if (parentId(order[0]) != parentId(order[1]))
 		return relations | MyLineF::SegmentsIntersect; // >= 1 points in common
 
 	// TODO: Double-check if the following test is actually needed.
 	//       If the segments have exactly 1 point in common, is it
 	//       possible for the previous test to return false?
-	const qreal i1 = vertical ? endPoints[1].point.y() : endPoints[1].point.x();
-	const qreal i2 = vertical ? endPoints[2].point.y() : endPoints[2].point.x();
+	const qreal i1 = keys[order[1]];
+	const qreal i2 = keys[order[2]];
 	if (Algo::robustFuzzyCompare(i1, i2, zeroTolerance))
 		return relations | MyLineF::SegmentsIntersect; // Exactly 1 point in common
 
@@ -0,0 +1,315 @@
+#include "allpairs.h"
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <vector>
+
+bool AllPairs::isDegenerate(const QLineF& segment)
+{
+	return !std::isfinite(segment.x1()) || !std::isfinite(segment.y1())
+			|| !std::isfinite(segment.x2()) || !std::isfinite(segment.y2())
+			|| (segment.x1() == segment.x2() && segment.y1() == segment.y2());
+}
+
+QVector<SegmentIntersection>
+AllPairs::bruteForce(const QVector<MyLineF>& segments, RelationFunc relationFunc)
+{
+	QVector<SegmentIntersection> results;
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		if (isDegenerate(segments[i]))
+			continue;
+
+		for (int j = i+1; j < segments.count(); ++j)
+		{
+			if (isDegenerate(segments[j]))
+				continue;
+
+			QPointF point(Q_QNAN, Q_QNAN);
+			const auto relations = (segments[i].*relationFunc)(segments[j], &point);
+			if (relations.testFlag(MyLineF::SegmentsIntersect))
+				results << SegmentIntersection{i, j, relations, point};
+		}
+	}
+	return results;
+}
+
+//=================
+// Bentley-Ottmann
+//=================
+namespace
+{
+
+// Events are ordered left-to-right, then bottom-to-top
+struct SweepPoint
+{
+	qreal x;
+	qreal y;
+
+	bool operator<(const SweepPoint& other) const
+	{ return x < other.x || (x == other.x && y < other.y); }
+};
+
+class BentleyOttmann
+{
+public:
+	BentleyOttmann(const QVector<MyLineF>& segments, AllPairs::RelationFunc relationFunc);
+	QVector<SegmentIntersection> run();
+
+private:
+	struct Event
+	{
+		QVector<int> starts;
+		QVector<int> ends;
+		QVector<int> crossings; // Segments that cross another segment here
+	};
+
+	// Orders the segments along the sweep line, just after the current sweep point
+	struct StatusCompare
+	{
+		typedef void is_transparent;
+		const BentleyOttmann* sweep;
+
+		bool operator()(int a, int b) const { return sweep->isBelow(a, b); }
+		bool operator()(int a, const SweepPoint& p) const { return sweep->yAt(a) < p.y; }
+		bool operator()(const SweepPoint& p, int a) const { return p.y < sweep->yAt(a); }
+	};
+	typedef std::set<int, StatusCompare> Status;
+
+	qreal yAt(int i) const;
+	bool isBelow(int a, int b) const;
+	void processEvent(const SweepPoint& p, const Event& event);
+	void checkPair(int a, int b);
+
+	const QVector<MyLineF>& m_segments;
+	const AllPairs::RelationFunc m_relationFunc;
+
+	QVector<MyLineF> m_leftToRight; // Copies of m_segments, with p1 to the left of (or below) p2
+	std::map<SweepPoint, Event> m_events;
+	Status m_status;
+	std::vector<Status::iterator> m_handles;
+	std::vector<bool> m_active;
+	std::vector<bool> m_atSweepPoint;
+	SweepPoint m_sweepPoint;
+
+	std::set<std::pair<int, int>> m_foundPairs;
+	QVector<SegmentIntersection> m_results;
+};
+
+BentleyOttmann::BentleyOttmann(const QVector<MyLineF>& segments, AllPairs::RelationFunc relationFunc) :
+	m_segments(segments),
+	m_relationFunc(relationFunc),
+	m_leftToRight(segments.count()),
+	m_status(StatusCompare{this}),
+	m_handles(segments.count()),
+	m_active(segments.count(), false),
+	m_atSweepPoint(segments.count(), false),
+	m_sweepPoint{-std::numeric_limits<qreal>::infinity(), -std::numeric_limits<qreal>::infinity()}
+{
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		if (AllPairs::isDegenerate(segments[i]))
+			continue;
+
+		SweepPoint p1{segments[i].x1(), segments[i].y1()};
+		SweepPoint p2{segments[i].x2(), segments[i].y2()};
+		if (p2 < p1)
+			std::swap(p1, p2);
+
+		m_leftToRight[i] = MyLineF(p1.x, p1.y, p2.x, p2.y);
+		m_events[p1].starts << i;
+		m_events[p2].ends << i;
+	}
+}
+
+QVector<SegmentIntersection> BentleyOttmann::run()
+{
+	while (!m_events.empty())
+	{
+		// NOTE: Processing an event can schedule a new event at the same point, which is then
+		//       processed next
+		const auto it = m_events.begin();
+		const SweepPoint p = it->first;
+		const Event event = it->second;
+		m_events.erase(it);
+
+		processEvent(p, event);
+	}
+	return m_results;
+}
+
+/*
+	The y-coordinate of the segment where it meets the sweep line.
+
+	Segments that were (re)inserted at the current sweep point are treated as passing exactly
+	through it, even if rounding errors in the crossing point say otherwise. Vertical segments meet
+	the sweep line at the sweep point, clamped to the segment.
+*/
+qreal BentleyOttmann::yAt(int i) const
+{
+	if (m_atSweepPoint[i])
+		return m_sweepPoint.y;
+
+	const MyLineF& s = m_leftToRight[i];
+	if (s.x1() == s.x2())
+		return qBound(s.y1(), m_sweepPoint.y, s.y2());
+	if (m_sweepPoint.x == s.x1())
+		return s.y1();
+	if (m_sweepPoint.x == s.x2())
+		return s.y2();
+
+	return s.y1() + (m_sweepPoint.x - s.x1()) * (s.dy() / s.dx());
+}
+
+bool BentleyOttmann::isBelow(int a, int b) const
+{
+	const qreal ya = yAt(a);
+	const qreal yb = yAt(b);
+	if (ya != yb)
+		return ya < yb;
+
+	// The segments meet at the sweep line, so order them by where they go next: The segment with the
+	// smaller slope is below. Vertical segments have an infinite slope.
+	const MyLineF& sa = m_leftToRight[a];
+	const MyLineF& sb = m_leftToRight[b];
+	const bool verticalA = (sa.dx() == 0);
+	const bool verticalB = (sb.dx() == 0);
+	if (verticalA != verticalB)
+		return verticalB;
+	if (!verticalA)
+	{
+		// ASSUMPTION: dx() > 0
+		const qreal lhs = sa.dy() * sb.dx();
+		const qreal rhs = sb.dy() * sa.dx();
+		if (lhs != rhs)
+			return lhs < rhs;
+	}
+
+	// Collinear (or both vertical)
+	return a < b;
+}
+
+/*
+	Tests a pair of segments. If they intersect, the pair is reported. If they cross, a crossing
+	event is scheduled so that their order on the sweep line gets swapped.
+*/
+void BentleyOttmann::checkPair(int a, int b)
+{
+	if (a == b)
+		return;
+	if (a > b)
+		std::swap(a, b);
+	if (m_foundPairs.count({a, b}))
+		return;
+
+	QPointF point(Q_QNAN, Q_QNAN);
+	const auto relations = (m_segments[a].*m_relationFunc)(m_segments[b], &point);
+	if (!relations.testFlag(MyLineF::SegmentsIntersect))
+		return;
+
+	m_foundPairs.insert({a, b});
+	m_results << SegmentIntersection{a, b, relations, point};
+
+	// Collinear segments stay in the same order
+	if (relations.testFlag(MyLineF::Parallel))
+		return;
+
+	// A crossing point that rounding has placed behind the sweep line is treated as being on it
+	SweepPoint q{point.x(), point.y()};
+	if (q < m_sweepPoint || !std::isfinite(q.x) || !std::isfinite(q.y))
+		q = m_sweepPoint;
+
+	auto& event = m_events[q];
+	event.crossings << a << b;
+}
+
+void BentleyOttmann::processEvent(const SweepPoint& p, const Event& event)
+{
+	// Take out the segments that end or cross here. Crossing segments get reinserted below, in
+	// their new order.
+	QVector<int> throughP;
+	for (int i : event.crossings)
+	{
+		if (m_active[i] && !event.ends.contains(i) && !throughP.contains(i))
+			throughP << i;
+	}
+	for (int i : event.ends + throughP)
+	{
+		if (m_active[i])
+		{
+			m_status.erase(m_handles[i]);
+			m_active[i] = false;
+		}
+	}
+
+	// Also take out every other segment that passes through p. Their crossings with the segments
+	// above are found with rounding errors, so concurrent segments may not be scheduled at exactly
+	// the same point.
+	m_sweepPoint = p;
+	const qreal tolerance = 256 * std::numeric_limits<qreal>::epsilon() * (qAbs(p.x) + qAbs(p.y) + 1);
+	for (auto it = m_status.lower_bound(SweepPoint{p.x, p.y - tolerance});
+			it != m_status.end() && yAt(*it) <= p.y + tolerance; )
+	{
+		throughP << *it;
+		m_active[*it] = false;
+		it = m_status.erase(it);
+	}
+
+	// Insert everything that passes through p, ordered as they leave the sweep point
+	throughP += event.starts;
+	for (int i : throughP)
+		m_atSweepPoint[i] = true;
+	for (int i : throughP)
+	{
+		m_handles[i] = m_status.insert(i).first;
+		m_active[i] = true;
+	}
+
+	// All segments that meet the sweep line at p, plus their neighbours below and above
+	auto first = m_status.lower_bound(p);
+	auto last = m_status.upper_bound(p);
+	const bool hasBelow = (first != m_status.begin());
+	const bool hasAbove = (last != m_status.end());
+	if (hasBelow)
+		--first;
+	if (hasAbove)
+		++last;
+	QVector<int> block;
+	for (auto it = first; it != last; ++it)
+		block << *it;
+
+	// Every segment through p intersects every other segment through p. The neighbours only need
+	// to be tested against the segments next to them.
+	const int firstThroughP = hasBelow ? 1 : 0;
+	const int lastThroughP = hasAbove ? block.count()-2 : block.count()-1;
+	for (int j = 0; j < block.count(); ++j)
+	{
+		for (int k = j+1; k < block.count(); ++k)
+		{
+			if (k == j+1 || (j >= firstThroughP && k <= lastThroughP))
+				checkPair(block[j], block[k]);
+		}
+	}
+
+	// The segments that end here are no longer on the sweep line, but they still touch
+	// everything else that passes through p
+	for (int j = 0; j < event.ends.count(); ++j)
+	{
+		for (int k = j+1; k < event.ends.count(); ++k)
+			checkPair(event.ends[j], event.ends[k]);
+		for (int k = firstThroughP; k <= lastThroughP; ++k)
+			checkPair(event.ends[j], block[k]);
+	}
+
+	for (int i : throughP)
+		m_atSweepPoint[i] = false;
+}
+
+}
+
+QVector<SegmentIntersection>
+AllPairs::sweepLine(const QVector<MyLineF>& segments, RelationFunc relationFunc)
+{
+	return BentleyOttmann(segments, relationFunc).run();
+}
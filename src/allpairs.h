@@ -0,0 +1,50 @@
+#ifndef ALLPAIRS_H
+#define ALLPAIRS_H
+
+#include "mylinef.h"
+
+#include <QVector>
+
+// One intersecting pair found by an all-pairs search
+struct SegmentIntersection
+{
+	int index1; // ASSUMPTION: index1 < index2
+	int index2;
+	MyLineF::SegmentRelations relations;
+	QPointF point;
+};
+
+namespace AllPairs
+{
+
+// The pairwise test used by the engines, e.g. &MyLineF::intersects_flsiV2
+typedef MyLineF::SegmentRelations (MyLineF::*RelationFunc)(const QLineF&, QPointF*) const;
+
+// Zero-length segments and segments containing NaN or Inf are skipped by all engines
+bool isDegenerate(const QLineF& segment);
+
+/*
+	Finds every pair of segments for which relationFunc() reports SegmentsIntersect, by testing all
+	N*(N-1)/2 pairs. This is the reference for the other engines.
+
+	Each pair is reported once, as segments[index1].*relationFunc(segments[index2]). This includes
+	collinear overlaps, which are reported as Parallel | LinesIntersect | SegmentsIntersect.
+	The order of the results is unspecified.
+*/
+QVector<SegmentIntersection> bruteForce(const QVector<MyLineF>& segments,
+		RelationFunc relationFunc = &MyLineF::intersects_flsiV2);
+
+/*
+	Same output as bruteForce(), but uses a Bentley-Ottmann sweep line to only test segments that
+	become neighbours along the sweep line: O((N+K) log N) for N segments with K intersecting pairs.
+
+	NOTE: The sweep relies on relationFunc() to find the crossing points, so a pair that
+	      relationFunc() misclassifies (e.g. nearly-parallel segments that it calls Parallel) can
+	      also throw off the neighbours of that pair.
+*/
+QVector<SegmentIntersection> sweepLine(const QVector<MyLineF>& segments,
+		RelationFunc relationFunc = &MyLineF::intersects_flsiV2);
+
+}
+
+#endif // ALLPAIRS_H
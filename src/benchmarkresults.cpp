@@ -0,0 +1,216 @@
+#include "benchmarkresults.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+
+#include <cmath>
+#include <limits>
+
+static const QString formatName = "QTBUG-75146-Study benchmark results";
+static const int formatVersion = 1;
+
+void
+BenchmarkResults::add(const BenchmarkRecord& record)
+{
+	BenchmarkRecord finite = record;
+	finite.metrics.clear();
+	for (auto key : record.metrics.keys())
+	{
+		const qreal value = record.metrics[key];
+		if (!std::isnan(value))
+			finite.metrics[key] = qBound(-std::numeric_limits<qreal>::max(), value, std::numeric_limits<qreal>::max());
+	}
+	m_records << finite;
+}
+
+QByteArray
+BenchmarkResults::toJson() const
+{
+	QJsonObject config;
+	for (auto key : m_config.keys())
+		config[key] = m_config[key];
+
+	QJsonArray records;
+	for (const auto& record : m_records)
+	{
+		QJsonObject metrics;
+		for (auto key : record.metrics.keys())
+			metrics[key] = record.metrics[key];
+
+		QJsonObject object;
+		object["benchmark"] = record.benchmark;
+		object["category"] = record.category;
+		object["algorithm"] = record.algorithm;
+		object["metrics"] = metrics;
+		records.append(object);
+	}
+
+	QJsonObject root;
+	root["format"] = formatName;
+	root["version"] = formatVersion;
+	root["config"] = config;
+	root["results"] = records;
+	return QJsonDocument(root).toJson();
+}
+
+// One row per metric, so that the columns don't depend on which benchmarks were run
+QByteArray
+BenchmarkResults::toCsv() const
+{
+	QString csv = "benchmark,category,algorithm,metric,value\n";
+	for (const auto& record : m_records)
+	{
+		for (auto key : record.metrics.keys())
+		{
+			csv += QString("%1,%2,%3,%4,%5\n")
+					.arg(record.benchmark)
+					.arg(record.category)
+					.arg(record.algorithm)
+					.arg(key)
+					.arg(record.metrics[key], 0, 'g', 17);
+		}
+	}
+	return csv.toUtf8();
+}
+
+bool
+BenchmarkResults::save(const QString& path, Format format, QString* errorString) const
+{
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		*errorString = QString("Can't create %1: %2").arg(path).arg(file.errorString());
+		return false;
+	}
+
+	const QByteArray data = (format == Json) ? toJson() : toCsv();
+	if (file.write(data) != qint64(data.size()))
+	{
+		*errorString = QString("Failed to write %1: %2").arg(path).arg(file.errorString());
+		return false;
+	}
+	return true;
+}
+
+bool
+BenchmarkResults::load(const QString& path, QString* errorString)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		*errorString = QString("Can't open %1: %2").arg(path).arg(file.errorString());
+		return false;
+	}
+
+	QJsonParseError parseError;
+	const QJsonObject root = QJsonDocument::fromJson(file.readAll(), &parseError).object();
+	if (parseError.error != QJsonParseError::NoError)
+	{
+		*errorString = QString("%1 is not valid JSON: %2").arg(path).arg(parseError.errorString());
+		return false;
+	}
+	if (root["format"].toString() != formatName || root["version"].toInt() != formatVersion)
+	{
+		*errorString = QString("%1 is not a version %2 results file").arg(path).arg(formatVersion);
+		return false;
+	}
+
+	m_config.clear();
+	const QJsonObject config = root["config"].toObject();
+	for (auto key : config.keys())
+		m_config[key] = config[key].toString();
+
+	m_records.clear();
+	for (const auto& value : root["results"].toArray())
+	{
+		const QJsonObject object = value.toObject();
+		BenchmarkRecord record;
+		record.benchmark = object["benchmark"].toString();
+		record.category = object["category"].toString();
+		record.algorithm = object["algorithm"].toString();
+
+		const QJsonObject metrics = object["metrics"].toObject();
+		// NOTE: toDouble() would turn anything else (e.g. the null of an older file's inf) into 0
+		for (auto key : metrics.keys())
+		{
+			if (metrics[key].isDouble())
+				record.metrics[key] = metrics[key].toDouble();
+		}
+
+		m_records << record;
+	}
+	return true;
+}
+
+QStringList
+BenchmarkResults::regressionsFrom(const BenchmarkResults& baseline, const Thresholds& thresholds) const
+{
+	QMap<QString, BenchmarkRecord> baselineRecords;
+	const auto recordKey = [](const BenchmarkRecord& record)
+	{
+		return QString("%1/%2/%3").arg(record.benchmark).arg(record.category).arg(record.algorithm);
+	};
+	for (const auto& record : baseline.m_records)
+		baselineRecords[recordKey(record)] = record;
+
+	QStringList regressions;
+	for (const auto& record : m_records)
+	{
+		const QString key = recordKey(record);
+		if (!baselineRecords.contains(key))
+			continue;
+
+		// A metric is only compared if both runs have it
+		const BenchmarkRecord& base = baselineRecords[key];
+		const auto compare = [&](const QString& metric, qreal maxIncrease, bool relative)
+		{
+			if (!record.metrics.contains(metric) || !base.metrics.contains(metric))
+				return;
+
+			const qreal now = record.metrics[metric];
+			const qreal before = base.metrics[metric];
+			const qreal limit = relative ? before * (1 + maxIncrease) : before + maxIncrease;
+			if (now > limit)
+			{
+				regressions << QString("%1: %2 went from %3 to %4 (limit %5)")
+						.arg(key).arg(metric).arg(before).arg(now).arg(limit);
+			}
+		};
+		compare("ns_median", thresholds.maxSlowdown, true);
+		compare("max_ulps", thresholds.maxUlpsIncrease, false);
+		compare("misclassified", thresholds.maxMisclassifiedIncrease, false);
+	}
+
+	// An empty list means that nothing was left out
+	const auto isLeftOut = [this](const QString& configKey, const QString& name, bool matchPrefix)
+	{
+		const QString list = m_config.value(configKey);
+		if (list.isEmpty())
+			return false;
+		for (auto selected : list.split(','))
+		{
+			if (name == selected || (matchPrefix && name.startsWith(selected + ' ')))
+				return false;
+		}
+		return true;
+	};
+
+	QSet<QString> currentKeys;
+	for (const auto& record : m_records)
+		currentKeys << recordKey(record);
+	for (const auto& base : baseline.m_records)
+	{
+		const QString key = recordKey(base);
+		if (currentKeys.contains(key)
+				|| isLeftOut("benchmark", base.benchmark, false)
+				|| isLeftOut("categories", base.category, false)
+				|| isLeftOut("algorithms", base.algorithm, true))
+			continue;
+
+		regressions << QString("%1: missing from this run").arg(key);
+	}
+	return regressions;
+}
@@ -0,0 +1,73 @@
+#ifndef BENCHMARKRESULTS_H
+#define BENCHMARKRESULTS_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// One algorithm's results for one category of one benchmark
+struct BenchmarkRecord
+{
+	QString benchmark;  // The --benchmark name, e.g. "speed" or "accuracy"
+	QString category;   // Benchmarker::Category key
+	QString algorithm;  // Function name, without padding
+	QMap<QString, qreal> metrics;
+};
+
+/*
+	Machine-readable benchmark results, which can be saved as JSON or CSV and compared with a
+	baseline (a JSON file saved by an earlier run).
+*/
+class BenchmarkResults
+{
+public:
+	enum Format
+	{
+		Json,
+		Csv
+	};
+
+	struct Thresholds
+	{
+		qreal maxSlowdown = 0.1;      // Relative increase in the median time per call
+		qreal maxUlpsIncrease = 0;    // Absolute increase in the worst point error, in ulps
+		qint64 maxMisclassifiedIncrease = 0;
+	};
+
+	// Settings that the results depend on; saved with the results so that baselines can be checked
+	void setConfig(const QString& key, const QString& value) { m_config[key] = value; }
+	QMap<QString, QString> config() const { return m_config; }
+
+	/*
+		NOTE: JSON has no infinities or NaN, so infinite metrics are clamped to the largest finite
+		      double, and NaN metrics are dropped. Then a saved file always loads back to the same
+		      records.
+	*/
+	void add(const BenchmarkRecord& record);
+	QVector<BenchmarkRecord> records() const { return m_records; }
+
+	bool save(const QString& path, Format format, QString* errorString) const;
+
+	// ASSUMPTION: The file was saved as JSON
+	bool load(const QString& path, QString* errorString);
+
+	/*
+		Describes every record that is worse than the matching record (same benchmark, category and
+		algorithm) in `baseline`, beyond the thresholds, and every record of `baseline` that is
+		missing (e.g. because a function was renamed or crashed). Records that this run left out
+		through its "benchmark", "algorithms" or "categories" config aren't missing: An algorithm is
+		left out if --algorithms was given, and it neither is nor starts with one of them.
+		Records that only this run has are ignored.
+	*/
+	QStringList regressionsFrom(const BenchmarkResults& baseline, const Thresholds& thresholds) const;
+
+private:
+	QByteArray toJson() const;
+	QByteArray toCsv() const;
+
+	QMap<QString, QString> m_config;
+	QVector<BenchmarkRecord> m_records;
+};
+
+#endif // BENCHMARKRESULTS_H
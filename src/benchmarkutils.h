@@ -0,0 +1,130 @@
+#ifndef BENCHMARKUTILS_H
+#define BENCHMARKUTILS_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_GNU) || defined(Q_CC_CLANG))
+#  include <x86intrin.h>
+#  define BENCHMARK_HAVE_RDTSC
+#elif defined(Q_PROCESSOR_X86) && defined(Q_CC_MSVC)
+#  include <intrin.h>
+#  define BENCHMARK_HAVE_RDTSC
+#endif
+
+#ifdef Q_OS_LINUX
+#  include <unistd.h>
+#endif
+
+namespace Bench
+{
+
+/*
+	Stops the compiler from treating `value` as unused, so that the code which calculated it
+	can't be eliminated as dead code.
+*/
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	// NOTE: A volatile read is heavier than an empty asm statement, but it is portable
+	const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+	(void)*sink;
+#endif
+}
+
+/*
+	The CPU's time-stamp counter, or 0 if it isn't available.
+
+	NOTE: On modern x86 CPUs, the TSC ticks at a constant rate regardless of the core's actual
+	      clock speed, so "cycles" are reference cycles rather than core clock cycles.
+*/
+inline quint64 readCycleCounter()
+{
+#ifdef BENCHMARK_HAVE_RDTSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+inline bool haveCycleCounter()
+{
+#ifdef BENCHMARK_HAVE_RDTSC
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+	The size of the CPU's largest cache in bytes, or 0 if it is unknown.
+
+	NOTE: Virtual machines can report the host's cache size, or none at all
+*/
+inline qint64 lastLevelCacheSize()
+{
+#if defined(Q_OS_LINUX) && defined(_SC_LEVEL3_CACHE_SIZE)
+	for (int name : {_SC_LEVEL4_CACHE_SIZE, _SC_LEVEL3_CACHE_SIZE, _SC_LEVEL2_CACHE_SIZE})
+	{
+		const long size = sysconf(name);
+		if (size > 0)
+			return size;
+	}
+#endif
+	return 0;
+}
+
+// Robust summary of repeated measurements
+struct SampleStats
+{
+	qreal median = 0;
+	qreal mad = 0; // Median absolute deviation from the median
+	qreal p99 = 0; // 99th percentile (nearest rank)
+};
+
+inline qreal median(QVector<qreal> values)
+{
+	if (values.isEmpty())
+		return 0;
+
+	const int mid = values.count() / 2;
+	std::nth_element(values.begin(), values.begin() + mid, values.end());
+	if (values.count() % 2 == 1)
+		return values[mid];
+
+	const qreal upper = values[mid];
+	const qreal lower = *std::max_element(values.begin(), values.begin() + mid);
+	return (lower + upper) / 2;
+}
+
+inline SampleStats summarize(const QVector<qreal>& samples)
+{
+	SampleStats stats;
+	if (samples.isEmpty())
+		return stats;
+
+	stats.median = median(samples);
+
+	QVector<qreal> deviations;
+	deviations.reserve(samples.count());
+	for (qreal sample : samples)
+		deviations << std::abs(sample - stats.median);
+	stats.mad = median(deviations);
+
+	QVector<qreal> sorted = samples;
+	std::sort(sorted.begin(), sorted.end());
+	const int rank = int(std::ceil(0.99 * sorted.count())) - 1;
+	stats.p99 = sorted[qBound(0, rank, sorted.count()-1)];
+
+	return stats;
+}
+
+}
+
+#endif // BENCHMARKUTILS_H
@@ -0,0 +1,55 @@
+#ifndef COUNTERRNG_H
+#define COUNTERRNG_H
+
+#include <QtGlobal>
+
+#include <array>
+
+/*
+	Counter-based random number generator (Philox4x32-10 from Salmon et al., "Parallel Random
+	Numbers: As Easy as 1, 2, 3", SC'11).
+
+	Unlike std::rand() or std::mt19937, it has no state: The random bits are a pure function of the
+	seed and a counter. Test case i can be generated from counter i by any thread, in any order, and
+	it always gets the same bits.
+*/
+class CounterRng
+{
+public:
+	typedef std::array<quint32, 4> Block;
+
+	explicit CounterRng(quint64 seed) :
+		m_key{quint32(seed), quint32(seed >> 32)}
+	{}
+
+	// 128 random bits. `stream` selects one of several independent blocks for the same counter.
+	Block operator()(quint64 counter, quint32 stream = 0) const
+	{
+		Block ctr{quint32(counter), quint32(counter >> 32), stream, 0};
+		std::array<quint32, 2> key = m_key;
+		for (int round = 0; round < 10; ++round)
+		{
+			if (round > 0)
+			{
+				key[0] += 0x9E3779B9;
+				key[1] += 0xBB67AE85;
+			}
+
+			const quint64 product0 = quint64(0xD2511F53) * ctr[0];
+			const quint64 product1 = quint64(0xCD9E8D57) * ctr[2];
+			ctr = Block
+			{
+				quint32(product1 >> 32) ^ ctr[1] ^ key[0],
+				quint32(product1),
+				quint32(product0 >> 32) ^ ctr[3] ^ key[1],
+				quint32(product0)
+			};
+		}
+		return ctr;
+	}
+
+private:
+	std::array<quint32, 2> m_key;
+};
+
+#endif // COUNTERRNG_H
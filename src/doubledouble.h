@@ -0,0 +1,129 @@
+#ifndef DOUBLEDOUBLE_H
+#define DOUBLEDOUBLE_H
+
+#include <QtGlobal>
+
+#include <cmath>
+
+/*
+	A number represented as the unevaluated sum of 2 doubles (hi + lo, with |lo| <= ulp(hi)/2),
+	giving about 106 bits of precision. The algorithms are from Hida, Li & Bailey's QD library.
+
+	ASSUMPTION: No intermediate result overflows or underflows
+*/
+struct DoubleDouble
+{
+	qreal hi;
+	qreal lo;
+
+	// a + b == sum + error, exactly
+	static void twoSum(qreal a, qreal b, qreal& sum, qreal& error)
+	{
+		sum = a + b;
+		const qreal bVirtual = sum - a;
+		const qreal aVirtual = sum - bVirtual;
+		error = (a - aVirtual) + (b - bVirtual);
+	}
+
+	// a + b == sum + error, exactly, if |a| >= |b|
+	static void quickTwoSum(qreal a, qreal b, qreal& sum, qreal& error)
+	{
+		sum = a + b;
+		error = b - (sum - a);
+	}
+
+	// a * b == product + error, exactly
+	static void twoProduct(qreal a, qreal b, qreal& product, qreal& error)
+	{
+		product = a * b;
+#ifdef __FMA__
+		error = std::fma(a, b, -product);
+#else
+		// Dekker's algorithm: Split each factor into 2 halves whose products are exact
+		// NOTE: std::fma() would also be exact, but it is emulated in software without FMA instructions
+		const auto split = [](qreal x, qreal& high, qreal& low)
+		{
+			const qreal scaled = 134217729.0 * x; // 2^27 + 1
+			high = scaled - (scaled - x);
+			low = x - high;
+		};
+		qreal aHigh, aLow, bHigh, bLow;
+		split(a, aHigh, aLow);
+		split(b, bHigh, bLow);
+		error = ((aHigh*bHigh - product) + aHigh*bLow + aLow*bHigh) + aLow*bLow;
+#endif
+	}
+
+	// a - b, exactly
+	static DoubleDouble difference(qreal a, qreal b)
+	{
+		DoubleDouble result;
+		twoSum(a, -b, result.hi, result.lo);
+		return result;
+	}
+
+	// hi is the value rounded to the nearest double
+	qreal toDouble() const { return hi; }
+
+	friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		qreal s1, s2, t1, t2;
+		twoSum(a.hi, b.hi, s1, s2);
+		twoSum(a.lo, b.lo, t1, t2);
+		s2 += t1;
+		quickTwoSum(s1, s2, s1, s2);
+		s2 += t2;
+
+		DoubleDouble result;
+		quickTwoSum(s1, s2, result.hi, result.lo);
+		return result;
+	}
+
+	friend DoubleDouble operator-(const DoubleDouble& a)
+	{
+		return DoubleDouble{-a.hi, -a.lo};
+	}
+
+	friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		return a + (-b);
+	}
+
+	friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		qreal p1, p2;
+		twoProduct(a.hi, b.hi, p1, p2);
+		p2 += a.hi*b.lo + a.lo*b.hi;
+
+		DoubleDouble result;
+		quickTwoSum(p1, p2, result.hi, result.lo);
+		return result;
+	}
+
+	friend DoubleDouble operator*(const DoubleDouble& a, qreal b)
+	{
+		qreal p1, p2;
+		twoProduct(a.hi, b, p1, p2);
+		p2 += a.lo*b;
+
+		DoubleDouble result;
+		quickTwoSum(p1, p2, result.hi, result.lo);
+		return result;
+	}
+
+	// Long division, with 3 partial quotients
+	friend DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b)
+	{
+		const qreal q1 = a.hi / b.hi;
+		DoubleDouble r = a - b*q1;
+		const qreal q2 = r.hi / b.hi;
+		r = r - b*q2;
+		const qreal q3 = r.hi / b.hi;
+
+		DoubleDouble result;
+		quickTwoSum(q1, q2, result.hi, result.lo);
+		return result + DoubleDouble{q3, 0};
+	}
+};
+
+#endif // DOUBLEDOUBLE_H
@@ -0,0 +1,99 @@
+#include "exactpredicates.h"
+#include "doubledouble.h"
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+thread_local quint64 nSlowPaths = 0;
+
+/*
+	Adds b to the expansion e[0..n), in place. Zero components are dropped.
+	Returns the new number of components, which is at most n+1.
+
+	ASSUMPTION: e[] is sorted by increasing magnitude, and its components don't overlap
+*/
+int growExpansion(qreal* e, int n, qreal b)
+{
+	qreal q = b;
+	int m = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		qreal sum, error;
+		DoubleDouble::twoSum(q, e[i], sum, error);
+		q = sum;
+		if (error != 0)
+			e[m++] = error;
+	}
+	if (q != 0 || m == 0)
+		e[m++] = q;
+	return m;
+}
+
+/*
+	The exact sign of (ax*by - ay*bx), where ax, ay, bx and by are each the exact sum of 2 doubles
+	(value + error).
+*/
+int exactCrossSign(qreal ax, qreal axError, qreal ay, qreal ayError,
+		qreal bx, qreal bxError, qreal by, qreal byError)
+{
+	const qreal left[2][2] = {{ax, axError}, {by, byError}};
+	const qreal right[2][2] = {{ay, ayError}, {bx, bxError}};
+
+	// Each of the 8 partial products is exactly 2 doubles
+	qreal expansion[16];
+	int n = 0;
+	for (int i = 0; i < 2; ++i)
+	{
+		for (int j = 0; j < 2; ++j)
+		{
+			// NOTE: Most error terms are 0 for inputs with few significant bits (e.g. integers)
+			qreal product, error;
+			if (left[0][i] != 0 && left[1][j] != 0)
+			{
+				DoubleDouble::twoProduct(left[0][i], left[1][j], product, error);
+				n = growExpansion(expansion, n, error);
+				n = growExpansion(expansion, n, product);
+			}
+			if (right[0][i] != 0 && right[1][j] != 0)
+			{
+				DoubleDouble::twoProduct(right[0][i], right[1][j], product, error);
+				n = growExpansion(expansion, n, -error);
+				n = growExpansion(expansion, n, -product);
+			}
+		}
+	}
+
+	// The largest component has the sign of the whole expansion
+	const qreal largest = expansion[n-1];
+	return (largest > 0) - (largest < 0);
+}
+
+}
+
+int Exact::crossSignExact(const QPointF& a, const QPointF& b, const QPointF& c, const QPointF& d)
+{
+	const qreal abx = b.x() - a.x();
+	const qreal aby = b.y() - a.y();
+	const qreal cdx = d.x() - c.x();
+	const qreal cdy = d.y() - c.y();
+
+	++nSlowPaths;
+
+	// Each difference is exactly (rounded difference + error), so the products can be expanded exactly
+	const auto differenceError = [](qreal to, qreal from, qreal difference)
+	{
+		const qreal fromVirtual = to - difference;
+		const qreal toVirtual = difference + fromVirtual;
+		return (to - toVirtual) + (fromVirtual - from);
+	};
+	return exactCrossSign(abx, differenceError(b.x(), a.x(), abx), aby, differenceError(b.y(), a.y(), aby),
+			cdx, differenceError(d.x(), c.x(), cdx), cdy, differenceError(d.y(), c.y(), cdy));
+}
+
+quint64 Exact::slowPathCount()
+{
+	return nSlowPaths;
+}
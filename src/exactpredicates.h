@@ -0,0 +1,69 @@
+#ifndef EXACTPREDICATES_H
+#define EXACTPREDICATES_H
+
+#include <QPointF>
+
+#include <cmath>
+#include <limits>
+
+/*
+	Exact geometric predicates with adaptive precision, after Shewchuk's "Adaptive Precision
+	Floating-Point Arithmetic and Fast Robust Geometric Predicates" (1997).
+
+	Each predicate is first evaluated in plain floating-point arithmetic, with an error bound. Only
+	if the result is too close to 0 to trust is it recalculated exactly, using floating-point
+	expansions (sums of non-overlapping doubles).
+
+	ASSUMPTION: No intermediate result overflows or underflows
+*/
+namespace Exact
+{
+
+// The slow path of crossSign()
+int crossSignExact(const QPointF& a, const QPointF& b, const QPointF& c, const QPointF& d);
+
+/*
+	The exact sign (-1, 0 or +1) of the cross product (b - a) x (d - c)
+	= (b.x-a.x)*(d.y-c.y) - (b.y-a.y)*(d.x-c.x)
+
+	0 means that the 2 directions are exactly parallel.
+*/
+inline int crossSign(const QPointF& a, const QPointF& b, const QPointF& c, const QPointF& d)
+{
+	// Relative error bound for the floating-point evaluation, from Shewchuk's orient2d().
+	// The factors are differences, like in orient2d(), so the same bound applies.
+	const qreal epsilon = std::numeric_limits<qreal>::epsilon() / 2;
+	const qreal errorBoundFactor = (3 + 16*epsilon) * epsilon;
+
+	const qreal detLeft = (b.x() - a.x()) * (d.y() - c.y());
+	const qreal detRight = (b.y() - a.y()) * (d.x() - c.x());
+	const qreal det = detLeft - detRight;
+
+	// Fast path: The rounding errors can't have changed the sign
+	const qreal errorBound = errorBoundFactor * (std::abs(detLeft) + std::abs(detRight));
+	if (det > errorBound)
+		return 1;
+	if (-det > errorBound)
+		return -1;
+	if (errorBound == 0)
+		return 0; // A product can only round to 0 if one of its factors is exactly 0
+
+	return crossSignExact(a, b, c, d);
+}
+
+/*
+	The exact sign of the orientation of c relative to the line through a and b:
+	+1 if a, b, c are in counterclockwise order (in a y-up coordinate system), -1 if clockwise, and
+	0 if the 3 points are exactly collinear.
+*/
+inline int orientation(const QPointF& a, const QPointF& b, const QPointF& c)
+{
+	return crossSign(a, b, a, c);
+}
+
+// The number of predicates that this thread has evaluated with the exact fallback
+quint64 slowPathCount();
+
+}
+
+#endif // EXACTPREDICATES_H
@@ -0,0 +1,142 @@
+#include "gridintersection.h"
+#include "doubledouble.h"
+
+#include <cmath>
+#include <limits>
+
+#ifdef GRID_HAVE_INT128
+
+namespace
+{
+
+typedef Grid::Int128 Int128;
+
+// The sign of (b - a) x (c - a): Positive if c is to the left of a->b, 0 if it is on the line
+int orientation(const Grid::Point& a, const Grid::Point& b, const Grid::Point& c)
+{
+	const qint64 abx = qint64(b.x) - a.x;
+	const qint64 aby = qint64(b.y) - a.y;
+	const qint64 acx = qint64(c.x) - a.x;
+	const qint64 acy = qint64(c.y) - a.y;
+	const Int128 determinant = Int128(abx) * acy - Int128(aby) * acx;
+	return (determinant > 0) - (determinant < 0);
+}
+
+// NOTE: The numerators have at most 102 bits, so the remainder after rounding to 53 bits is exact
+DoubleDouble toDoubleDouble(Int128 x)
+{
+	const qreal hi = qreal(x);
+	return DoubleDouble{hi, qreal(x - Int128(hi))};
+}
+
+// Rounds towards negative infinity. ASSUMPTION: divisor > 0
+Int128 floorDivide(Int128 dividend, Int128 divisor)
+{
+	const Int128 quotient = dividend / divisor;
+	return (dividend % divisor != 0 && dividend < 0) ? quotient - 1 : quotient;
+}
+
+}
+
+QPointF Grid::RationalPoint::toPointF(qreal gridSize) const
+{
+	const DoubleDouble d = toDoubleDouble(denominator);
+	return QPointF( (toDoubleDouble(x) / d * gridSize).toDouble(), (toDoubleDouble(y) / d * gridSize).toDouble() );
+}
+
+// ASSUMPTION: The point is within the range of the grid, e.g. because the segments intersect
+Grid::Point Grid::RationalPoint::snapRounded() const
+{
+	return Point{ qint32(floorDivide(2*x + denominator, 2*denominator)), qint32(floorDivide(2*y + denominator, 2*denominator)) };
+}
+
+bool Grid::toGrid(const QLineF& line, qreal gridSize, Segment* segment)
+{
+	const qreal coords[] = {line.x1(), line.y1(), line.x2(), line.y2()};
+	qint32 gridCoords[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		const qreal scaled = std::round(coords[i] / gridSize);
+		if (!(qAbs(scaled) <= std::numeric_limits<qint32>::max())) // Also catches NaN
+			return false;
+		gridCoords[i] = qint32(scaled);
+	}
+
+	*segment = Segment{ {gridCoords[0], gridCoords[1]}, {gridCoords[2], gridCoords[3]} };
+	return true;
+}
+
+QLineF Grid::fromGrid(const Segment& segment, qreal gridSize)
+{
+	return QLineF(segment.p1.x * gridSize, segment.p1.y * gridSize, segment.p2.x * gridSize, segment.p2.y * gridSize);
+}
+
+MyLineF::SegmentRelations
+Grid::intersects(const Segment& s1, const Segment& s2, RationalPoint* intersectionPoint)
+{
+	if (   (s1.p1.x == s1.p2.x && s1.p1.y == s1.p2.y)
+		|| (s2.p1.x == s2.p2.x && s2.p1.y == s2.p2.y) )
+		return MyLineF::SegmentRelations(); // Invalid input
+
+	// Where the endpoints of s2 are, relative to s1
+	const int o1 = orientation(s1.p1, s1.p2, s2.p1);
+	const int o2 = orientation(s1.p1, s1.p2, s2.p2);
+
+	if (o1 == 0 && o2 == 0) // Collinear
+	{
+		// The 2 middle endpoints along the main axis of s1, picked exactly like in intersects_adaptive()
+		const bool useY = qAbs(qint64(s1.p2.x) - s1.p1.x) < qAbs(qint64(s1.p2.y) - s1.p1.y);
+		const auto key = [useY](const Point& p) { return useY ? p.y : p.x; };
+
+		const Point lo1 = key(s1.p1) <= key(s1.p2) ? s1.p1 : s1.p2;
+		const Point hi1 = key(s1.p1) <= key(s1.p2) ? s1.p2 : s1.p1;
+		const Point lo2 = key(s2.p1) <= key(s2.p2) ? s2.p1 : s2.p2;
+		const Point hi2 = key(s2.p1) <= key(s2.p2) ? s2.p2 : s2.p1;
+
+		const Point innerLo = key(lo1) >= key(lo2) ? lo1 : lo2;
+		const Point innerHi = key(hi1) <= key(hi2) ? hi1 : hi2;
+		if (intersectionPoint)
+			*intersectionPoint = RationalPoint{ Int128(innerLo.x) + innerHi.x, Int128(innerLo.y) + innerHi.y, 2 };
+
+		const MyLineF::SegmentRelations relations = MyLineF::Parallel | MyLineF::LinesIntersect;
+		return key(innerLo) <= key(innerHi) ? (relations | MyLineF::SegmentsIntersect) : relations;
+	}
+
+	// Same formula as intersects_flsiV2(), but every product is exact
+	const qint64 ax = qint64(s1.p2.x) - s1.p1.x;
+	const qint64 ay = qint64(s1.p2.y) - s1.p1.y;
+	const qint64 bx = qint64(s2.p1.x) - s2.p2.x;
+	const qint64 by = qint64(s2.p1.y) - s2.p2.y;
+	const Int128 denominator = Int128(ay) * bx - Int128(ax) * by;
+	if (denominator == 0)
+		return MyLineF::Parallel;
+
+	if (intersectionPoint)
+	{
+		const qint64 cx = qint64(s1.p1.x) - s2.p1.x;
+		const qint64 cy = qint64(s1.p1.y) - s2.p1.y;
+		const Int128 nna = Int128(by) * cx - Int128(bx) * cy;
+
+		// p1 + a * (nna / denominator), over a positive denominator
+		const Int128 sign = (denominator < 0) ? -1 : 1;
+		*intersectionPoint = RationalPoint
+		{
+			sign * (Int128(s1.p1.x) * denominator + ax * nna),
+			sign * (Int128(s1.p1.y) * denominator + ay * nna),
+			sign * denominator
+		};
+	}
+
+	// Each segment must have the other's endpoints on both sides of it (or on it)
+	if (o1 * o2 > 0)
+		return MyLineF::LinesIntersect;
+
+	const int o3 = orientation(s2.p1, s2.p2, s1.p1);
+	const int o4 = orientation(s2.p1, s2.p2, s1.p2);
+	if (o3 * o4 > 0)
+		return MyLineF::LinesIntersect;
+
+	return MyLineF::LinesIntersect | MyLineF::SegmentsIntersect;
+}
+
+#endif // GRID_HAVE_INT128
@@ -0,0 +1,77 @@
+#ifndef GRIDINTERSECTION_H
+#define GRIDINTERSECTION_H
+
+#include "mylinef.h"
+
+/*
+	Exact intersection of segments whose endpoints are snapped to a fixed grid (e.g. 1/1024 units),
+	in integer arithmetic.
+
+	The coordinates are 32-bit multiples of the grid size. Their differences fit in 64 bits, and the
+	orientation determinants (and the numerators of the intersection point) fit in 128 bits, so
+	every classification is exact without any tolerances or fallbacks, and the intersection point
+	is an exact rational.
+
+	NOTE: This needs a 128-bit integer type (GCC and Clang on 64-bit targets). Without one, e.g. on
+	      MSVC or 32-bit targets, GRID_HAVE_INT128 isn't defined, and neither is anything in Grid::.
+*/
+#ifdef __SIZEOF_INT128__
+#  define GRID_HAVE_INT128 1
+#endif
+
+#ifdef GRID_HAVE_INT128
+namespace Grid
+{
+
+typedef __int128 Int128;
+
+struct Point
+{
+	qint32 x;
+	qint32 y;
+};
+
+struct Segment
+{
+	Point p1;
+	Point p2;
+};
+
+// (x/denominator, y/denominator) in grid units. The denominator is always positive.
+struct RationalPoint
+{
+	Int128 x;
+	Int128 y;
+	Int128 denominator;
+
+	// The nearest point in scene units (see toGrid()). NOTE: Each coordinate is calculated in
+	// double-double arithmetic, so it can differ from the correctly rounded one in rare ties.
+	QPointF toPointF(qreal gridSize) const;
+
+	// The grid point that is nearest to this point, rounding halves up (as in snap rounding)
+	Point snapRounded() const;
+};
+
+/*
+	Converts a segment from scene units to grid units, rounding each coordinate to the nearest
+	multiple of gridSize. Returns false if a coordinate isn't finite or doesn't fit in 32 bits.
+*/
+bool toGrid(const QLineF& line, qreal gridSize, Segment* segment);
+
+// The inverse of toGrid(). It is exact if gridSize is a power of 2.
+QLineF fromGrid(const Segment& segment, qreal gridSize);
+
+/*
+	The same relations as MyLineF::intersects_adaptive() and Reference::intersects(), and the exact
+	point that they round: The crossing point of non-parallel lines, or for collinear segments,
+	the midpoint of the overlap (or gap) along the main axis of s1.
+
+	Zero-length segments are invalid input, and give a null result. intersectionPoint is only written
+	if the lines intersect.
+*/
+MyLineF::SegmentRelations intersects(const Segment& s1, const Segment& s2, RationalPoint* intersectionPoint = nullptr);
+
+}
+#endif // GRID_HAVE_INT128
+
+#endif // GRIDINTERSECTION_H
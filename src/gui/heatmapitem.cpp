@@ -0,0 +1,263 @@
+#include "heatmapitem.h"
+#include "mylinef.h"
+
+#include <QColor>
+#include <QPainter>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+// Pixels per side of a tile
+const int tileSize = 64;
+
+// Pixels per side of a block in the first, coarse pass
+const int coarseStep = 8;
+
+}
+
+bool HeatmapItem::Input::operator==(const Input& other) const
+{
+	if (   !isSamePoint(region.topLeft(), other.region.topLeft()) || !isSamePoint(region.bottomRight(), other.region.bottomRight())
+		|| resolution != other.resolution || sweptEndpoint != other.sweptEndpoint
+		|| !isSamePoint(offset, other.offset) || mode != other.mode )
+		return false;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		if (!isSamePoint(endpoints[i], other.endpoints[i]))
+			return false;
+	}
+	return true;
+}
+
+/*
+	Calculates one tile of the heatmap. In a coarse pass (step > 1), each block of step*step
+	pixels gets the colour of its centre.
+*/
+class HeatmapTile : public QRunnable
+{
+public:
+	HeatmapTile(HeatmapItem* item, const QAtomicInt* currentGeneration, int generation,
+			const HeatmapItem::Input& input, const QRect& pixels, int step) :
+		m_item(item),
+		m_currentGeneration(currentGeneration),
+		m_generation(generation),
+		m_input(input),
+		m_pixels(pixels),
+		m_step(step)
+	{}
+
+	void run() override
+	{
+		const qreal pixelWidth = m_input.region.width() / m_input.resolution.width();
+		const qreal pixelHeight = m_input.region.height() / m_input.resolution.height();
+
+		QImage tile(m_pixels.size(), QImage::Format_ARGB32);
+		for (int y = 0; y < tile.height(); y += m_step)
+		{
+			if (m_currentGeneration->loadAcquire() != m_generation) // Cancelled
+				return;
+
+			const int blockHeight = qMin(m_step, tile.height() - y);
+			for (int x = 0; x < tile.width(); x += m_step)
+			{
+				const int blockWidth = qMin(m_step, tile.width() - x);
+				const QPointF scenePos(
+						m_input.region.left() + (m_pixels.x() + x + 0.5*blockWidth) * pixelWidth,
+						m_input.region.top() + (m_pixels.y() + y + 0.5*blockHeight) * pixelHeight);
+				const QRgb colour = HeatmapItem::evaluate(m_input, scenePos - m_input.offset);
+
+				for (int row = y; row < y + blockHeight; ++row)
+				{
+					QRgb* line = reinterpret_cast<QRgb*>(tile.scanLine(row));
+					std::fill(line + x, line + x + blockWidth, colour);
+				}
+			}
+		}
+		emit m_item->tileFinished(m_generation, m_pixels.topLeft(), tile);
+	}
+
+private:
+	HeatmapItem* m_item;
+	const QAtomicInt* m_currentGeneration;
+	const int m_generation;
+	const HeatmapItem::Input m_input;
+	const QRect m_pixels;
+	const int m_step;
+};
+
+HeatmapItem::HeatmapItem(QGraphicsItem* parent) :
+	QObject(),
+	QGraphicsItem(parent),
+	m_generation(0)
+{
+	m_input.resolution = QSize();
+	m_input.sweptEndpoint = -1;
+	m_input.mode = PointSpread;
+
+	setAcceptedMouseButtons(Qt::NoButton); // Lets the view scroll by dragging, as usual
+
+	// The tiles are emitted from the pool's threads, so they are queued to this thread
+	connect(this, &HeatmapItem::tileFinished, this, &HeatmapItem::addTile);
+}
+
+HeatmapItem::~HeatmapItem()
+{
+	m_generation.ref();
+	m_pool.clear();
+	m_pool.waitForDone();
+}
+
+void HeatmapItem::setInput(const Input& input)
+{
+	if (input == m_input)
+		return;
+
+	const int generation = m_generation.fetchAndAddOrdered(1) + 1;
+	m_pool.clear(); // Removes the queued tiles; the running ones notice the new generation
+
+	// NOTE: The old image is kept while the endpoints move, so that the new one doesn't flicker in
+	const bool keepImage = isSamePoint(input.region.topLeft(), m_input.region.topLeft())
+			&& isSamePoint(input.region.bottomRight(), m_input.region.bottomRight())
+			&& input.resolution == m_input.resolution && input.sweptEndpoint == m_input.sweptEndpoint
+			&& input.mode == m_input.mode;
+
+	prepareGeometryChange();
+	m_input = input;
+
+	if (input.sweptEndpoint < 0 || input.resolution.isEmpty())
+	{
+		m_image = QImage();
+		return;
+	}
+
+	if (!keepImage || m_image.isNull())
+	{
+		m_image = QImage(input.resolution, QImage::Format_ARGB32);
+		m_image.fill(Qt::transparent);
+	}
+	update();
+
+	for (int step : {coarseStep, 1})
+	{
+		for (int y = 0; y < input.resolution.height(); y += tileSize)
+		{
+			for (int x = 0; x < input.resolution.width(); x += tileSize)
+			{
+				const QRect pixels(x, y, qMin(tileSize, input.resolution.width() - x), qMin(tileSize, input.resolution.height() - y));
+				m_pool.start(new HeatmapTile(this, &m_generation, generation, input, pixels, step));
+			}
+		}
+	}
+}
+
+void HeatmapItem::addTile(int generation, const QPoint& position, const QImage& tile)
+{
+	if (generation != m_generation.loadAcquire())
+		return;
+
+	QPainter painter(&m_image);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	painter.drawImage(position, tile);
+	painter.end();
+
+	const qreal scaleX = m_input.region.width() / m_input.resolution.width();
+	const qreal scaleY = m_input.region.height() / m_input.resolution.height();
+	update(QRectF(m_input.region.left() + position.x()*scaleX, m_input.region.top() + position.y()*scaleY,
+			tile.width()*scaleX, tile.height()*scaleY));
+}
+
+QRectF HeatmapItem::boundingRect() const
+{
+	return m_image.isNull() ? QRectF() : m_input.region;
+}
+
+void HeatmapItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+	Q_UNUSED(option)
+	Q_UNUSED(widget)
+
+	if (!m_image.isNull())
+		painter->drawImage(m_input.region, m_image);
+}
+
+QRgb HeatmapItem::evaluate(const Input& input, const QPointF& endpoint)
+{
+	QPointF endpoints[4] = {input.endpoints[0], input.endpoints[1], input.endpoints[2], input.endpoints[3]};
+	endpoints[input.sweptEndpoint] = endpoint;
+	const MyLineF line1(endpoints[0], endpoints[1]);
+	const MyLineF line2(endpoints[2], endpoints[3]);
+
+	// The functions that the GUI shows results for
+	enum { FunctionCount = 5 };
+	MyLineF::SegmentRelations relations[FunctionCount];
+	QPointF points[FunctionCount];
+	for (auto& point : points)
+		point = QPointF(Q_QNAN, Q_QNAN);
+
+	relations[0] = toSegmentRelations(line1.intersects_crossHypot(line2, &points[0]));
+	relations[1] = toSegmentRelations(line1.intersects_flsiOrig(line2, &points[1]));
+	relations[2] = toSegmentRelations(line1.intersects_flsiTweaked(line2, &points[2]));
+	relations[3] = line1.intersects_flsiV2(line2, &points[3]);
+	relations[4] = line1.intersects_gaussElim(line2, &points[4]);
+
+	const QRgb none = qRgba(0, 0, 0, 0);
+	const qreal alpha = 0.6;
+
+	switch (input.mode)
+	{
+	case Misclassified:
+	{
+		const MyLineF::SegmentRelations exact = line1.intersects_adaptive(line2);
+		if (!exact) // Invalid input
+			return none;
+
+		const auto flags = MyLineF::SegmentsIntersect | MyLineF::Parallel;
+		int nMisclassified = 0;
+		for (auto result : relations)
+			nMisclassified += (result & flags) != (exact & flags);
+		if (nMisclassified == 0)
+			return none;
+
+		// Yellow (1 function) to red (all of them)
+		const qreal hue = (1 - qreal(nMisclassified - 1)/(FunctionCount - 1)) / 6;
+		return QColor::fromHsvF(hue, 1, 1, alpha).rgba();
+	}
+
+	case PointSpread:
+	{
+		// Only the non-parallel results have a meaningful point
+		qreal spread = 0;
+		qreal magnitude = 0;
+		int nPoints = 0;
+		for (int i = 0; i < FunctionCount; ++i)
+		{
+			if (!relations[i].testFlag(MyLineF::LinesIntersect) || relations[i].testFlag(MyLineF::Parallel))
+				continue;
+
+			for (int j = 0; j < i; ++j)
+			{
+				if (relations[j].testFlag(MyLineF::LinesIntersect) && !relations[j].testFlag(MyLineF::Parallel))
+					spread = qMax(spread, std::hypot(points[i].x() - points[j].x(), points[i].y() - points[j].y()));
+			}
+			magnitude = qMax(magnitude, qMax(qAbs(points[i].x()), qAbs(points[i].y())));
+			++nPoints;
+		}
+		if (nPoints < 2 || spread == 0)
+			return none;
+
+		// Blue (about 1 ulp apart) to red (completely different points, or Inf/NaN)
+		const qreal epsilonDigits = -std::log10(std::numeric_limits<qreal>::epsilon());
+		const qreal t = std::isfinite(spread / magnitude)
+				? qBound(0.0, (std::log10(spread / magnitude) + epsilonDigits) / epsilonDigits, 1.0)
+				: 1;
+		return QColor::fromHsvF((1 - t) * 2/3, 1, 1, alpha).rgba();
+	}
+	}
+	return none;
+}
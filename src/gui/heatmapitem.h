@@ -0,0 +1,66 @@
+#ifndef HEATMAPITEM_H
+#define HEATMAPITEM_H
+
+#include <QAtomicInt>
+#include <QGraphicsItem>
+#include <QImage>
+#include <QThreadPool>
+
+/*
+	Overlay that sweeps one endpoint of the 2 segments over a region of the scene, and colours each
+	pixel by how much the intersection functions disagree when the endpoint is moved there.
+
+	The image is calculated in tiles on a thread pool, first coarsely and then at full resolution,
+	and each tile is drawn as soon as it is ready. Changing the input cancels the tiles that are
+	still running or queued.
+*/
+class HeatmapItem : public QObject, public QGraphicsItem
+{
+	Q_OBJECT
+
+signals:
+	// Emitted from the thread pool when a tile is ready
+	void tileFinished(int generation, const QPoint& position, const QImage& tile);
+
+public:
+	enum Mode
+	{
+		PointSpread,    // The largest distance between the intersection points, relative to their magnitude
+		Misclassified   // The number of functions whose SegmentsIntersect or Parallel flag differs from intersects_adaptive()
+	};
+
+	struct Input
+	{
+		QRectF region;    // In scene coordinates
+		QSize resolution; // In pixels
+		QPointF endpoints[4]; // L1 P1, L1 P2, L2 P1, L2 P2
+		int sweptEndpoint;    // Index into endpoints[], or -1 to hide the heatmap
+		QPointF offset;       // Where the endpoints are drawn, relative to their positions
+		Mode mode;
+
+		bool operator==(const Input& other) const;
+		bool operator!=(const Input& other) const { return !(*this == other); }
+	};
+
+	HeatmapItem(QGraphicsItem* parent = nullptr);
+	~HeatmapItem();
+
+	// Restarts the calculation if the input has changed
+	void setInput(const Input& input);
+
+	QRectF boundingRect() const override;
+	void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+	// The colour of one pixel
+	static QRgb evaluate(const Input& input, const QPointF& endpoint);
+
+private:
+	void addTile(int generation, const QPoint& position, const QImage& tile);
+
+	QThreadPool m_pool;
+	QAtomicInt m_generation; // Incremented on every restart; tiles from older generations are dropped
+	Input m_input;
+	QImage m_image;
+};
+
+#endif // HEATMAPITEM_H
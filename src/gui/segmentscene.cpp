@@ -0,0 +1,193 @@
+#include "segmentscene.h"
+#include "draggablecircle.h"
+
+#include <QElapsedTimer>
+#include <QGraphicsLineItem>
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+/*
+	Draws a dot at every intersection point, in one item instead of one item per point.
+	Only the points within the exposed area are drawn, so small updates stay cheap.
+*/
+class IntersectionMarkers : public QGraphicsItem
+{
+public:
+	enum { MarkerSize = 6 }; // Pixels
+
+	explicit IntersectionMarkers(const IncrementalIntersections* intersections) :
+		m_intersections(intersections)
+	{
+		m_pen.setCosmetic(true);
+		m_pen.setWidth(MarkerSize);
+		m_pen.setCapStyle(Qt::RoundCap);
+		m_pen.setColor(Qt::red);
+
+		setFlag(QGraphicsItem::ItemUsesExtendedStyleOption); // For exposedRect
+		setAcceptedMouseButtons(Qt::NoButton);
+	}
+
+	// The points are always on the segments, so the bounds of the segments are enough
+	void setBounds(const QRectF& bounds)
+	{
+		prepareGeometryChange();
+		m_bounds = bounds;
+	}
+
+	QRectF boundingRect() const override { return m_bounds; }
+
+	void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override
+	{
+		Q_UNUSED(widget)
+
+		// The markers are a fixed number of pixels wide, so include the ones just outside the exposed area
+		const qreal margin = MarkerSize / option->levelOfDetailFromTransform(painter->worldTransform());
+		const QRectF exposed = option->exposedRect.adjusted(-margin, -margin, margin, margin);
+
+		m_points.clear();
+		m_intersections->forEachIntersection([&](const SegmentIntersection& intersection)
+		{
+			if (exposed.contains(intersection.point))
+				m_points << intersection.point;
+		});
+
+		painter->setPen(m_pen);
+		painter->drawPoints(m_points.constData(), m_points.count());
+	}
+
+private:
+	const IncrementalIntersections* m_intersections;
+	QRectF m_bounds;
+	QPen m_pen;
+	QVector<QPointF> m_points; // Reused between paints
+};
+
+SegmentScene::SegmentScene(QGraphicsScene* scene) :
+	QObject(scene),
+	m_scene(scene),
+	m_markers(new IntersectionMarkers(&m_intersections)),
+	m_radius(1)
+{
+	m_markers->setZValue(1); // Above the segments
+	m_markers->setPos(m_radius, m_radius);
+	m_scene->addItem(m_markers);
+
+	m_frameTimer.setSingleShot(true);
+	m_frameTimer.setInterval(FrameInterval);
+	connect(&m_frameTimer, &QTimer::timeout, this, &SegmentScene::applyMoves);
+}
+
+void SegmentScene::setSegments(const QVector<MyLineF>& segments)
+{
+	m_frameTimer.stop();
+	m_moved.clear();
+	qDeleteAll(m_endpoints);
+	qDeleteAll(m_lines);
+	m_endpoints.clear();
+	m_lines.clear();
+
+	QElapsedTimer timer;
+	timer.start();
+	m_intersections = IncrementalIntersections(segments);
+	const qint64 nsElapsed = timer.nsecsElapsed();
+
+	m_isMoved = QVector<bool>(segments.count(), false);
+	m_endpoints.reserve(2 * segments.count());
+	m_lines.reserve(segments.count());
+
+	QPen pen;
+	pen.setCosmetic(true);
+	const QPointF shift(m_radius, m_radius);
+	QRectF bounds;
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		m_lines << m_scene->addLine(segments[i].translated(shift), pen);
+		for (const QPointF& pos : {segments[i].p1(), segments[i].p2()})
+		{
+			auto endpoint = new DraggableCircle(this);
+			endpoint->setRadius(m_radius);
+			endpoint->setPos(pos);
+			connect(endpoint, &DraggableCircle::moved, this, [=] { markMoved(i); });
+			m_scene->addItem(endpoint);
+			m_endpoints << endpoint;
+		}
+		bounds |= QRectF(segments[i].p1(), segments[i].p2()).normalized();
+	}
+	m_markers->setBounds(bounds);
+
+	reportStatistics(segments.count(), nsElapsed);
+}
+
+QRectF SegmentScene::boundingRect() const
+{
+	if (count() == 0)
+		return QRectF();
+
+	const QRectF bounds = m_markers->boundingRect();
+	return bounds.adjusted(0, 0, 2*m_radius, 2*m_radius);
+}
+
+void SegmentScene::setRadius(qreal r)
+{
+	m_radius = r;
+
+	// QGraphicsEllipseItem::pos() refers to the top-left corner of the bounding rect, like in Widget
+	const QPointF shift(r, r);
+	for (auto endpoint : m_endpoints)
+		endpoint->setRadius(r);
+	for (int i = 0; i < m_lines.count(); ++i)
+		m_lines[i]->setLine(m_intersections.segments()[i].translated(shift));
+	m_markers->setPos(shift);
+}
+
+void SegmentScene::markMoved(int index)
+{
+	if (!m_isMoved[index])
+	{
+		m_isMoved[index] = true;
+		m_moved << index;
+	}
+	if (!m_frameTimer.isActive())
+		m_frameTimer.start();
+}
+
+void SegmentScene::applyMoves()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	const QPointF shift(m_radius, m_radius);
+	QRectF bounds = m_markers->boundingRect();
+	QRectF dirty;
+	for (int index : m_moved)
+	{
+		m_isMoved[index] = false;
+
+		const QLineF oldSegment = m_intersections.segments()[index];
+		const QLineF newSegment(m_endpoints[2*index]->pos(), m_endpoints[2*index + 1]->pos());
+		m_intersections.setSegment(index, newSegment);
+		m_lines[index]->setLine(newSegment.translated(shift));
+
+		// Every intersection that appeared or disappeared is on the old or the new segment
+		const QRectF newBox = QRectF(newSegment.p1(), newSegment.p2()).normalized();
+		dirty |= QRectF(oldSegment.p1(), oldSegment.p2()).normalized() | newBox;
+		bounds |= newBox;
+	}
+	const int nMoved = m_moved.count();
+	m_moved.clear();
+
+	if (bounds != m_markers->boundingRect())
+		m_markers->setBounds(bounds);
+
+	// NOTE: The radius is 5 pixels, which covers the markers that stick out of the segments' boxes
+	m_markers->update(dirty.adjusted(-m_radius, -m_radius, m_radius, m_radius));
+
+	reportStatistics(nMoved, timer.nsecsElapsed());
+}
+
+void SegmentScene::reportStatistics(int nMoved, qint64 nsElapsed)
+{
+	emit statisticsChanged(QString("%1 segments, %2 intersections\nLast update: %3 segments in %4 ms")
+			.arg(count()).arg(m_intersections.intersectionCount()).arg(nMoved).arg(nsElapsed/1e6));
+}
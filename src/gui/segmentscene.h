@@ -0,0 +1,62 @@
+#ifndef SEGMENTSCENE_H
+#define SEGMENTSCENE_H
+
+#include "incrementalintersections.h"
+
+#include <QObject>
+#include <QTimer>
+
+class DraggableCircle;
+class IntersectionMarkers;
+class QGraphicsLineItem;
+class QGraphicsScene;
+
+/*
+	Many segments with draggable endpoints, and a marker at every point where 2 of them intersect.
+
+	The intersections are kept in an IncrementalIntersections, so dragging an endpoint only
+	re-tests the segments near it. The moves are collected and applied once per frame, and only
+	the area around the moved segments is repainted.
+
+	NOTE: The scene owns this object, so that the items which refer to it are deleted first
+*/
+class SegmentScene : public QObject
+{
+	Q_OBJECT
+
+signals:
+	void statisticsChanged(const QString& text);
+
+public:
+	enum { FrameInterval = 16 }; // Milliseconds, for 60 fps
+
+	explicit SegmentScene(QGraphicsScene* scene);
+
+	// Replaces all the segments in the scene
+	void setSegments(const QVector<MyLineF>& segments);
+	int count() const { return m_intersections.count(); }
+
+	// The bounds of the segments, including the endpoints' circles
+	QRectF boundingRect() const;
+
+	// ASSUMPTION: Like in Widget, all endpoints have the same radius
+	void setRadius(qreal r);
+
+private:
+	void markMoved(int index);
+	void applyMoves();
+	void reportStatistics(int nMoved, qint64 nsElapsed);
+
+	QGraphicsScene* m_scene;
+	IncrementalIntersections m_intersections;
+	QVector<DraggableCircle*> m_endpoints; // p1 and p2 of segment i are at 2*i and 2*i + 1
+	QVector<QGraphicsLineItem*> m_lines;
+	IntersectionMarkers* m_markers;
+	qreal m_radius;
+
+	QVector<int> m_moved; // The segments to update in the next frame
+	QVector<bool> m_isMoved;
+	QTimer m_frameTimer;
+};
+
+#endif // SEGMENTSCENE_H
@@ -1,15 +1,21 @@
 #include "widget.h"
 #include "ui_widget.h"
 #include "draggablecircle.h"
+#include "heatmapitem.h"
+#include "segmentscene.h"
 #include "mylinef.h"
 #include "tests.h"
 
 #include <QGraphicsLineItem>
 #include <QLineEdit>
+#include <QScrollBar>
+#include <QTimer>
+#include <QtMath>
 
 #include <QDebug>
 
 #include <cmath>
+#include <random>
 
 Widget::Widget(QSplitter *parent) :
 	QSplitter(parent),
@@ -17,7 +23,9 @@ Widget::Widget(QSplitter *parent) :
 	l1p1(new DraggableCircle(this)),
 	l1p2(new DraggableCircle(this)),
 	l2p1(new DraggableCircle(this)),
-	l2p2(new DraggableCircle(this))
+	l2p2(new DraggableCircle(this)),
+	heatmap(new HeatmapItem),
+	updateTimer(new QTimer(this))
 {
 	ui->setupUi(this);
 
@@ -34,6 +42,22 @@ Widget::Widget(QSplitter *parent) :
 	scene->addItem(l2p1);
 	scene->addItem(l2p2);
 
+	heatmap->setZValue(-1); // Below the segments
+	scene->addItem(heatmap);
+
+	segmentScene = new SegmentScene(scene);
+	connect(segmentScene, &SegmentScene::statisticsChanged, ui->label_sceneStatistics, &QLabel::setText);
+	connect(ui->pb_loadSegments, &QPushButton::clicked, this, &Widget::loadRandomSegments);
+	connect(ui->pb_clearSegments, &QPushButton::clicked, [=]
+	{
+		segmentScene->setSegments(QVector<MyLineF>());
+		updateSegments();
+	});
+
+	updateTimer->setSingleShot(true);
+	updateTimer->setInterval(SegmentScene::FrameInterval);
+	connect(updateTimer, &QTimer::timeout, this, &Widget::updateSegments);
+
 	l1p1->setPos(-1, -1);
 	l1p2->setPos( 1,  1);
 	l2p1->setPos(-1,  1);
@@ -47,7 +71,7 @@ Widget::Widget(QSplitter *parent) :
 		auto updateAllShapes = [=]()->void
 		{
 			c->setPos(xBox->value(), yBox->value());
-			this->updateSegments();
+			this->scheduleUpdate();
 		};
 
 		QObject::connect(xBox, qOverload<double>(&QDoubleSpinBox::valueChanged), updateAllShapes);
@@ -80,6 +104,13 @@ Widget::Widget(QSplitter *parent) :
 		ui->dsb_l2y2->setValue(coords.l2y2);
 	});
 
+	// The heatmap covers the visible part of the scene
+	connect(ui->cb_heatmapEndpoint, qOverload<int>(&QComboBox::currentIndexChanged), this, &Widget::updateHeatmap);
+	connect(ui->cb_heatmapMode, qOverload<int>(&QComboBox::currentIndexChanged), this, &Widget::updateHeatmap);
+	connect(ui->graphicsView->horizontalScrollBar(), &QScrollBar::valueChanged, this, &Widget::updateHeatmap);
+	connect(ui->graphicsView->verticalScrollBar(), &QScrollBar::valueChanged, this, &Widget::updateHeatmap);
+	connect(this, &QSplitter::splitterMoved, this, &Widget::updateHeatmap);
+
 	connect(ui->slider_zoom, &QSlider::valueChanged,
 			this, &Widget::setZoomLevel);
 	ui->slider_zoom->setValue(6);
@@ -99,13 +130,29 @@ void Widget::setZoomLevel(int zoom)
 	l1p2->setRadius(r);
 	l2p1->setRadius(r);
 	l2p2->setRadius(r);
+	segmentScene->setRadius(r);
 
 	updateSegments();
 	ui->graphicsView->setTransform( QTransform::fromScale(scale, scale) );
+	updateHeatmap();
+}
+
+void Widget::resizeEvent(QResizeEvent* event)
+{
+	QSplitter::resizeEvent(event);
+	updateHeatmap();
+}
+
+void Widget::scheduleUpdate()
+{
+	if (!updateTimer->isActive())
+		updateTimer->start();
 }
 
 void Widget::updateSegments()
 {
+	updateTimer->stop();
+
 	MyLineF myLine1(l1p1->pos(), l1p2->pos());
 	MyLineF myLine2(l2p1->pos(), l2p2->pos());
 
@@ -147,7 +194,57 @@ void Widget::updateSegments()
 	auto xBounds = std::minmax({myLine1.p1().x(), myLine1.p2().x(), myLine2.p1().x(), myLine2.p2().x()});
 	auto yBounds = std::minmax({myLine1.p1().y(), myLine1.p2().y(), myLine2.p1().y(), myLine2.p2().y()});
 	QRectF bounds(QPointF(xBounds.first, yBounds.first), QPointF(xBounds.second+2*r, yBounds.second+2*r));
+	if (segmentScene->count() > 0)
+		bounds |= segmentScene->boundingRect();
 	ui->graphicsView->setSceneRect( bounds );
+
+	updateHeatmap();
+}
+
+void Widget::updateHeatmap()
+{
+	const QRect viewport = ui->graphicsView->viewport()->rect();
+	const qreal r = l1p1->radius();
+
+	HeatmapItem::Input input;
+	input.region = ui->graphicsView->mapToScene(QRectF(viewport)).boundingRect();
+	input.resolution = viewport.size();
+	input.endpoints[0] = l1p1->pos();
+	input.endpoints[1] = l1p2->pos();
+	input.endpoints[2] = l2p1->pos();
+	input.endpoints[3] = l2p2->pos();
+	input.sweptEndpoint = ui->cb_heatmapEndpoint->currentIndex() - 1; // The first item is "<None>"
+	input.offset = QPointF(r, r);
+	input.mode = static_cast<HeatmapItem::Mode>(ui->cb_heatmapMode->currentIndex());
+	heatmap->setInput(input);
+}
+
+/*
+	Fills the visible part of the view with random segments, like getRandomSegments() in tests.cpp:
+	Uniformly distributed start points, directions and lengths, with about 1 intersection per
+	segment.
+*/
+void Widget::loadRandomSegments()
+{
+	const QRectF region = ui->graphicsView->mapToScene(QRectF(ui->graphicsView->viewport()->rect())).boundingRect();
+	const int nSegments = ui->sb_segmentCount->value();
+
+	std::mt19937 rng(nSegments);
+	std::uniform_real_distribution<qreal> position(0, 1);
+	std::uniform_real_distribution<qreal> angle(0, 2*M_PI);
+	std::uniform_real_distribution<qreal> length(0, 2*qMin(region.width(), region.height())/std::sqrt(qreal(nSegments)));
+
+	QVector<MyLineF> segments;
+	segments.reserve(nSegments);
+	for (int i = 0; i < nSegments; ++i)
+	{
+		const QPointF p1(region.left() + position(rng)*region.width(), region.top() + position(rng)*region.height());
+		const qreal a = angle(rng);
+		const qreal l = length(rng);
+		segments << MyLineF(p1, p1 + l*QPointF(std::cos(a), std::sin(a)));
+	}
+	segmentScene->setSegments(segments);
+	updateSegments();
 }
 
 //=============
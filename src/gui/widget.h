@@ -2,9 +2,12 @@
 #define WIDGET_H
 
 class DraggableCircle;
+class HeatmapItem;
+class SegmentScene;
 class QGraphicsLineItem;
 class QLabel;
 class QLineEdit;
+class QTimer;
 
 #include <QSplitter>
 #include "mylinef.h"
@@ -21,9 +24,15 @@ public:
 	Widget(QSplitter *parent = nullptr);
 	~Widget();
 
+protected:
+	void resizeEvent(QResizeEvent* event) override;
+
 private:
 	void setZoomLevel(int zoom);
+	void scheduleUpdate();
 	void updateSegments();
+	void updateHeatmap();
+	void loadRandomSegments();
 
 	Ui::Widget *ui;
 	DraggableCircle* l1p1;
@@ -32,6 +41,9 @@ private:
 	DraggableCircle* l2p2;
 	QGraphicsLineItem* l1;
 	QGraphicsLineItem* l2;
+	HeatmapItem* heatmap;
+	SegmentScene* segmentScene;
+	QTimer* updateTimer; // Collects the spin boxes' changes into one update per frame
 };
 
 
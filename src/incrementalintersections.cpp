@@ -0,0 +1,191 @@
+#include "incrementalintersections.h"
+#include "uniformgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Segments that pass through more cells are kept in the oversized list instead
+const int maxCellsPerSegment = 256;
+
+// Columns and rows can be negative
+quint64 cellKey(qint64 column, qint64 row)
+{
+	return (quint64(quint32(qint32(column))) << 32) | quint32(qint32(row));
+}
+
+}
+
+IncrementalIntersections::IncrementalIntersections(const QVector<MyLineF>& segments,
+		AllPairs::RelationFunc relationFunc, qreal cellSize) :
+	m_relationFunc(relationFunc),
+	m_cellSize(cellSize > 0 ? cellSize : UniformGrid::autoCellSize(segments)),
+	m_segments(segments),
+	m_states(segments.count(), Unbinned),
+	m_segmentCells(segments.count()),
+	m_partners(segments.count()),
+	m_mailbox(segments.count(), 0),
+	m_stamp(0)
+{
+	// Each segment is only tested against the ones inserted before it, so every pair is tested once
+	int nCandidates = 0;
+	for (int i = 0; i < segments.count(); ++i)
+		insert(i, &nCandidates);
+}
+
+int IncrementalIntersections::setSegment(int index, const QLineF& segment)
+{
+	remove(index);
+	m_segments[index] = MyLineF(segment.p1(), segment.p2());
+
+	int nCandidates = 0;
+	insert(index, &nCandidates);
+	return nCandidates;
+}
+
+QVector<SegmentIntersection> IncrementalIntersections::intersections() const
+{
+	QVector<SegmentIntersection> results;
+	results.reserve(m_intersections.count());
+	forEachIntersection([&](const SegmentIntersection& intersection) { results << intersection; });
+	return results;
+}
+
+/*
+	Finds the cells that the segment passes through, with the same DDA traversal as
+	UniformGrid::forEachCell(), but without bounds. Returns false if there are more than
+	maxCellsPerSegment of them.
+*/
+bool IncrementalIntersections::findCells(const QLineF& segment, QVector<quint64>* cells) const
+{
+	const qreal tolerance = 1e-9; // In units of cells
+	const qreal maxCoordinate = 1 << 30; // Keeps the cell coordinates within 32 bits
+
+	qreal u1 = segment.x1() / m_cellSize;
+	qreal v1 = segment.y1() / m_cellSize;
+	qreal u2 = segment.x2() / m_cellSize;
+	qreal v2 = segment.y2() / m_cellSize;
+	if (std::max({qAbs(u1), qAbs(v1), qAbs(u2), qAbs(v2)}) > maxCoordinate)
+		return false;
+
+	// Step along the major axis (u), from low to high
+	const bool steep = qAbs(v2 - v1) > qAbs(u2 - u1);
+	if (steep)
+	{
+		std::swap(u1, v1);
+		std::swap(u2, v2);
+	}
+	if (u1 > u2)
+	{
+		std::swap(u1, u2);
+		std::swap(v1, v2);
+	}
+	const qreal slope = (u2 > u1) ? (v2 - v1) / (u2 - u1) : 0;
+
+	cells->clear();
+	const qint64 firstMajor = qint64(std::floor(u1 - tolerance));
+	const qint64 lastMajor = qint64(std::floor(u2 + tolerance));
+	for (qint64 major = firstMajor; major <= lastMajor; ++major)
+	{
+		// The part of the segment within this column
+		const qreal ua = qBound(u1, qreal(major), u2);
+		const qreal ub = qBound(u1, qreal(major + 1), u2);
+		const qreal va = v1 + (ua - u1) * slope;
+		const qreal vb = v1 + (ub - u1) * slope;
+
+		const qint64 firstMinor = qint64(std::floor(qMin(va, vb) - tolerance));
+		const qint64 lastMinor = qint64(std::floor(qMax(va, vb) + tolerance));
+		if (cells->count() + (lastMinor - firstMinor + 1) > maxCellsPerSegment)
+			return false;
+
+		for (qint64 minor = firstMinor; minor <= lastMinor; ++minor)
+			*cells << (steep ? cellKey(minor, major) : cellKey(major, minor));
+	}
+	return true;
+}
+
+// Bins the segment, and tests it against every segment that it shares a cell with
+void IncrementalIntersections::insert(int index, int* candidateCount)
+{
+	if (AllPairs::isDegenerate(m_segments[index]))
+		return;
+
+	++m_stamp;
+	m_mailbox[index] = m_stamp;
+
+	if (!findCells(m_segments[index], &m_segmentCells[index]))
+	{
+		m_segmentCells[index].clear();
+		for (int other = 0; other < m_segments.count(); ++other)
+		{
+			if (m_states[other] != Unbinned)
+				testPair(index, other, candidateCount);
+		}
+		m_states[index] = Oversized;
+		m_oversized << index;
+		return;
+	}
+
+	for (quint64 cell : m_segmentCells[index])
+	{
+		QVector<int>& members = m_cells[cell];
+		for (int other : members)
+		{
+			if (m_mailbox[other] == m_stamp)
+				continue;
+			m_mailbox[other] = m_stamp;
+			testPair(index, other, candidateCount);
+		}
+		members << index;
+	}
+
+	// The oversized segments aren't in any cell
+	for (int other : m_oversized)
+		testPair(index, other, candidateCount);
+	m_states[index] = Binned;
+}
+
+// Unbins the segment, and forgets all of its intersections
+void IncrementalIntersections::remove(int index)
+{
+	if (m_states[index] == Binned)
+	{
+		for (quint64 cell : m_segmentCells[index])
+		{
+			const auto it = m_cells.find(cell);
+			it->removeOne(index);
+			if (it->isEmpty())
+				m_cells.erase(it);
+		}
+		m_segmentCells[index].clear();
+	}
+	else if (m_states[index] == Oversized)
+		m_oversized.removeOne(index);
+	m_states[index] = Unbinned;
+
+	for (int partner : m_partners[index])
+	{
+		m_intersections.remove(pairKey(qMin(index, partner), qMax(index, partner)));
+		m_partners[partner].removeOne(index);
+	}
+	m_partners[index].clear();
+}
+
+// Tests the pair in the same order as AllPairs::bruteForce(), so the results are identical
+void IncrementalIntersections::testPair(int index, int other, int* candidateCount)
+{
+	const int index1 = qMin(index, other);
+	const int index2 = qMax(index, other);
+	++*candidateCount;
+
+	QPointF point(Q_QNAN, Q_QNAN);
+	const auto relations = (m_segments[index1].*m_relationFunc)(m_segments[index2], &point);
+	if (!relations.testFlag(MyLineF::SegmentsIntersect))
+		return;
+
+	m_intersections.insert(pairKey(index1, index2), SegmentIntersection{index1, index2, relations, point});
+	m_partners[index1] << index2;
+	m_partners[index2] << index1;
+}
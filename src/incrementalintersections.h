@@ -0,0 +1,78 @@
+#ifndef INCREMENTALINTERSECTIONS_H
+#define INCREMENTALINTERSECTIONS_H
+
+#include "allpairs.h"
+
+#include <QHash>
+
+/*
+	Keeps every intersecting pair among a set of line segments up to date while the segments move,
+	e.g. while the user drags their endpoints around.
+
+	The segments are binned into a spatial hash: A uniform grid without bounds, whose cells only
+	exist while they are occupied. Moving one segment re-bins it and only re-tests the segments
+	that share a cell with it. Segments that would cover too many cells are kept in a separate
+	list instead, and tested against every other segment.
+*/
+class IncrementalIntersections
+{
+public:
+	// If cellSize <= 0, it is chosen by UniformGrid::autoCellSize()
+	explicit IncrementalIntersections(const QVector<MyLineF>& segments = QVector<MyLineF>(),
+			AllPairs::RelationFunc relationFunc = &MyLineF::intersects_flsiV2, qreal cellSize = 0);
+
+	int count() const { return m_segments.count(); }
+	const QVector<MyLineF>& segments() const { return m_segments; }
+	qreal cellSize() const { return m_cellSize; }
+
+	/*
+		Replaces segment `index`, and re-tests it against the segments that share a cell with it.
+		Returns the number of pairs that were passed to relationFunc().
+	*/
+	int setSegment(int index, const QLineF& segment);
+
+	// Same output as AllPairs::bruteForce() on segments(), in an unspecified order
+	QVector<SegmentIntersection> intersections() const;
+	int intersectionCount() const { return m_intersections.count(); }
+
+	// Calls func(const SegmentIntersection&) for every intersecting pair, without copying them
+	template <typename Func>
+	void forEachIntersection(Func func) const
+	{
+		for (const auto& intersection : m_intersections)
+			func(intersection);
+	}
+
+private:
+	enum State : char
+	{
+		Unbinned, // Degenerate (see AllPairs::isDegenerate()), or not inserted yet
+		Binned,
+		Oversized
+	};
+
+	static quint64 pairKey(int index1, int index2) { return (quint64(quint32(index1)) << 32) | quint32(index2); }
+
+	bool findCells(const QLineF& segment, QVector<quint64>* cells) const;
+	void insert(int index, int* candidateCount);
+	void remove(int index);
+	void testPair(int index, int other, int* candidateCount);
+
+	AllPairs::RelationFunc m_relationFunc;
+	qreal m_cellSize;
+
+	QVector<MyLineF> m_segments;
+	QVector<State> m_states;
+	QVector<QVector<quint64>> m_segmentCells; // The cells that each Binned segment is in
+	QHash<quint64, QVector<int>> m_cells;     // The segments in each occupied cell
+	QVector<int> m_oversized;
+
+	QHash<quint64, SegmentIntersection> m_intersections; // Keyed by pairKey(index1, index2)
+	QVector<QVector<int>> m_partners;                   // The segments that each segment intersects
+
+	// Deduplicates the candidates of one insert(), as in UniformGrid::findAllIntersections()
+	QVector<int> m_mailbox;
+	int m_stamp;
+};
+
+#endif // INCREMENTALINTERSECTIONS_H
@@ -1,31 +1,226 @@
 #include "gui/widget.h"
+#include "benchmarkresults.h"
 #include "tests.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QMetaEnum>
+#include <QTextStream>
 
-#define DO_BENCHMARKS
+#include <limits>
+
+// The benchmarks don't need a display, so only the GUI gets a QApplication
+static bool isBenchmarkMode(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const QString arg = QString::fromLocal8Bit(argv[i]);
+		if (arg.startsWith("--benchmark") || arg == "--help" || arg == "-h")
+			return true;
+	}
+	return false;
+}
+
+// Exit codes
+enum
+{
+	Success = 0,
+	RegressionFound = 1,
+	InvalidUsage = 2
+};
+
+static int runBenchmarks(const QCoreApplication& app)
+{
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Without --benchmark, shows the interactive GUI.");
+	parser.addHelpOption();
+	parser.addOptions(
+	{
+		{"benchmark", "Runs the benchmarks instead of the GUI: A comma-separated list of speed, classify, workingset, accuracy, batch, quantized, allpairs, onevsmany, grid and worstcase.", "list"},
+		{"algorithms", QString("Comma-separated list of functions for the speed, accuracy and batch benchmarks and the worst-case search (default: all): %1.")
+				.arg(Benchmarker::algorithmNames().join(", ")), "list"},
+		{"categories", "Comma-separated list of Benchmarker::Category names (default: all).", "list"},
+		{"iterations", "Calls per function per category in the speed and batch benchmarks, and evaluations per function per objective in the worst-case search.", "n", "10000000"},
+		{"samples", "Timed samples per function per category.", "n", "100"},
+		{"cases", "Test cases per random category.", "n", "100000"},
+		{"seed", "Seed for the random categories.", "n", "1"},
+		{"threads", "Threads for test case generation and the accuracy benchmarks.", "n", QString::number(QThread::idealThreadCount())},
+		{"max-sweep-size", "Largest working set of the working-set and quantized benchmarks, in MiB (default: 8 times the last-level cache, up to 1024).", "MiB"},
+		{"corpus", "Replays a recorded corpus file as the Corpus category.", "file"},
+		{"no-perf", "Doesn't read hardware performance counters."},
+		{"output", "Writes the results of the benchmarks to a file; allpairs, onevsmany, grid and worstcase only print theirs.", "file"},
+		{"format", "Format of --output: json or csv.", "format", "json"},
+		{"baseline", "Compares the results with a JSON file from an earlier --output, and exits with code 1 if any are worse.", "file"},
+		{"max-slowdown", "Allowed increase in the median time per call, in percent.", "percent", "10"},
+		{"max-ulps-increase", "Allowed increase in the worst point error, in ulps.", "ulps", "0"},
+		{"max-misclassified-increase", "Allowed increase in the number of misclassified test cases.", "n", "0"}
+	});
+	parser.process(app);
+
+	QTextStream err(stderr);
+	bool allOk = true;
+	// Returns 0 for invalid values, so that the caller's conversion to the target type never overflows
+	auto toNumber = [&](const QString& option, qreal max = std::numeric_limits<qreal>::max()) -> qreal
+	{
+		bool ok;
+		const qreal value = parser.value(option).toDouble(&ok);
+		if (!ok || !(value >= 0 && value <= max))
+		{
+			err << QString("Invalid --%1: %2\n").arg(option).arg(parser.value(option));
+			allOk = false;
+			return 0;
+		}
+		return value;
+	};
+
+	const qreal maxInt = std::numeric_limits<int>::max();
+	Benchmarker benchmarker;
+	benchmarker.setIterationsPerFunction(int(toNumber("iterations", maxInt)));
+	benchmarker.setSamplesPerFunction(qMax(1, int(toNumber("samples", maxInt))));
+	benchmarker.setMonteCarloCaseCount(int(toNumber("cases", maxInt)));
+	benchmarker.setRandomSeed(uint(toNumber("seed", std::numeric_limits<uint>::max())));
+	benchmarker.setThreadCount(qMax(1, int(toNumber("threads", maxInt))));
+	benchmarker.setPerfCountersEnabled(!parser.isSet("no-perf"));
+	if (parser.isSet("max-sweep-size"))
+	{
+		// NOTE: At most 2^42 MiB, so that the size in bytes fits in a qint64
+		benchmarker.setMaxSweepSize(qint64(toNumber("max-sweep-size", qreal(quint64(1) << 42)) * 1024 * 1024));
+	}
+	if (parser.isSet("corpus"))
+		benchmarker.setCorpusFile(parser.value("corpus"));
+
+	if (parser.isSet("algorithms"))
+	{
+		const QStringList algorithms = parser.value("algorithms").split(',');
+		for (auto name : algorithms)
+		{
+			if (!Benchmarker::algorithmNames().contains(name))
+			{
+				err << QString("Unknown algorithm: %1\n").arg(name);
+				allOk = false;
+			}
+		}
+		benchmarker.setAlgorithms(algorithms);
+	}
+
+	if (parser.isSet("categories"))
+	{
+		const auto categoryEnum = QMetaEnum::fromType<Benchmarker::Category>();
+		QVector<Benchmarker::Category> categories;
+		for (auto name : parser.value("categories").split(','))
+		{
+			bool ok;
+			const int value = categoryEnum.keyToValue(name.toLatin1().constData(), &ok);
+			if (ok)
+				categories << static_cast<Benchmarker::Category>(value);
+			else
+			{
+				err << QString("Unknown category: %1\n").arg(name);
+				allOk = false;
+			}
+		}
+		benchmarker.setCategories(categories);
+	}
+
+	const QStringList knownBenchmarks{"speed", "classify", "workingset", "accuracy", "batch", "quantized", "allpairs", "onevsmany", "grid", "worstcase"};
+	const QStringList benchmarks = parser.value("benchmark").split(',');
+	for (auto name : benchmarks)
+	{
+		if (!knownBenchmarks.contains(name))
+		{
+			err << QString("Unknown benchmark: %1\n").arg(name);
+			allOk = false;
+		}
+	}
+
+	const QString format = parser.value("format");
+	if (format != "json" && format != "csv")
+	{
+		err << QString("Unknown format: %1\n").arg(format);
+		allOk = false;
+	}
+
+	BenchmarkResults::Thresholds thresholds;
+	thresholds.maxSlowdown = toNumber("max-slowdown") / 100;
+	thresholds.maxUlpsIncrease = toNumber("max-ulps-increase");
+	thresholds.maxMisclassifiedIncrease = qint64(toNumber("max-misclassified-increase", qreal(quint64(1) << 62)));
+
+	// Load the baseline first, so that a bad file doesn't waste a whole run
+	BenchmarkResults baseline;
+	QString errorString;
+	if (parser.isSet("baseline") && !baseline.load(parser.value("baseline"), &errorString))
+	{
+		err << errorString << '\n';
+		allOk = false;
+	}
+
+	if (!allOk)
+		return InvalidUsage;
+
+	BenchmarkResults results;
+	for (auto option : {"benchmark", "algorithms", "categories", "iterations", "samples", "cases", "seed", "threads", "corpus"})
+		results.setConfig(option, parser.value(option));
+	benchmarker.setResults(&results);
+
+	if (benchmarks.contains("speed"))
+		benchmarker.runSpeedBenchmarks();
+	if (benchmarks.contains("classify"))
+		benchmarker.runClassifyBenchmarks();
+	if (benchmarks.contains("workingset"))
+		benchmarker.runWorkingSetBenchmarks();
+	if (benchmarks.contains("accuracy"))
+		benchmarker.runAccuracyBenchmarks();
+	if (benchmarks.contains("batch"))
+		benchmarker.runBatchBenchmarks();
+	if (benchmarks.contains("quantized"))
+		benchmarker.runQuantizedBenchmarks();
+	if (benchmarks.contains("allpairs"))
+		benchmarker.runAllPairsBenchmarks();
+	if (benchmarks.contains("onevsmany"))
+		benchmarker.runOneVsManyBenchmarks();
+	if (benchmarks.contains("grid"))
+		benchmarker.runGridBenchmarks();
+	if (benchmarks.contains("worstcase"))
+		benchmarker.runWorstCaseSearch();
+
+	if (parser.isSet("output"))
+	{
+		const auto outputFormat = (format == "csv") ? BenchmarkResults::Csv : BenchmarkResults::Json;
+		if (!results.save(parser.value("output"), outputFormat, &errorString))
+		{
+			err << errorString << '\n';
+			return InvalidUsage;
+		}
+	}
+
+	if (parser.isSet("baseline"))
+	{
+		// NOTE: Different settings make the comparison meaningless, but they might be deliberate
+		if (baseline.config() != results.config())
+			err << "Warning: The baseline was run with different settings\n";
+
+		const QStringList regressions = results.regressionsFrom(baseline, thresholds);
+		for (auto regression : regressions)
+			err << "Regression: " << regression << '\n';
+		if (!regressions.isEmpty())
+			return RegressionFound;
+	}
+
+	return Success;
+}
 
 int main(int argc, char *argv[])
 {
-#ifndef DO_BENCHMARKS
+	if (isBenchmarkMode(argc, argv))
+	{
+		QCoreApplication app(argc, argv);
+		return runBenchmarks(app);
+	}
+
 	QApplication app(argc, argv);
 
 	Widget w;
 	w.show();
 
 	return app.exec();
-#else
-	Q_UNUSED(argc)
-	Q_UNUSED(argv)
-
-	Benchmarker benchmarker;
-	benchmarker.setIterationsPerFunction(10000000);
-	benchmarker.setMonteCarloCaseCount(100000);
-	benchmarker.setRandomSeed(1);
-
-	benchmarker.runSpeedBenchmarks();
-	benchmarker.runAccuracyBenchmarks();
-
-	return 0;
-#endif
 }
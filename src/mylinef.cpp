@@ -1,5 +1,7 @@
 #include "algorithms.h"
+#include "exactpredicates.h"
 #include "mylinef.h"
+#include "pathcounters.h"
 
 #include <cmath>
 
@@ -47,7 +49,11 @@ MyLineF::SegmentRelations MyLineF::intersects_gaussElim(const QLineF &l, QPointF
 		// Check if the origin point is the same (thus the segments lie on the same line)
 		QPointF r = { std::fma(n, dir.x(), origin.x()), std::fma(n, dir.y(), origin.y()) };
 		if (qAbs(r.x() * lorigin.y() - r.y() * lorigin.x()) > 2 * std::numeric_limits<qreal>::epsilon() * qAbs(lorigin.x() * lorigin.y()))
+		{
+			PATHCOUNTERS_COUNT(GaussElim_RankDeficientParallel);
 			return Parallel;
+		}
+		PATHCOUNTERS_COUNT(GaussElim_RankDeficientCollinear);
 
 		// Solve for the end point
 		qreal n2 = pivot * (matrix[0][2] - matrix[0][1]);
@@ -83,6 +89,7 @@ MyLineF::SegmentRelations MyLineF::intersects_gaussElim(const QLineF &l, QPointF
 	}
 
 	// We are not near-singular, back-substitute normally
+	PATHCOUNTERS_COUNT(GaussElim_BackSubstitution);
 	qreal nb = matrix[1][2] / matrix[1][1];
 	// Calculate the actual intersection point only if we need to
 	if (intersectionPoint)
@@ -100,6 +107,7 @@ MyLineF::SegmentRelations MyLineF::intersects_gaussElim(const QLineF &l, QPointF
 	Implementation copied from QLineF::intersects() in Qt 5.14.1, except:
 	- Replaced private member access with public getters, e.g. QLineF::pt1 -> QLineF::p1()
 	- Replaced private function: qt_is_finite() -> std::isfinite()
+	- Added PATHCOUNTERS_COUNT() (compiled out unless PATHCOUNTERS_ENABLED is defined)
 
 	Based on Franklin Antonio's "Faster Line Segment Intersection" algorithm from the book
 	"Graphics Gems III".
@@ -116,7 +124,14 @@ MyLineF::intersects_flsiOrig(const QLineF &l, QPointF *intersectionPoint) const
 
 	const qreal denominator = a.y() * b.x() - a.x() * b.y();
 	if (denominator == 0 || !std::isfinite(denominator))
+	{
+		if (denominator == 0)
+			PATHCOUNTERS_COUNT(FlsiOrig_Parallel);
+		else
+			PATHCOUNTERS_COUNT(FlsiOrig_Invalid);
 		return NoIntersection;
+	}
+	PATHCOUNTERS_COUNT(FlsiOrig_NotParallel);
 
 	const qreal reciprocal = 1 / denominator;
 	const qreal na = (b.y() * c.x() - b.x() * c.y()) * reciprocal;
@@ -150,11 +165,18 @@ MyLineF::intersects_flsiTweaked(const QLineF &l, QPointF *intersectionPoint) con
 	const qreal d2 = a.x() * b.y();
 
 	if (  Algo::robustFuzzyCompare( d1, d2, Algo::findTolerance(a, b) )  ) // Parallel
+	{
+		PATHCOUNTERS_COUNT(FlsiTweaked_Parallel);
 		return NoIntersection;
+	}
 
 	const qreal denominator = d1 - d2;
 	if (!std::isfinite(denominator)) // Invalid input: NaN or Inf in at least 1 point
+	{
+		PATHCOUNTERS_COUNT(FlsiTweaked_Invalid);
 		return NoIntersection;
+	}
+	PATHCOUNTERS_COUNT(FlsiTweaked_NotParallel);
 
 	const qreal nna = b.y() * c.x() - b.x() * c.y();
 
@@ -176,21 +198,17 @@ MyLineF::intersects_flsiTweaked(const QLineF &l, QPointF *intersectionPoint) con
 }
 
 /*
-	Modified version of MyLineF::intersects_flsiTweaked()
-	- Illustrates a more descriptive result than QLineF::IntersectionType
-		- Differentiates between parallel and non-parallel segments
-		- Differentiates between collinear and non-collinear parallel segments
-		- Returns a null result if input is invalid
-	- Outputs an intersection point for collinear segments
-		- Either the midpoint of the overlap, or the midpoint of the gap
+	The body of MyLineF::intersects_flsiV2() and MyLineF::classify_flsiV2(). Without WithPoint, the
+	intersection point is never calculated, so the pointer checks are compiled out.
 */
-MyLineF::SegmentRelations
-MyLineF::intersects_flsiV2(const QLineF& l, QPointF* intersectionPoint) const
+template <bool WithPoint>
+static inline MyLineF::SegmentRelations
+flsiV2(const QLineF& l1, const QLineF& l, QPointF* intersectionPoint)
 {
 	// Implementation is based on Graphics Gems III's "Faster Line Segment Intersection"
-	const QPointF a = p2() - p1();
+	const QPointF a = l1.p2() - l1.p1();
 	const QPointF b = l.p1() - l.p2();
-	const QPointF c = p1() - l.p1();
+	const QPointF c = l1.p1() - l.p1();
 
 	const qreal tolerance = Algo::findTolerance(a, b);
 
@@ -199,7 +217,10 @@ MyLineF::intersects_flsiV2(const QLineF& l, QPointF* intersectionPoint) const
 	const qreal denominator = d1 - d2;
 
 	if (!std::isfinite(denominator)) // Invalid input: At least 1 point contains NaN or Inf
-		return SegmentRelations();   // TODO: Set intersection to QPointF(Q_QNAN, Q_QNAN)?
+	{
+		PATHCOUNTERS_COUNT(FlsiV2_Invalid);
+		return MyLineF::SegmentRelations();   // TODO: Set intersection to QPointF(Q_QNAN, Q_QNAN)?
+	}
 
 	// TODO: Treat inputs as invalid if any of the segments are zero-length?
 
@@ -209,21 +230,339 @@ MyLineF::intersects_flsiV2(const QLineF& l, QPointF* intersectionPoint) const
 	if ( Algo::robustFuzzyCompare(d1, d2, tolerance) ) // Parallel
 	{
 		if ( Algo::robustFuzzyCompare(na1, na2, tolerance) ) // Collinear
-			return Algo::analyzeCollinearSegments(*this, l, intersectionPoint);
-		return Parallel; // TODO: Set intersection to QPointF(Q_QNAN, Q_QNAN)?
+		{
+			PATHCOUNTERS_COUNT(FlsiV2_Collinear);
+			return Algo::analyzeCollinearSegments(l1, l, WithPoint ? intersectionPoint : nullptr);
+		}
+		PATHCOUNTERS_COUNT(FlsiV2_Parallel);
+		return MyLineF::Parallel; // TODO: Set intersection to QPointF(Q_QNAN, Q_QNAN)?
 	}
 
 	const qreal nna = na1 - na2;
 
 	// NOTE: The following calculation is unstable if `denominator` is small.
-	//       `denominator` approaches 0 as abs(this->angle()) approaches abs(l.angle())
+	//       `denominator` approaches 0 as abs(l1.angle()) approaches abs(l.angle())
 	// TODO: Investigate the effects of enforcing an order of operations
 	//       (e.g. (a*nna)/denominator ) and/or "pivoting" by swapping points earlier
-	if (intersectionPoint)
-		*intersectionPoint = p1() + a * (nna / denominator); // TODO: Use std::fma()?
+	if (WithPoint && intersectionPoint)
+		*intersectionPoint = l1.p1() + a * (nna / denominator); // TODO: Use std::fma()?
 
 	// Equivalent to but more stable than
 	// (nna/denominator) < 0 || (nna/denominator) > 1
+	if (   (  denominator>0  &&  ( nna<0 || nna>denominator )  )
+		|| (  denominator<0  &&  ( nna>0 || nna<denominator )  )   )
+	{
+		PATHCOUNTERS_COUNT(FlsiV2_OutsideSegment1);
+		return MyLineF::LinesIntersect;
+	}
+
+	const qreal nnb = a.x() * c.y() - a.y() * c.x();
+	if (   (  denominator>0  &&  ( nnb<0 || nnb>denominator )  )
+		|| (  denominator<0  &&  ( nnb>0 || nnb<denominator )  )   )
+	{
+		PATHCOUNTERS_COUNT(FlsiV2_OutsideSegment2);
+		return MyLineF::LinesIntersect;
+	}
+
+	PATHCOUNTERS_COUNT(FlsiV2_SegmentsIntersect);
+	return MyLineF::LinesIntersect | MyLineF::SegmentsIntersect;
+}
+
+/*
+	Modified version of MyLineF::intersects_flsiTweaked()
+	- Illustrates a more descriptive result than QLineF::IntersectionType
+		- Differentiates between parallel and non-parallel segments
+		- Differentiates between collinear and non-collinear parallel segments
+		- Returns a null result if input is invalid
+	- Outputs an intersection point for collinear segments
+		- Either the midpoint of the overlap, or the midpoint of the gap
+*/
+MyLineF::SegmentRelations
+MyLineF::intersects_flsiV2(const QLineF& l, QPointF* intersectionPoint) const
+{
+	return flsiV2<true>(*this, l, intersectionPoint);
+}
+
+/*
+	Same relations as MyLineF::intersects_flsiV2(), without the intersection point. Every test is a
+	comparison of products, so this is intersects_flsiV2(l, nullptr) without the pointer checks.
+*/
+MyLineF::SegmentRelations
+MyLineF::classify_flsiV2(const QLineF& l) const
+{
+	return flsiV2<false>(*this, l, nullptr);
+}
+
+/*
+	The relations of MyLineF::intersects_gaussElim(), without its divisions: It pivots the same
+	way, but instead of eliminating with 1/pivot, it compares Cramer's rule numerators with the
+	determinant (which is the eliminated matrix[1][1] times the pivot).
+
+	NOTE: The rank test and the parameter ranges are mathematically the same as in
+	      intersects_gaussElim(), but they are rounded differently, so the results can differ for
+	      pairs that are within a few ulps of a boundary
+	NOTE: Products of the matrix entries overflow (or underflow) long before the quotients of
+	      intersects_gaussElim() do, so a matrix whose pivot is very large or very small is first
+	      scaled by a power of 2. That is exact, and changes none of the ratios.
+*/
+MyLineF::SegmentRelations
+MyLineF::classify_gaussElim(const QLineF& l) const
+{
+	QPointF origin = p1(), lorigin = l.p1(), dir = p2() - origin, ldir = l.p2() - lorigin, v = lorigin - origin;
+	qreal matrix[2][3] = {
+		{ dir.x(), -ldir.x(), v.x() },
+		{ dir.y(), -ldir.y(), v.y() }
+	};
+
+	// Same pivoting as intersects_gaussElim()
+	if (qAbs(matrix[0][1]) > qAbs(matrix[0][0]) || qAbs(matrix[1][1]) > qAbs(matrix[0][0]))  {
+		qSwap(matrix[0][0], matrix[0][1]);
+		qSwap(matrix[1][0], matrix[1][1]);
+
+		qSwap(origin, lorigin);
+		qSwap(dir, ldir);
+	}
+	if (qAbs(matrix[1][0]) > qAbs(matrix[0][0]))  {
+		qSwap(matrix[0][0], matrix[1][0]);
+		qSwap(matrix[0][1], matrix[1][1]);
+		qSwap(matrix[0][2], matrix[1][2]);
+	}
+
+	// NOTE: The pivot is the heaviest entry of the first 2 columns, so after this, no product of 2 of
+	//       their entries (or the rank test's pivot^2 * epsilon) can overflow or underflow
+	const qreal pivotMagnitude = qAbs(matrix[0][0]);
+	if ((pivotMagnitude > 1e150 || pivotMagnitude < 1e-140) && pivotMagnitude > 0 && std::isfinite(pivotMagnitude))  {
+		const int exponent = std::ilogb(pivotMagnitude);
+		for (auto& row : matrix)
+		{
+			for (qreal& entry : row)
+				entry = std::ldexp(entry, -exponent);
+		}
+	}
+
+	const qreal determinant = std::fma(matrix[0][0], matrix[1][1], -matrix[0][1] * matrix[1][0]);
+
+	// Equivalent to `numerator / denominator` being in [0, 1], except that NaN is never inside
+	const auto isWithinSegment = [](qreal numerator, qreal denominator)
+	{
+		return denominator > 0
+				? (numerator >= 0 && numerator <= denominator)
+				: (numerator <= 0 && numerator >= denominator);
+	};
+
+	// |matrix[1][1] after elimination| < |pivot| * epsilon
+	// NOTE: A pivot of 0 means that both segments have zero length. intersects_gaussElim() divides by
+	//       it (and gets NaN), but here it makes the segments collinear, like the reference does.
+	//       Unlike the reference, 2 different points are then also called intersecting.
+	if (qAbs(determinant) <= matrix[0][0] * matrix[0][0] * std::numeric_limits<qreal>::epsilon())  {
+		// The origin point (origin + n*dir) scaled by the pivot, and the parameters n <= n2 of the
+		// other segment's endpoints scaled by |pivot|
+		const qreal sign = matrix[0][0] < 0 ? -1 : 1;
+		const qreal scale = qAbs(matrix[0][0]);
+
+		// NOTE: r is compared with the coordinates, so the pivot is normalised to [1, 2) first. Otherwise,
+		//       r * lorigin would overflow for much smaller coordinates than in intersects_gaussElim().
+		const int exponent = scale > 0 ? std::ilogb(scale) : 0;
+		const qreal pivot = std::ldexp(matrix[0][0], -exponent);
+		const qreal offset = std::ldexp(matrix[0][2], -exponent);
+		const QPointF r = { std::fma(offset, dir.x(), origin.x() * pivot), std::fma(offset, dir.y(), origin.y() * pivot) };
+		if (qAbs(r.x() * lorigin.y() - r.y() * lorigin.x()) > 2 * std::numeric_limits<qreal>::epsilon() * qAbs(lorigin.x() * lorigin.y()) * qAbs(pivot))
+			return Parallel;
+
+		qreal n = sign * matrix[0][2];
+		qreal n2 = sign * (matrix[0][2] - matrix[0][1]);
+		if (n > n2)
+			qSwap(n, n2);
+
+		const SegmentRelations relation = Parallel | LinesIntersect;
+		return (n2 >= 0 && n <= scale) ? (relation | SegmentsIntersect) : relation;
+	}
+
+	// Cramer's rule, over the same determinant
+	const qreal nnb = std::fma(matrix[0][0], matrix[1][2], -matrix[1][0] * matrix[0][2]);
+	if (!isWithinSegment(nnb, determinant))
+		return LinesIntersect;
+
+	const qreal nna = std::fma(matrix[0][2], matrix[1][1], -matrix[0][1] * matrix[1][2]);
+	return LinesIntersect | (isWithinSegment(nna, determinant) ? SegmentsIntersect : NoRelation);
+}
+
+/*
+	Like MyLineF::intersects_flsiV2(), but every classification is exact instead of using
+	tolerances: Parallel means exactly parallel, and SegmentsIntersect means that the segments
+	really touch. The orientation signs come from Exact::crossSign(), which only falls back to
+	exact arithmetic when its floating-point filter can't decide.
+
+	A zero-length segment is a point, which is parallel to every direction: It is collinear with a
+	segment whose line goes through it (and then intersects it if it is on the segment), and
+	parallel to it otherwise. 2 points are always collinear, and they only intersect if they are
+	the same point.
+
+	NOTE: The intersection point of non-parallel segments is calculated as in intersects_flsiV2(),
+	      so it is not exact.
+*/
+MyLineF::SegmentRelations
+MyLineF::intersects_adaptive(const QLineF& l, QPointF* intersectionPoint) const
+{
+	if (   !std::isfinite(x1()) || !std::isfinite(y1()) || !std::isfinite(x2()) || !std::isfinite(y2())
+		|| !std::isfinite(l.x1()) || !std::isfinite(l.y1()) || !std::isfinite(l.x2()) || !std::isfinite(l.y2()) )
+	{
+		PATHCOUNTERS_COUNT(Adaptive_Invalid);
+		return SegmentRelations(); // Invalid input
+	}
+
+	// NOTE: Not QPointF::operator==(), which is fuzzy
+	const bool isPoint = x1() == x2() && y1() == y2();
+	const bool lIsPoint = l.x1() == l.x2() && l.y1() == l.y2();
+
+	if (isPoint && lIsPoint)
+	{
+		PATHCOUNTERS_COUNT(Adaptive_Collinear);
+		if (intersectionPoint)
+			*intersectionPoint = (p1() + l.p1()) / 2;
+		return (x1() == l.x1() && y1() == l.y1()) ? (Parallel | LinesIntersect | SegmentsIntersect) : (Parallel | LinesIntersect);
+	}
+
+	// If *this is a point, the orientations below are always 0, so it is tested against l instead.
+	// (If l is a point, they already are this test.)
+	if (isPoint && Exact::orientation(l.p1(), l.p2(), p1()) != 0)
+	{
+		PATHCOUNTERS_COUNT(Adaptive_Parallel);
+		return Parallel;
+	}
+
+	// The midpoint of the 2 middle endpoints along the main axis of *this (or of l, if *this is a
+	// point): The midpoint of the overlap, or the midpoint of the gap
+	const auto middleOfOverlap = [&](bool* overlaps) -> QPointF
+	{
+		const QLineF& axisLine = isPoint ? l : static_cast<const QLineF&>(*this);
+		const bool useY = qAbs(axisLine.dx()) < qAbs(axisLine.dy());
+		const auto key = [useY](const QPointF& p) { return useY ? p.y() : p.x(); };
+
+		const QPointF lo1 = key(p1()) <= key(p2()) ? p1() : p2();
+		const QPointF hi1 = key(p1()) <= key(p2()) ? p2() : p1();
+		const QPointF lo2 = key(l.p1()) <= key(l.p2()) ? l.p1() : l.p2();
+		const QPointF hi2 = key(l.p1()) <= key(l.p2()) ? l.p2() : l.p1();
+
+		const QPointF innerLo = key(lo1) >= key(lo2) ? lo1 : lo2;
+		const QPointF innerHi = key(hi1) <= key(hi2) ? hi1 : hi2;
+		if (overlaps)
+			*overlaps = key(innerLo) <= key(innerHi);
+		return (innerLo + innerHi) / 2;
+	};
+
+	// Where the endpoints of l are, relative to *this
+	const int o1 = Exact::orientation(p1(), p2(), l.p1());
+	const int o2 = Exact::orientation(p1(), p2(), l.p2());
+
+	if (o1 == 0 && o2 == 0) // Collinear
+	{
+		// All 4 points are exactly on the same line, so comparing 1 coordinate is exact
+		PATHCOUNTERS_COUNT(Adaptive_Collinear);
+		bool overlaps;
+		const QPointF middle = middleOfOverlap(&overlaps);
+		if (intersectionPoint)
+			*intersectionPoint = middle;
+		return overlaps ? (Parallel | LinesIntersect | SegmentsIntersect) : (Parallel | LinesIntersect);
+	}
+
+	// NOTE: If the endpoints of l are on different sides of *this, l can't be parallel to *this.
+	//       This saves a predicate in the most common case.
+	if (o1 == o2 && Exact::crossSign(p1(), p2(), l.p1(), l.p2()) == 0)
+	{
+		PATHCOUNTERS_COUNT(Adaptive_Parallel);
+		return Parallel;
+	}
+	PATHCOUNTERS_COUNT(Adaptive_NotParallel);
+
+	if (intersectionPoint)
+	{
+		const QPointF a = p2() - p1();
+		const QPointF b = l.p1() - l.p2();
+		const QPointF c = p1() - l.p1();
+		const qreal denominator = a.y() * b.x() - a.x() * b.y();
+		const qreal nna = b.y() * c.x() - b.x() * c.y();
+
+		// NOTE: The segments are not exactly parallel, but they can still be too close to parallel
+		//       for `denominator` to be non-zero
+		if (denominator != 0)
+			*intersectionPoint = p1() + a * (nna / denominator);
+		else
+			*intersectionPoint = middleOfOverlap(nullptr);
+	}
+
+	// Each segment must have the other's endpoints on both sides of it (or on it)
+	if (o1 * o2 > 0)
+		return LinesIntersect;
+
+	const int o3 = Exact::orientation(l.p1(), l.p2(), p1());
+	const int o4 = Exact::orientation(l.p1(), l.p2(), p2());
+	if (o3 * o4 > 0)
+		return LinesIntersect;
+
+	return LinesIntersect | SegmentsIntersect;
+}
+
+/*
+	Sends each pair to whichever of intersects_flsiV2() and intersects_gaussElim() is cheapest while
+	still being accurate for it:
+	- Well-conditioned pairs (the usual case) use the flsiV2 formulas, which are about twice as fast.
+	- Pairs that are close to parallel use intersects_gaussElim(), whose rank test (relative to
+	  epsilon) misclassifies far fewer of them than the fuzzy compare in intersects_flsiV2(),
+	  unless flsiV2's own tests say that they are collinear: For those, analyzeCollinearSegments()
+	  is more reliable than gaussElim's collinearity test.
+
+	The conditioning estimate is the sine of the angle between the segments: The denominator is
+	|a||b|sin(angle), so it is compared with |a||b|. Both sides are squared, so that no square root
+	is needed.
+
+	NOTE: If the squares overflow, the pair goes to intersects_gaussElim(), which only costs time
+
+	NOTE: The threshold is well above the point where robustFuzzyCompare() (used by flsiV2's
+	      parallel test) starts to give up, so no well-conditioned pair is ever called parallel
+*/
+MyLineF::SegmentRelations
+MyLineF::intersects_hybrid(const QLineF& l, QPointF* intersectionPoint) const
+{
+	// Pairs whose |sin(angle)| is smaller than this are ill-conditioned
+	const qreal sineThreshold = 1.0 / (1 << 20);
+
+	const QPointF a = p2() - p1();
+	const QPointF b = l.p1() - l.p2();
+	const QPointF c = p1() - l.p1();
+
+	const qreal d1 = a.y() * b.x();
+	const qreal d2 = a.x() * b.y();
+	const qreal denominator = d1 - d2;
+
+	if (!std::isfinite(denominator)) // Invalid input: At least 1 point contains NaN or Inf
+	{
+		PATHCOUNTERS_COUNT(Hybrid_Invalid);
+		return SegmentRelations();
+	}
+
+	const qreal squaredLengthA = a.x()*a.x() + a.y()*a.y();
+	const qreal squaredLengthB = b.x()*b.x() + b.y()*b.y();
+	if (denominator*denominator <= (sineThreshold*sineThreshold) * squaredLengthA * squaredLengthB)
+	{
+		// NOTE: Only exact equality is trusted here. flsiV2's fuzzy tests also call many pairs that are
+		//       merely close to parallel collinear, and gaussElim classifies those better.
+		if (denominator == 0 && b.y() * c.x() == b.x() * c.y()) // Collinear
+		{
+			PATHCOUNTERS_COUNT(Hybrid_Collinear);
+			return Algo::analyzeCollinearSegments(*this, l, intersectionPoint);
+		}
+
+		PATHCOUNTERS_COUNT(Hybrid_GaussElim);
+		return intersects_gaussElim(l, intersectionPoint);
+	}
+	PATHCOUNTERS_COUNT(Hybrid_WellConditioned);
+
+	// The rest is the same as the non-parallel part of intersects_flsiV2()
+	const qreal nna = b.y() * c.x() - b.x() * c.y();
+	if (intersectionPoint)
+		*intersectionPoint = p1() + a * (nna / denominator);
+
 	if (   (  denominator>0  &&  ( nna<0 || nna>denominator )  )
 		|| (  denominator<0  &&  ( nna>0 || nna<denominator )  )   )
 		return LinesIntersect;
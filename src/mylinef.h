@@ -4,6 +4,7 @@
 #include <QFlags>
 #include <QLineF>
 
+#include <cstring>
 #include <vector>
 
 class MyLineF : public QLineF
@@ -53,7 +54,38 @@ public:
 
 	// Using a new enum, new algorithms
 	SegmentRelations intersects_flsiV2(const QLineF& l, QPointF* intersectionPoint = nullptr) const;
+	SegmentRelations intersects_adaptive(const QLineF& l, QPointF* intersectionPoint = nullptr) const;
+
+	// Dispatches each pair to intersects_flsiV2() or intersects_gaussElim(), by conditioning
+	SegmentRelations intersects_hybrid(const QLineF& l, QPointF* intersectionPoint = nullptr) const;
+
+	// Classification only, for callers that never need the intersection point. Nothing is divided.
+	SegmentRelations classify_flsiV2(const QLineF& l) const;
+	SegmentRelations classify_gaussElim(const QLineF& l) const;
 };
 Q_DECLARE_OPERATORS_FOR_FLAGS(MyLineF::SegmentRelations)
 
+// The closest SegmentRelations to a QLineF::IntersectionType, so that all functions' results can be compared
+inline MyLineF::SegmentRelations toSegmentRelations(QLineF::IntersectionType type)
+{
+	switch (type)
+	{
+	case QLineF::BoundedIntersection: return MyLineF::LinesIntersect | MyLineF::SegmentsIntersect;
+	case QLineF::UnboundedIntersection: return MyLineF::LinesIntersect;
+	case QLineF::NoIntersection: break;
+	}
+	return MyLineF::Parallel;
+}
+
+inline MyLineF::SegmentRelations toSegmentRelations(MyLineF::SegmentRelations relations)
+{
+	return relations;
+}
+
+// NOTE: Compares the bits. QPointF::operator==() is fuzzy, which would hide the small differences that matter here.
+inline bool isSamePoint(const QPointF& a, const QPointF& b)
+{
+	return std::memcmp(&a, &b, sizeof(QPointF)) == 0;
+}
+
 #endif // MYLINEF_H
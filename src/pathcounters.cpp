@@ -0,0 +1,120 @@
+#include "pathcounters.h"
+
+#include <QMutex>
+#include <QVector>
+
+namespace
+{
+
+const char* const pathNames[PathCounters::PathCount] =
+{
+	"intersects_flsiOrig: parallel",
+	"intersects_flsiOrig: invalid",
+	"intersects_flsiOrig: not parallel",
+
+	"intersects_flsiTweaked: parallel",
+	"intersects_flsiTweaked: invalid",
+	"intersects_flsiTweaked: not parallel",
+
+	"intersects_flsiV2: invalid",
+	"intersects_flsiV2: parallel",
+	"intersects_flsiV2: collinear",
+	"intersects_flsiV2: outside 1st segment",
+	"intersects_flsiV2: outside 2nd segment",
+	"intersects_flsiV2: segments intersect",
+
+	"intersects_gaussElim: rank-deficient, parallel",
+	"intersects_gaussElim: rank-deficient, collinear",
+	"intersects_gaussElim: back-substitution",
+
+	"intersects_adaptive: invalid",
+	"intersects_adaptive: collinear",
+	"intersects_adaptive: parallel",
+	"intersects_adaptive: not parallel",
+
+	"intersects_hybrid: invalid",
+	"intersects_hybrid: well-conditioned",
+	"intersects_hybrid: collinear",
+	"intersects_hybrid: gaussElim"
+};
+
+#ifdef PATHCOUNTERS_ENABLED
+
+// The blocks of the running threads, and the counts of the finished ones
+struct Registry
+{
+	QMutex mutex;
+	QVector<PathCounters::Block*> blocks;
+	quint64 finishedCounts[PathCounters::PathCount] = {};
+};
+
+Registry& registry()
+{
+	// NOTE: Constructed on first use, so it outlives the blocks of threads that finish at exit
+	static Registry* instance = new Registry;
+	return *instance;
+}
+
+#endif
+
+}
+
+const char* PathCounters::name(Path path)
+{
+	return pathNames[path];
+}
+
+#ifdef PATHCOUNTERS_ENABLED
+
+thread_local PathCounters::Block PathCounters::threadBlock;
+
+PathCounters::Block::Block()
+{
+	for (auto& counter : counts)
+		counter.store(0, std::memory_order_relaxed);
+
+	QMutexLocker locker(&registry().mutex);
+	registry().blocks << this;
+}
+
+PathCounters::Block::~Block()
+{
+	QMutexLocker locker(&registry().mutex);
+	for (int i = 0; i < PathCount; ++i)
+		registry().finishedCounts[i] += counts[i].load(std::memory_order_relaxed);
+	registry().blocks.removeOne(this);
+}
+
+void PathCounters::reset()
+{
+	QMutexLocker locker(&registry().mutex);
+	for (auto block : registry().blocks)
+	{
+		for (auto& counter : block->counts)
+			counter.store(0, std::memory_order_relaxed);
+	}
+	for (auto& count : registry().finishedCounts)
+		count = 0;
+}
+
+quint64 PathCounters::total(Path path)
+{
+	QMutexLocker locker(&registry().mutex);
+	quint64 sum = registry().finishedCounts[path];
+	for (auto block : registry().blocks)
+		sum += block->counts[path].load(std::memory_order_relaxed);
+	return sum;
+}
+
+#else
+
+void PathCounters::reset()
+{}
+
+quint64 PathCounters::total(Path path)
+{
+	Q_UNUSED(path)
+	return 0;
+}
+
+#endif
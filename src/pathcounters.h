@@ -0,0 +1,108 @@
+#ifndef PATHCOUNTERS_H
+#define PATHCOUNTERS_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+/*
+	Counts how often each code path of the intersection functions is taken, so that a speed result
+	can be traced back to the paths that it actually measured.
+
+	Compiled out unless PATHCOUNTERS_ENABLED is defined (see the .pro file): PATHCOUNTERS_COUNT()
+	then expands to nothing, and the functions are exactly as fast as without it. When enabled, each
+	thread counts into its own block, and total() adds up the blocks of every thread, including the
+	ones that have already finished.
+
+	Each function's paths are exhaustive: Every call ends in exactly one of them.
+
+	NOTE: The batch kernels and PreparedLine aren't instrumented; their lanes don't branch. Neither is
+	      classify_gaussElim(). classify_flsiV2() shares the body of intersects_flsiV2(), so its calls
+	      are counted in the FlsiV2_ paths.
+*/
+namespace PathCounters
+{
+
+enum Path
+{
+	FlsiOrig_Parallel,
+	FlsiOrig_Invalid,                   // !std::isfinite(denominator)
+	FlsiOrig_NotParallel,
+
+	FlsiTweaked_Parallel,
+	FlsiTweaked_Invalid,
+	FlsiTweaked_NotParallel,
+
+	FlsiV2_Invalid,
+	FlsiV2_Parallel,                    // Parallel, but not collinear
+	FlsiV2_Collinear,
+	FlsiV2_OutsideSegment1,             // The point is outside *this
+	FlsiV2_OutsideSegment2,             // The point is on *this, but outside l
+	FlsiV2_SegmentsIntersect,
+
+	GaussElim_RankDeficientParallel,
+	GaussElim_RankDeficientCollinear,
+	GaussElim_BackSubstitution,
+
+	Adaptive_Invalid,
+	Adaptive_Collinear,
+	Adaptive_Parallel,
+	Adaptive_NotParallel,
+
+	Hybrid_Invalid,
+	Hybrid_WellConditioned,             // Handled like intersects_flsiV2()
+	Hybrid_Collinear,
+	Hybrid_GaussElim,
+
+	PathCount
+};
+
+// e.g. "intersects_flsiV2: collinear"
+const char* name(Path path);
+
+#ifdef PATHCOUNTERS_ENABLED
+
+// One thread's counters. Only that thread writes them, so relaxed loads and stores are enough.
+struct Block
+{
+	Block();
+	~Block(); // Adds the counts to the total of finished threads
+
+	std::atomic<quint64> counts[PathCount];
+};
+
+extern thread_local Block threadBlock;
+
+inline void count(Path path)
+{
+	std::atomic<quint64>& counter = threadBlock.counts[path];
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+#define PATHCOUNTERS_COUNT(path) PathCounters::count(PathCounters::path)
+
+#else
+
+#define PATHCOUNTERS_COUNT(path) do {} while (false)
+
+#endif
+
+constexpr bool isEnabled()
+{
+#ifdef PATHCOUNTERS_ENABLED
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+	ASSUMPTION: No other thread is counting while these are called, e.g. the benchmarks call them
+	            between runs
+*/
+void reset();
+quint64 total(Path path);
+
+}
+
+#endif // PATHCOUNTERS_H
@@ -0,0 +1,156 @@
+#include "perfcounters.h"
+
+#ifdef Q_OS_LINUX
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  include <cerrno>
+#  include <cstring>
+#endif
+
+#ifdef Q_OS_LINUX
+namespace
+{
+
+int openEvent(PerfCounters::Event event)
+{
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	switch (event)
+	{
+	case PerfCounters::Cycles:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PerfCounters::Instructions:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PerfCounters::BranchMisses:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case PerfCounters::L1dMisses:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D
+				| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+				| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case PerfCounters::EventCount:
+		return -1;
+	}
+
+	// This thread, on any CPU
+	return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// Reads {value, time enabled, time running}
+bool readEvent(int fd, quint64 (&data)[3])
+{
+	return read(fd, data, sizeof(data)) == sizeof(data);
+}
+
+}
+#endif
+
+PerfCounters::PerfCounters()
+{
+	for (int i = 0; i < EventCount; ++i)
+	{
+		m_fds[i] = -1;
+		m_values[i] = 0;
+		for (quint64& start : m_startData[i])
+			start = 0;
+	}
+
+#ifdef Q_OS_LINUX
+	for (int i = 0; i < EventCount; ++i)
+	{
+		m_fds[i] = openEvent(static_cast<Event>(i));
+		if (m_fds[i] < 0 && m_errorString.isEmpty())
+			m_errorString = QString("perf_event_open() failed: %1").arg(std::strerror(errno));
+	}
+#else
+	m_errorString = "Hardware performance counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef Q_OS_LINUX
+	for (int fd : m_fds)
+	{
+		if (fd >= 0)
+			close(fd);
+	}
+#endif
+}
+
+bool PerfCounters::isAvailable(Event event) const
+{
+	return m_fds[event] >= 0;
+}
+
+bool PerfCounters::isAnyAvailable() const
+{
+	for (int fd : m_fds)
+	{
+		if (fd >= 0)
+			return true;
+	}
+	return false;
+}
+
+void PerfCounters::start()
+{
+#ifdef Q_OS_LINUX
+	for (int i = 0; i < EventCount; ++i)
+	{
+		if (m_fds[i] < 0)
+			continue;
+
+		// NOTE: PERF_EVENT_IOC_RESET would only reset the value, not the times
+		if (!readEvent(m_fds[i], m_startData[i]))
+			m_startData[i][0] = m_startData[i][1] = m_startData[i][2] = 0;
+		ioctl(m_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef Q_OS_LINUX
+	for (int fd : m_fds)
+	{
+		if (fd >= 0)
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	for (int i = 0; i < EventCount; ++i)
+	{
+		m_values[i] = 0;
+		if (m_fds[i] < 0)
+			continue;
+
+		quint64 data[3] = {0, 0, 0};
+		if (!readEvent(m_fds[i], data))
+			continue;
+
+		// Only the time since start() counts, so that the scaling doesn't depend on earlier measurements
+		const quint64 value = data[0] - m_startData[i][0];
+		const quint64 enabled = data[1] - m_startData[i][1];
+		const quint64 running = data[2] - m_startData[i][2];
+		if (running == 0)
+			continue;
+
+		m_values[i] = qreal(value) * enabled / running;
+	}
+#endif
+}
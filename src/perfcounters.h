@@ -0,0 +1,59 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <QString>
+
+/*
+	Hardware performance counters for the calling thread, via Linux's perf_event_open().
+
+	Each event is opened separately, so that the ones which the CPU (or the container, or
+	/proc/sys/kernel/perf_event_paranoid) doesn't allow can be skipped without losing the rest.
+	On other platforms, no events are available.
+*/
+class PerfCounters
+{
+	Q_DISABLE_COPY(PerfCounters)
+
+public:
+	enum Event
+	{
+		Cycles,
+		Instructions,
+		BranchMisses,
+		L1dMisses,
+		EventCount
+	};
+
+	PerfCounters();
+	~PerfCounters();
+
+	bool isAvailable(Event event) const;
+	bool isAnyAvailable() const;
+
+	// Why the events that aren't available couldn't be opened
+	QString errorString() const { return m_errorString; }
+
+	// Starts all available counters
+	void start();
+
+	// Stops all available counters, and reads them
+	void stop();
+
+	/*
+		The count between the last start() and stop(), or 0 if the event isn't available.
+		If the kernel had to share the hardware counters with other events, the count is
+		extrapolated from the time that the event was actually counted.
+	*/
+	qreal value(Event event) const { return m_values[event]; }
+
+private:
+	int m_fds[EventCount];
+	qreal m_values[EventCount];
+
+	// {value, time enabled, time running} at start(). The kernel never resets the times, so stop()
+	// uses the differences from these.
+	quint64 m_startData[EventCount][3];
+	QString m_errorString;
+};
+
+#endif // PERFCOUNTERS_H
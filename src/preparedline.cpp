@@ -0,0 +1,168 @@
+#include "preparedline.h"
+#include "algorithms.h"
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+// The per-segment part of Algo::findTolerance()
+// NOTE: Multiplying by epsilon() is exact and rounding is monotonic, so the smaller of 2 shares
+//       equals findTolerance() exactly
+inline qreal toleranceShare(qreal squaredLength)
+{
+	return std::numeric_limits<qreal>::epsilon() * qMin(1.0, squaredLength);
+}
+
+inline bool isFinite(const QLineF& line)
+{
+	return std::isfinite(line.x1()) && std::isfinite(line.y1()) && std::isfinite(line.x2()) && std::isfinite(line.y2());
+}
+
+// The other segment of a pair, whether it was prepared or not
+struct OtherLine
+{
+	const QLineF& line;
+	QPointF direction;
+	qreal tolerance;
+};
+
+inline OtherLine otherLine(const QLineF& l)
+{
+	const QPointF direction = l.p2() - l.p1();
+	return OtherLine{l, direction, toleranceShare(direction.x()*direction.x() + direction.y()*direction.y())};
+}
+
+inline OtherLine otherLine(const PreparedLine& l)
+{
+	return OtherLine{l.line(), l.direction(), l.tolerance()};
+}
+
+/*
+	MyLineF::intersects_flsiTweaked(), with the direction and tolerance of each segment taken from
+	the caller. The operations are done in the same order, so the results are bit-identical.
+*/
+QLineF::IntersectionType flsiTweaked(const PreparedLine& self, const OtherLine& other, QPointF* intersectionPoint)
+{
+	const QPointF a = self.direction();
+	const QPointF b = -other.direction; // == l.p1() - l.p2(), exactly
+	const QPointF c = self.line().p1() - other.line.p1();
+
+	const qreal d1 = a.y() * b.x();
+	const qreal d2 = a.x() * b.y();
+
+	if (  Algo::robustFuzzyCompare( d1, d2, qMin(self.tolerance(), other.tolerance) )  ) // Parallel
+		return QLineF::NoIntersection;
+
+	const qreal denominator = d1 - d2;
+	if (!std::isfinite(denominator)) // Invalid input, or overflow
+		return QLineF::NoIntersection;
+
+	const qreal nna = b.y() * c.x() - b.x() * c.y();
+
+	if (intersectionPoint)
+		*intersectionPoint = self.line().p1() + a * (nna / denominator);
+
+	if (   (  denominator>0  &&  ( nna<0 || nna>denominator )  )
+		|| (  denominator<0  &&  ( nna>0 || nna<denominator )  )   )
+		return QLineF::UnboundedIntersection;
+
+	const qreal nnb = a.x() * c.y() - a.y() * c.x();
+	if (   (  denominator>0  &&  ( nnb<0 || nnb>denominator )  )
+		|| (  denominator<0  &&  ( nnb>0 || nnb<denominator )  )   )
+		return QLineF::UnboundedIntersection;
+
+	return QLineF::BoundedIntersection;
+}
+
+// MyLineF::intersects_flsiV2(), in the same way as flsiTweaked() above
+MyLineF::SegmentRelations flsiV2(const PreparedLine& self, const OtherLine& other, QPointF* intersectionPoint)
+{
+	const QPointF a = self.direction();
+	const QPointF b = -other.direction;
+	const QPointF c = self.line().p1() - other.line.p1();
+
+	const qreal tolerance = qMin(self.tolerance(), other.tolerance);
+
+	const qreal d1 = a.y() * b.x();
+	const qreal d2 = a.x() * b.y();
+	const qreal denominator = d1 - d2;
+
+	if (!std::isfinite(denominator)) // Invalid input, or overflow
+		return MyLineF::SegmentRelations();
+
+	const qreal na1 = b.y() * c.x();
+	const qreal na2 = b.x() * c.y();
+
+	if ( Algo::robustFuzzyCompare(d1, d2, tolerance) ) // Parallel
+	{
+		if ( Algo::robustFuzzyCompare(na1, na2, tolerance) ) // Collinear
+			return Algo::analyzeCollinearSegments(self.line(), other.line, intersectionPoint);
+		return MyLineF::Parallel;
+	}
+
+	const qreal nna = na1 - na2;
+
+	if (intersectionPoint)
+		*intersectionPoint = self.line().p1() + a * (nna / denominator);
+
+	if (   (  denominator>0  &&  ( nna<0 || nna>denominator )  )
+		|| (  denominator<0  &&  ( nna>0 || nna<denominator )  )   )
+		return MyLineF::LinesIntersect;
+
+	const qreal nnb = a.x() * c.y() - a.y() * c.x();
+	if (   (  denominator>0  &&  ( nnb<0 || nnb>denominator )  )
+		|| (  denominator<0  &&  ( nnb>0 || nnb<denominator )  )   )
+		return MyLineF::LinesIntersect;
+
+	return MyLineF::LinesIntersect | MyLineF::SegmentsIntersect;
+}
+
+}
+
+PreparedLine::PreparedLine(const QLineF& line) :
+	m_line(line.p1(), line.p2()),
+	m_direction(line.p2() - line.p1()),
+	m_squaredLength(m_direction.x()*m_direction.x() + m_direction.y()*m_direction.y()),
+	m_tolerance(toleranceShare(m_squaredLength)),
+	m_isValid(isFinite(line)),
+	m_boundingBox(QRectF(line.p1(), line.p2()).normalized())
+{}
+
+/*
+	NOTE: A NaN or Inf coordinate always makes the denominator non-finite, so the early exits for
+	      invalid segments give the same results as the MyLineF functions. They just skip the work.
+*/
+
+QLineF::IntersectionType
+PreparedLine::intersects_flsiTweaked(const QLineF& l, QPointF* intersectionPoint) const
+{
+	if (!m_isValid)
+		return QLineF::NoIntersection;
+	return flsiTweaked(*this, otherLine(l), intersectionPoint);
+}
+
+QLineF::IntersectionType
+PreparedLine::intersects_flsiTweaked(const PreparedLine& l, QPointF* intersectionPoint) const
+{
+	if (!m_isValid || !l.m_isValid)
+		return QLineF::NoIntersection;
+	return flsiTweaked(*this, otherLine(l), intersectionPoint);
+}
+
+MyLineF::SegmentRelations
+PreparedLine::intersects_flsiV2(const QLineF& l, QPointF* intersectionPoint) const
+{
+	if (!m_isValid)
+		return MyLineF::SegmentRelations();
+	return flsiV2(*this, otherLine(l), intersectionPoint);
+}
+
+MyLineF::SegmentRelations
+PreparedLine::intersects_flsiV2(const PreparedLine& l, QPointF* intersectionPoint) const
+{
+	if (!m_isValid || !l.m_isValid)
+		return MyLineF::SegmentRelations();
+	return flsiV2(*this, otherLine(l), intersectionPoint);
+}
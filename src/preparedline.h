@@ -0,0 +1,54 @@
+#ifndef PREPAREDLINE_H
+#define PREPAREDLINE_H
+
+#include "mylinef.h"
+
+#include <QRectF>
+
+/*
+	A line segment with the per-segment parts of the intersection functions calculated in advance,
+	for testing one segment against many others (or many against many, with both sides prepared).
+
+	The intersects_*() functions give bit-identical results (relations and intersection points) to
+	the MyLineF functions of the same name; they just don't recalculate the direction, squared
+	length and tolerance of a segment that has already been prepared.
+*/
+class PreparedLine
+{
+public:
+	PreparedLine() : PreparedLine(QLineF(0, 0, 0, 0)) {}
+	explicit PreparedLine(const QLineF& line);
+
+	const MyLineF& line() const { return m_line; }
+
+	// p2() - p1()
+	QPointF direction() const { return m_direction; }
+	qreal squaredLength() const { return m_squaredLength; }
+
+	// This segment's share of Algo::findTolerance(): The tolerance for a pair of segments is the
+	// smaller of their 2 shares
+	qreal tolerance() const { return m_tolerance; }
+
+	// False if any coordinate is NaN or Inf
+	bool isValid() const { return m_isValid; }
+
+	// NOTE: Not used by the intersects_*() functions, because a fuzzy intersection can lie just
+	//       outside of it. It is meant for the callers' own culling (see SegmentBvh).
+	QRectF boundingBox() const { return m_boundingBox; }
+
+	QLineF::IntersectionType intersects_flsiTweaked(const QLineF& l, QPointF* intersectionPoint = nullptr) const;
+	QLineF::IntersectionType intersects_flsiTweaked(const PreparedLine& l, QPointF* intersectionPoint = nullptr) const;
+
+	MyLineF::SegmentRelations intersects_flsiV2(const QLineF& l, QPointF* intersectionPoint = nullptr) const;
+	MyLineF::SegmentRelations intersects_flsiV2(const PreparedLine& l, QPointF* intersectionPoint = nullptr) const;
+
+private:
+	MyLineF m_line;
+	QPointF m_direction;
+	qreal m_squaredLength;
+	qreal m_tolerance;
+	bool m_isValid;
+	QRectF m_boundingBox;
+};
+
+#endif // PREPAREDLINE_H
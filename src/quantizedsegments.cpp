@@ -0,0 +1,240 @@
+#include "quantizedsegments.h"
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+// The relative tolerance of qFuzzyCompare(), which intersects_flsiV2() uses for its parallel tests.
+// It is far larger than the rounding error of the products, so it covers that too.
+const qreal fuzzyTolerance = 1e-12;
+
+bool isFinite(qreal x1, qreal y1, qreal x2, qreal y2)
+{
+	return std::isfinite(x1) && std::isfinite(y1) && std::isfinite(x2) && std::isfinite(y2);
+}
+
+// The distance from |x| to the next larger double
+qreal ulpOf(qreal x)
+{
+	const qreal magnitude = qAbs(x);
+	return std::nextafter(magnitude, std::numeric_limits<qreal>::infinity()) - magnitude;
+}
+
+/*
+	Whether u x v has the same sign (or is equally far from 0) for every u and v whose components
+	are within du and dv of the given ones: The cross product can move by at most
+	du*(|vx| + |vy|) + dv*(|ux| + |uy|) + 2*du*dv.
+*/
+inline bool isCrossCertain(qreal ux, qreal uy, qreal vx, qreal vy, qreal du, qreal dv, qreal fuzz)
+{
+	const qreal t1 = ux * vy;
+	const qreal t2 = uy * vx;
+	const qreal bound = du * (std::abs(vx) + std::abs(vy)) + dv * (std::abs(ux) + std::abs(uy)) + 2 * du * dv;
+	return std::abs(t1 - t2) > bound + fuzz;
+}
+
+/*
+	uncertain[k] for the decoded pairs (lines1.at(k), lines2.at(k)), whose coordinates are within
+	error1 and error2 of the original ones. See Batch::intersects_flsiV2().
+*/
+void flagUncertain(SegmentSpan lines1, SegmentSpan lines2, int n, qreal error1, qreal error2, bool* uncertain)
+{
+	const qreal da = 2 * error1;
+	const qreal db = 2 * error2;
+	const qreal dc = error1 + error2;
+
+	// NOTE: No branches (std::abs() instead of qAbs(), & instead of &&): The signs are random, so they
+	//       would be mispredicted about half the time
+	for (int k = 0; k < n; ++k)
+	{
+		// Same vectors as in intersects_flsiV2()
+		const qreal ax = lines1.x2[k] - lines1.x1[k];
+		const qreal ay = lines1.y2[k] - lines1.y1[k];
+		const qreal bx = lines2.x1[k] - lines2.x2[k];
+		const qreal by = lines2.y1[k] - lines2.y2[k];
+		const qreal cx = lines1.x1[k] - lines2.x1[k];
+		const qreal cy = lines1.y1[k] - lines2.y1[k];
+		const qreal ex = lines1.x2[k] - lines2.x1[k]; // c + a
+		const qreal ey = lines1.y2[k] - lines2.y1[k];
+		const qreal fx = lines2.x2[k] - lines1.x1[k]; // -(b + c)
+		const qreal fy = lines2.y2[k] - lines1.y1[k];
+
+		// NOTE: flsiV2 calculates some of the orientations as differences of others, so the fuzz is
+		//       relative to the largest product of any of the vectors, not just to the ones of each test.
+		//       If anything overflows, the comparisons below are false, so the result is uncertain.
+		const qreal sum = std::abs(ax) + std::abs(ay) + std::abs(bx) + std::abs(by) + std::abs(cx) + std::abs(cy);
+		const qreal fuzz = fuzzyTolerance * sum * sum;
+
+		// flsiV2 also calls the segments parallel if the denominator is below this
+		const qreal parallelTolerance = std::numeric_limits<qreal>::epsilon()
+				* qMin(qMin(qreal(1), ax*ax + ay*ay), bx*bx + by*by);
+
+		const bool certain =
+				  (std::abs(ay * bx - ax * by) > parallelTolerance)
+				& isCrossCertain(ax, ay, bx, by, da, db, fuzz)  // Parallel
+				& isCrossCertain(bx, by, cx, cy, db, dc, fuzz)  // The endpoints of *this, relative to l
+				& isCrossCertain(bx, by, ex, ey, db, dc, fuzz)
+				& isCrossCertain(ax, ay, cx, cy, da, dc, fuzz)  // The endpoints of l, relative to *this
+				& isCrossCertain(ax, ay, fx, fy, da, dc, fuzz);
+
+		// Segments with non-finite coordinates are decoded as NaN, so flsiV2 calls them invalid either way
+		const bool invalid = (lines1.x1[k] != lines1.x1[k]) | (lines2.x1[k] != lines2.x1[k]);
+		uncertain[k] = !(certain | invalid);
+	}
+}
+
+}
+
+template <typename Offset>
+QuantizedSegments<Offset>::QuantizedSegments(SegmentSpan segments, int count)
+{
+	// The largest offset, with room for the rounding of the origin
+	const qreal maxOffset = std::numeric_limits<Offset>::max() - 1;
+
+	m_x1.resize(count);
+	m_y1.resize(count);
+	m_x2.resize(count);
+	m_y2.resize(count);
+	m_blocks.reserve((count + BlockSize-1) / BlockSize);
+
+	for (int first = 0; first < count; first += BlockSize)
+	{
+		const int n = qMin(int(BlockSize), count - first);
+
+		// The bounding box of the block's valid segments
+		Block block{0, 0, 1, 0, 0};
+		qreal minX = std::numeric_limits<qreal>::infinity();
+		qreal minY = minX;
+		qreal maxX = -minX;
+		qreal maxY = -minX;
+		for (int k = 0; k < n; ++k)
+		{
+			const int i = first + k;
+			if (!isFinite(segments.x1[i], segments.y1[i], segments.x2[i], segments.y2[i]))
+			{
+				block.invalid |= quint64(1) << k;
+				continue;
+			}
+			minX = qMin(minX, qMin(segments.x1[i], segments.x2[i]));
+			maxX = qMax(maxX, qMax(segments.x1[i], segments.x2[i]));
+			minY = qMin(minY, qMin(segments.y1[i], segments.y2[i]));
+			maxY = qMax(maxY, qMax(segments.y1[i], segments.y2[i]));
+		}
+
+		if (minX <= maxX) // At least 1 valid segment
+		{
+			/*
+				The smallest power of 2 that fits half the extent into maxOffset, but no smaller than
+				the ulp of the largest coordinate: A finer quantum would only add offsets that the
+				decoded sum can't represent.
+
+				NOTE: This halves the extent and the quantum separately, because extent/maxOffset can
+				      overflow
+			*/
+			const qreal maxAbs = qMax(qMax(qAbs(minX), qAbs(maxX)), qMax(qAbs(minY), qAbs(maxY)));
+			const qreal halfExtent = qMax(maxX/2 - minX/2, maxY/2 - minY/2);
+			int exponent;
+			std::frexp(halfExtent / maxOffset, &exponent);
+			block.quantum = qMax(halfExtent > 0 ? std::ldexp(qreal(1), exponent) : 0, ulpOf(maxAbs));
+
+			block.originX = std::round((minX/2 + maxX/2) / block.quantum) * block.quantum;
+			block.originY = std::round((minY/2 + maxY/2) / block.quantum) * block.quantum;
+			block.maxError = block.quantum/2 + ulpOf(2 * maxAbs);
+		}
+
+		const auto quantize = [&](qreal coordinate, qreal origin)
+		{
+			const qreal offset = std::round((coordinate - origin) / block.quantum);
+			return Offset(qBound(-maxOffset, offset, maxOffset));
+		};
+
+		for (int k = 0; k < n; ++k)
+		{
+			const int i = first + k;
+			const bool valid = !(block.invalid & (quint64(1) << k));
+			m_x1[i] = valid ? quantize(segments.x1[i], block.originX) : 0;
+			m_y1[i] = valid ? quantize(segments.y1[i], block.originY) : 0;
+			m_x2[i] = valid ? quantize(segments.x2[i], block.originX) : 0;
+			m_y2[i] = valid ? quantize(segments.y2[i], block.originY) : 0;
+		}
+		m_blocks << block;
+	}
+}
+
+template <typename Offset>
+qint64 QuantizedSegments<Offset>::byteCount() const
+{
+	return qint64(m_blocks.count()) * sizeof(Block) + 4 * qint64(count()) * sizeof(Offset);
+}
+
+template <typename Offset>
+MyLineF QuantizedSegments<Offset>::at(int i) const
+{
+	qreal x1, y1, x2, y2;
+	decode(i, 1, &x1, &y1, &x2, &y2);
+	return MyLineF(x1, y1, x2, y2);
+}
+
+template <typename Offset>
+void QuantizedSegments<Offset>::decode(int first, int n, qreal* x1, qreal* y1, qreal* x2, qreal* y2) const
+{
+	const Block& block = m_blocks[first / BlockSize];
+	const Offset* offsetsX1 = m_x1.constData() + first;
+	const Offset* offsetsY1 = m_y1.constData() + first;
+	const Offset* offsetsX2 = m_x2.constData() + first;
+	const Offset* offsetsY2 = m_y2.constData() + first;
+
+	// NOTE: No branches, so that the compiler can vectorize this
+	for (int k = 0; k < n; ++k)
+	{
+		x1[k] = block.originX + offsetsX1[k] * block.quantum;
+		y1[k] = block.originY + offsetsY1[k] * block.quantum;
+		x2[k] = block.originX + offsetsX2[k] * block.quantum;
+		y2[k] = block.originY + offsetsY2[k] * block.quantum;
+	}
+
+	if (block.invalid)
+	{
+		const int firstInBlock = first % BlockSize;
+		for (int k = 0; k < n; ++k)
+		{
+			if (block.invalid & (quint64(1) << (firstInBlock + k)))
+				x1[k] = y1[k] = x2[k] = y2[k] = Q_QNAN;
+		}
+	}
+}
+
+template <typename Offset>
+void Batch::intersects_flsiV2(const QuantizedSegments<Offset>& lines1, const QuantizedSegments<Offset>& lines2,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints, bool* uncertain)
+{
+	const int blockSize = QuantizedSegments<Offset>::BlockSize;
+	const int count = qMin(lines1.count(), lines2.count());
+
+	// 4 KiB, so it stays in the L1 cache
+	alignas(64) qreal buffer[8][blockSize];
+	const SegmentSpan decoded1{buffer[0], buffer[1], buffer[2], buffer[3]};
+	const SegmentSpan decoded2{buffer[4], buffer[5], buffer[6], buffer[7]};
+
+	// NOTE: Pair i is in block i/BlockSize of both sets, so the blocks line up
+	for (int first = 0; first < count; first += blockSize)
+	{
+		const int n = qMin(blockSize, count - first);
+		lines1.decode(first, n, buffer[0], buffer[1], buffer[2], buffer[3]);
+		lines2.decode(first, n, buffer[4], buffer[5], buffer[6], buffer[7]);
+
+		intersects_flsiV2(decoded1, decoded2, n, relations + first, intersectionPoints ? intersectionPoints + first : nullptr);
+		if (uncertain)
+			flagUncertain(decoded1, decoded2, n, lines1.maxError(first), lines2.maxError(first), uncertain + first);
+	}
+}
+
+template class QuantizedSegments<qint16>;
+template class QuantizedSegments<qint32>;
+
+template void Batch::intersects_flsiV2(const QuantizedSegments<qint16>&, const QuantizedSegments<qint16>&,
+		MyLineF::SegmentRelations*, QPointF*, bool*);
+template void Batch::intersects_flsiV2(const QuantizedSegments<qint32>&, const QuantizedSegments<qint32>&,
+		MyLineF::SegmentRelations*, QPointF*, bool*);
@@ -0,0 +1,95 @@
+#ifndef QUANTIZEDSEGMENTS_H
+#define QUANTIZEDSEGMENTS_H
+
+#include "segmentbatch.h"
+
+#include <QVector>
+
+/*
+	Compact storage for large sets of line segments, for workloads that are limited by memory
+	bandwidth rather than by arithmetic.
+
+	The segments are stored in blocks of BlockSize. Each block has an origin and a quantum (a power
+	of 2), and each endpoint coordinate is stored as an Offset (qint16 or qint32) from the origin, in
+	multiples of the quantum. The quantum is the smallest one that fits the block's extent into
+	Offset, so segments that are close together (e.g. sorted along a space-filling curve) share a
+	fine quantum, and a block that spans a large area gets a coarse one.
+
+	A segment takes 4 Offsets, plus its share of the block header: 8.6 bytes with qint16, or 16.6
+	bytes with qint32, instead of the 32 bytes of a MyLineF.
+
+	Segments with non-finite coordinates can't be quantized. They are decoded as NaN, which every
+	intersection function treats as invalid input, just like the original coordinates.
+*/
+template <typename Offset>
+class QuantizedSegments
+{
+public:
+	enum { BlockSize = 64 };
+
+	QuantizedSegments() = default;
+	QuantizedSegments(SegmentSpan segments, int count);
+
+	int count() const { return m_x1.count(); }
+
+	// The memory used by the segments, including the block headers
+	qint64 byteCount() const;
+
+	// The largest difference between a coordinate of segment i and its decoded value: Half a
+	// quantum from rounding the offset, plus the rounding of origin + offset * quantum
+	qreal maxError(int i) const { return m_blocks[i / BlockSize].maxError; }
+
+	MyLineF at(int i) const;
+
+	// Decodes segments [first, first + n) into x1[0, n), y1[0, n), x2[0, n) and y2[0, n)
+	// ASSUMPTION: The segments are all in the same block
+	void decode(int first, int n, qreal* x1, qreal* y1, qreal* x2, qreal* y2) const;
+
+private:
+	struct Block
+	{
+		qreal originX;
+		qreal originY;
+		qreal quantum;
+		qreal maxError;
+		quint64 invalid; // Bit k is set if segment k of the block has a non-finite coordinate
+	};
+
+	QVector<Block> m_blocks;
+	QVector<Offset> m_x1;
+	QVector<Offset> m_y1;
+	QVector<Offset> m_x2;
+	QVector<Offset> m_y2;
+};
+
+extern template class QuantizedSegments<qint16>;
+extern template class QuantizedSegments<qint32>;
+
+namespace Batch
+{
+
+/*
+	Calculates lines1.at(i).intersects_flsiV2(lines2.at(i), &intersectionPoints[i]), for every i
+	that both sets have. Each block is decoded into a buffer that stays in the L1 cache, and passed
+	to the SegmentSpan overload, so the decoded segments never go back to memory.
+
+	If `uncertain` isn't null, uncertain[i] says whether quantization might have changed
+	relations[i]: It is false only if every test that decides the relations (the parallel test,
+	and the orientation of each endpoint relative to the other segment) is further from its
+	threshold than the quantization error can move it, with a margin for the rounding and the fuzzy
+	compares of intersects_flsiV2(). Then relations[i] is the same as for the original segments.
+
+	NOTE: Even then, the intersection point is that of the decoded segments
+*/
+template <typename Offset>
+void intersects_flsiV2(const QuantizedSegments<Offset>& lines1, const QuantizedSegments<Offset>& lines2,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints = nullptr, bool* uncertain = nullptr);
+
+extern template void intersects_flsiV2(const QuantizedSegments<qint16>&, const QuantizedSegments<qint16>&,
+		MyLineF::SegmentRelations*, QPointF*, bool*);
+extern template void intersects_flsiV2(const QuantizedSegments<qint32>&, const QuantizedSegments<qint32>&,
+		MyLineF::SegmentRelations*, QPointF*, bool*);
+
+}
+
+#endif // QUANTIZEDSEGMENTS_H
@@ -0,0 +1,42 @@
+#include "referenceintersection.h"
+#include "doubledouble.h"
+
+MyLineF::SegmentRelations
+Reference::intersects(const QLineF& l1, const QLineF& l2, QPointF* intersectionPoint)
+{
+	// The relations, and the point for collinear segments, are already exact
+	QPointF point;
+	const MyLineF::SegmentRelations relations = MyLineF(l1.p1(), l1.p2()).intersects_adaptive(l2, &point);
+	if (!(relations & MyLineF::LinesIntersect))
+		return relations;
+
+	if (!(relations & MyLineF::Parallel))
+	{
+		// Same formula as intersects_flsiV2(), but only the final rounding is lossy in practice
+		const DoubleDouble ax = DoubleDouble::difference(l1.x2(), l1.x1());
+		const DoubleDouble ay = DoubleDouble::difference(l1.y2(), l1.y1());
+		const DoubleDouble bx = DoubleDouble::difference(l2.x1(), l2.x2());
+		const DoubleDouble by = DoubleDouble::difference(l2.y1(), l2.y2());
+		const DoubleDouble cx = DoubleDouble::difference(l1.x1(), l2.x1());
+		const DoubleDouble cy = DoubleDouble::difference(l1.y1(), l2.y1());
+
+		const DoubleDouble denominator = ay*bx - ax*by;
+		const DoubleDouble nna = by*cx - bx*cy;
+		const DoubleDouble t = nna / denominator;
+
+		point = QPointF( (DoubleDouble{l1.x1(), 0} + ax*t).toDouble(),
+				(DoubleDouble{l1.y1(), 0} + ay*t).toDouble() );
+	}
+
+	if (intersectionPoint)
+		*intersectionPoint = point;
+	return relations;
+}
+
+void
+Reference::intersects(SegmentSpan lines1, SegmentSpan lines2, int count,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints)
+{
+	for (int i = 0; i < count; ++i)
+		relations[i] = intersects(lines1.at(i), lines2.at(i), intersectionPoints ? &intersectionPoints[i] : nullptr);
+}
@@ -0,0 +1,32 @@
+#ifndef REFERENCEINTERSECTION_H
+#define REFERENCEINTERSECTION_H
+
+#include "mylinef.h"
+#include "segmentbatch.h"
+
+/*
+	The reference results for the accuracy benchmarks. This is deliberately slow; it doesn't
+	compete with the other intersection functions.
+
+	The relations are exact (see MyLineF::intersects_adaptive()). For lines that cross, the
+	intersection point is calculated in double-double arithmetic (about 106 bits) from the exact
+	coordinate differences, then rounded to double. This is the correctly rounded point unless the
+	lines are within about 2^-50 (relative) of parallel, where even 106 bits aren't enough. For
+	collinear segments, the point is the exact midpoint of the overlap (or gap), like in
+	intersects_adaptive().
+
+	ASSUMPTION: No intermediate result overflows or underflows
+*/
+namespace Reference
+{
+
+// intersectionPoint is only written if the lines intersect
+MyLineF::SegmentRelations intersects(const QLineF& l1, const QLineF& l2, QPointF* intersectionPoint);
+
+// Calculates intersects(lines1[i], lines2[i], &intersectionPoints[i]) for 0 <= i < count
+void intersects(SegmentSpan lines1, SegmentSpan lines2, int count,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints);
+
+}
+
+#endif // REFERENCEINTERSECTION_H
@@ -0,0 +1,460 @@
+#include "segmentbatch.h"
+#include "algorithms.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+//==============
+// SegmentArrays
+//==============
+SegmentArrays::SegmentArrays(const QVector<MyLineF>& segments)
+{
+	reserve(segments.count());
+	for (const auto& segment : segments)
+		append(segment);
+}
+
+void SegmentArrays::reserve(int n)
+{
+	m_x1.reserve(n);
+	m_y1.reserve(n);
+	m_x2.reserve(n);
+	m_y2.reserve(n);
+}
+
+void SegmentArrays::append(const QLineF& segment)
+{
+	m_x1 << segment.x1();
+	m_y1 << segment.y1();
+	m_x2 << segment.x2();
+	m_y2 << segment.y2();
+}
+
+//====================
+// PreconditionedPairs
+//====================
+PreconditionedPairs::PreconditionedPairs(SegmentSpan lines1, SegmentSpan lines2, int count, Options options, int clusterSize) :
+	m_count(count)
+{
+	while ((2 << m_clusterShift) <= clusterSize)
+		++m_clusterShift;
+	const int size = 1 << m_clusterShift;
+
+	const SegmentSpan spans[] = {lines1, lines2};
+	const int paddedCount = (count + Padding-1) / Padding * Padding;
+	for (auto& coords : m_coords)
+		coords.resize(paddedCount);
+	m_clusters.reserve((count + size-1) / size);
+
+	for (int first = 0; first < count; first += size)
+	{
+		const int n = qMin(size, count - first);
+
+		// The bounding box of the cluster's finite coordinates
+		qreal minX = std::numeric_limits<qreal>::infinity();
+		qreal minY = minX;
+		qreal maxX = -minX;
+		qreal maxY = -minX;
+		for (const auto& span : spans)
+		{
+			for (int i = first; i < first + n; ++i)
+			{
+				for (qreal x : {span.x1[i], span.x2[i]})
+				{
+					if (std::isfinite(x))
+					{
+						minX = qMin(minX, x);
+						maxX = qMax(maxX, x);
+					}
+				}
+				for (qreal y : {span.y1[i], span.y2[i]})
+				{
+					if (std::isfinite(y))
+					{
+						minY = qMin(minY, y);
+						maxY = qMax(maxY, y);
+					}
+				}
+			}
+		}
+
+		Cluster cluster{0, 0, 1};
+		if (minX <= maxX && minY <= maxY) // At least 1 finite coordinate on each axis
+		{
+			// NOTE: Halved separately, because maxX - minX can overflow
+			if (options & Translate)
+			{
+				cluster.originX = minX/2 + maxX/2;
+				cluster.originY = minY/2 + maxY/2;
+			}
+
+			// maxAbs/inverseScale is in [0.5, 1), unless inverseScale or 1/inverseScale would overflow
+			const qreal maxAbs = qMax(qMax(qAbs(minX - cluster.originX), qAbs(maxX - cluster.originX)),
+					qMax(qAbs(minY - cluster.originY), qAbs(maxY - cluster.originY)));
+			if ((options & Rescale) && maxAbs > 0)
+			{
+				int exponent;
+				std::frexp(maxAbs, &exponent);
+
+				// NOTE: A subnormal maxAbs would give an inverseScale whose reciprocal is inf. Clamped, the
+				//       local coordinates are between 2^-53 and 0.5, which is still far from float's underflow.
+				if (exponent < std::numeric_limits<qreal>::max_exponent)
+					cluster.inverseScale = std::ldexp(qreal(1), qMax(exponent, std::numeric_limits<qreal>::min_exponent));
+			}
+		}
+		m_clusters << cluster;
+
+		// NOTE: Non-finite coordinates stay non-finite, and the last pair is repeated into the padding
+		const qreal scale = 1 / cluster.inverseScale;
+		const int end = (first + n == count) ? paddedCount : first + n;
+		for (int i = first; i < end; ++i)
+		{
+			const int source = qMin(i, count-1);
+			for (int set = 0; set < 2; ++set)
+			{
+				m_coords[4*set + 0][i] = float((spans[set].x1[source] - cluster.originX) * scale);
+				m_coords[4*set + 1][i] = float((spans[set].y1[source] - cluster.originY) * scale);
+				m_coords[4*set + 2][i] = float((spans[set].x2[source] - cluster.originX) * scale);
+				m_coords[4*set + 3][i] = float((spans[set].y2[source] - cluster.originY) * scale);
+			}
+		}
+	}
+}
+
+//===============
+// Batch kernels
+//===============
+#ifdef SIMD_HAVE_SSE2
+
+// The factors that qFuzzyCompare() multiplies the difference by, for each precision
+static inline double fuzzyCompareFactor(double) { return 1000000000000.0; }
+static inline float fuzzyCompareFactor(float) { return 100000.f; }
+
+// Lane-wise equivalent of Algo::robustFuzzyCompare()
+template <typename V>
+static inline V robustFuzzyCompare(V p1, V p2, V zeroTolerance)
+{
+	const V abs1 = abs(p1);
+	const V abs2 = abs(p2);
+	const V minAbs = min(abs1, abs2);
+
+	// qFuzzyCompare(p1, p2)
+	const V fuzzyEqual = lessEqual(abs(p1 - p2) * V::broadcast(fuzzyCompareFactor(typename V::Scalar())), minAbs);
+	const V nearZero = lessThan(max(abs1, abs2), zeroTolerance);
+
+	return select(greaterThan(minAbs, V::zero()), fuzzyEqual, nearZero);
+}
+
+// Lane-wise equivalent of `(denominator>0 && (n<0 || n>denominator)) || (denominator<0 && (n>0 || n<denominator))`
+template <typename V>
+static inline V outsideUnitInterval(V n, V denominator)
+{
+	const V zero = V::zero();
+	const V positive = greaterThan(denominator, zero) & (lessThan(n, zero) | greaterThan(n, denominator));
+	const V negative = lessThan(denominator, zero) & (greaterThan(n, zero) | lessThan(n, denominator));
+	return positive | negative;
+}
+
+// For kernels that work in the original coordinates
+struct KeepPoint
+{
+	QPointF operator()(int, const QPointF& p) const { return p; }
+};
+
+/*
+	Processes V::Width pairs, starting at index i.
+	Mirrors MyLineF::intersects_flsiV2() step by step; see there for the commentary.
+	Span is SegmentSpan for DoubleN, or FloatSegmentSpan for FloatN. Every intersection point is
+	passed through mapPoint(i+k, p) before it is written.
+*/
+template <typename V, typename Span, typename MapPoint = KeepPoint>
+static inline void flsiV2Block(Span lines1, Span lines2, int i,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints, MapPoint mapPoint = MapPoint())
+{
+	typedef typename V::Scalar Scalar;
+
+	const V x1 = V::load(lines1.x1 + i);
+	const V y1 = V::load(lines1.y1 + i);
+
+	const V ax = V::load(lines1.x2 + i) - x1;
+	const V ay = V::load(lines1.y2 + i) - y1;
+	const V lx1 = V::load(lines2.x1 + i);
+	const V ly1 = V::load(lines2.y1 + i);
+	const V bx = lx1 - V::load(lines2.x2 + i);
+	const V by = ly1 - V::load(lines2.y2 + i);
+	const V cx = x1 - lx1;
+	const V cy = y1 - ly1;
+
+	const V tolerance = V::broadcast(std::numeric_limits<Scalar>::epsilon())
+			* min(min(V::broadcast(1.0), ax*ax + ay*ay), bx*bx + by*by);
+
+	const V d1 = ay * bx;
+	const V d2 = ax * by;
+	const V denominator = d1 - d2;
+
+	const V na1 = by * cx;
+	const V na2 = bx * cy;
+
+	const V parallel = robustFuzzyCompare(d1, d2, tolerance);
+	const V collinear = parallel & robustFuzzyCompare(na1, na2, tolerance);
+
+	const V nna = na1 - na2;
+	const V nnb = ax * cy - ay * cx;
+	const V unbounded = outsideUnitInterval(nna, denominator) | outsideUnitInterval(nnb, denominator);
+
+	const int validBits = bitmask(isFinite(denominator));
+	const int parallelBits = bitmask(parallel);
+	const int collinearBits = bitmask(collinear);
+	const int unboundedBits = bitmask(unbounded);
+
+	alignas(64) Scalar px[V::Width];
+	alignas(64) Scalar py[V::Width];
+	if (intersectionPoints)
+	{
+		const V n = nna / denominator;
+		(x1 + ax*n).store(px);
+		(y1 + ay*n).store(py);
+	}
+
+	for (int k = 0; k < V::Width; ++k)
+	{
+		const int bit = 1 << k;
+		if (!(validBits & bit))
+			relations[i+k] = MyLineF::SegmentRelations();
+		else if (collinearBits & bit)
+		{
+			QPointF p;
+			relations[i+k] = Algo::analyzeCollinearSegments(lines1.at(i+k), lines2.at(i+k), intersectionPoints ? &p : nullptr);
+			if (intersectionPoints)
+				intersectionPoints[i+k] = mapPoint(i+k, p);
+		}
+		else if (parallelBits & bit)
+			relations[i+k] = MyLineF::Parallel;
+		else
+		{
+			if (intersectionPoints)
+				intersectionPoints[i+k] = mapPoint(i+k, QPointF(px[k], py[k]));
+
+			relations[i+k] = (unboundedBits & bit)
+					? MyLineF::SegmentRelations(MyLineF::LinesIntersect)
+					: MyLineF::LinesIntersect | MyLineF::SegmentsIntersect;
+		}
+	}
+}
+
+template <typename V>
+static inline void swapIf(V mask, V& a, V& b)
+{
+	const V oldA = a;
+	a = select(mask, b, a);
+	b = select(mask, oldA, b);
+}
+
+/*
+	Processes V::Width pairs, starting at index i.
+	Mirrors MyLineF::intersects_gaussElim() step by step, except that every branch is replaced by
+	evaluating both sides and selecting the result per lane:
+	- The column/row swaps used for pivoting become conditional swaps
+	- The rank-deficient and the normal back-substitution are both computed
+	- The relation is assembled from the lane masks
+*/
+template <typename V>
+static inline void gaussElimBlock(SegmentSpan lines1, SegmentSpan lines2, int i,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints)
+{
+	const V zero = V::zero();
+	const V half = V::broadcast(0.5);
+	const V one = V::broadcast(1);
+	const V epsilon = V::broadcast(std::numeric_limits<qreal>::epsilon());
+
+	V originX = V::load(lines1.x1 + i);
+	V originY = V::load(lines1.y1 + i);
+	V lOriginX = V::load(lines2.x1 + i);
+	V lOriginY = V::load(lines2.y1 + i);
+	V dirX = V::load(lines1.x2 + i) - originX;
+	V dirY = V::load(lines1.y2 + i) - originY;
+	V lDirX = V::load(lines2.x2 + i) - lOriginX;
+	V lDirY = V::load(lines2.y2 + i) - lOriginY;
+
+	V m00 = dirX, m01 = -lDirX, m02 = lOriginX - originX;
+	V m10 = dirY, m11 = -lDirY, m12 = lOriginY - originY;
+
+	// Select the pivot
+	const V swapColumns = greaterThan(abs(m01), abs(m00)) | greaterThan(abs(m11), abs(m00));
+	swapIf(swapColumns, m00, m01);
+	swapIf(swapColumns, m10, m11);
+	swapIf(swapColumns, originX, lOriginX);
+	swapIf(swapColumns, originY, lOriginY);
+	swapIf(swapColumns, dirX, lDirX);
+	swapIf(swapColumns, dirY, lDirY);
+
+	const V swapRows = greaterThan(abs(m10), abs(m00));
+	swapIf(swapRows, m00, m10);
+	swapIf(swapRows, m01, m11);
+	swapIf(swapRows, m02, m12);
+
+	// Bring to row-echelon form
+	const V pivot = one / m00;
+	m10 = m10 * -pivot;
+	m12 = fma(m10, m02, m12);
+	m11 = fma(m10, m01, m11);
+
+	const V rankDeficient = lessThan(abs(m11), abs(m00) * epsilon);
+
+	// Rank-deficient: Check for collinearity, then find the midpoint of the overlap/gap
+	V n = pivot * m02;
+	const V rX = fma(n, dirX, originX);
+	const V rY = fma(n, dirY, originY);
+	const V separate = greaterThan(abs(rX * lOriginY - rY * lOriginX),
+			V::broadcast(2 * std::numeric_limits<qreal>::epsilon()) * abs(lOriginX * lOriginY));
+
+	V n2 = pivot * (m02 - m01);
+	swapIf(greaterThan(n, n2), n, n2);
+
+	const V startsBefore = lessThan(n, zero);
+	const V startsWithin = andNot(startsBefore, lessEqual(n, one));
+	const V endsAfter = greaterThan(n2, one);
+	const V mid = select(startsBefore,
+			select(endsAfter, half, half * n2),
+			select(startsWithin, half * (n + select(endsAfter, one, n2)), half * (one + n)));
+	const V overlap = (startsBefore & greaterEqual(n2, zero)) | startsWithin;
+
+	// Not near-singular: Back-substitute normally
+	const V nb = m12 / m11;
+	const V na = pivot * fma(-nb, m01, m02);
+	const V outsideB = lessThan(nb, zero) | greaterThan(nb, one);
+	const V withinA = greaterEqual(na, zero) & lessEqual(na, one);
+
+	// Assemble the results
+	const int laneBits = (1 << V::Width) - 1;
+	const int parallelBits = bitmask(rankDeficient);
+	const int linesBits = ~bitmask(rankDeficient & separate) & laneBits;
+	const int segmentsBits = bitmask(select(rankDeficient, andNot(separate, overlap), andNot(outsideB, withinA)));
+
+	for (int k = 0; k < V::Width; ++k)
+	{
+		relations[i+k] = MyLineF::SegmentRelations(QFlag(
+				((linesBits >> k) & 1) * MyLineF::LinesIntersect
+				| ((segmentsBits >> k) & 1) * MyLineF::SegmentsIntersect
+				| ((parallelBits >> k) & 1) * MyLineF::Parallel));
+	}
+
+	if (intersectionPoints)
+	{
+		alignas(64) qreal px[V::Width];
+		alignas(64) qreal py[V::Width];
+		select(rankDeficient, fma(mid, dirX, originX), fma(nb, lDirX, lOriginX)).store(px);
+		select(rankDeficient, fma(mid, dirY, originY), fma(nb, lDirY, lOriginY)).store(py);
+
+		// The point is left untouched for parallel, non-collinear segments
+		for (int k = 0; k < V::Width; ++k)
+			intersectionPoints[i+k] = ((linesBits >> k) & 1) ? QPointF(px[k], py[k]) : intersectionPoints[i+k];
+	}
+}
+
+#endif // SIMD_HAVE_SSE2
+
+void Batch::intersects_flsiV2(SegmentSpan lines1, SegmentSpan lines2, int count,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints)
+{
+	int i = 0;
+
+#ifdef SIMD_HAVE_SSE2
+	typedef Simd::DoubleN V;
+	for (; i + V::Width <= count; i += V::Width)
+		flsiV2Block<V>(lines1, lines2, i, relations, intersectionPoints);
+#endif
+
+	// Remainder (or everything, if SIMD is unavailable)
+	for (; i < count; ++i)
+		relations[i] = lines1.at(i).intersects_flsiV2(lines2.at(i), intersectionPoints ? intersectionPoints + i : nullptr);
+}
+
+void Batch::intersects_gaussElim(SegmentSpan lines1, SegmentSpan lines2, int count,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints)
+{
+#ifdef SIMD_HAVE_SSE2
+	typedef Simd::DoubleN V;
+
+	int i = 0;
+	for (; i + V::Width <= count; i += V::Width)
+		gaussElimBlock<V>(lines1, lines2, i, relations, intersectionPoints);
+
+	if (i == count)
+		return;
+
+	// Pad the remainder to a full block by repeating its last pair, so that it takes the same path
+	qreal buffer[8][V::Width];
+	for (int k = 0; k < V::Width; ++k)
+	{
+		const int j = qMin(i+k, count-1);
+		buffer[0][k] = lines1.x1[j];
+		buffer[1][k] = lines1.y1[j];
+		buffer[2][k] = lines1.x2[j];
+		buffer[3][k] = lines1.y2[j];
+		buffer[4][k] = lines2.x1[j];
+		buffer[5][k] = lines2.y1[j];
+		buffer[6][k] = lines2.x2[j];
+		buffer[7][k] = lines2.y2[j];
+	}
+
+	MyLineF::SegmentRelations tailRelations[V::Width];
+	QPointF tailPoints[V::Width];
+	const int nTail = count - i;
+	if (intersectionPoints)
+		std::copy(intersectionPoints + i, intersectionPoints + count, tailPoints);
+
+	gaussElimBlock<V>({buffer[0], buffer[1], buffer[2], buffer[3]}, {buffer[4], buffer[5], buffer[6], buffer[7]}, 0,
+			tailRelations, intersectionPoints ? tailPoints : nullptr);
+
+	std::copy(tailRelations, tailRelations + nTail, relations + i);
+	if (intersectionPoints)
+		std::copy(tailPoints, tailPoints + nTail, intersectionPoints + i);
+#else
+	for (int i = 0; i < count; ++i)
+		relations[i] = lines1.at(i).intersects_gaussElim(lines2.at(i), intersectionPoints ? intersectionPoints + i : nullptr);
+#endif
+}
+
+void Batch::intersects_flsiV2(const PreconditionedPairs& pairs, MyLineF::SegmentRelations* relations,
+		QPointF* intersectionPoints)
+{
+	const FloatSegmentSpan lines1 = pairs.lines1();
+	const FloatSegmentSpan lines2 = pairs.lines2();
+	const int count = pairs.count();
+	const auto toOriginal = [&pairs](int i, const QPointF& p) { return pairs.toOriginal(i, p); };
+
+#ifdef SIMD_HAVE_SSE2
+	typedef Simd::FloatN V;
+
+	int i = 0;
+	for (; i + V::Width <= count; i += V::Width)
+		flsiV2Block<V>(lines1, lines2, i, relations, intersectionPoints, toOriginal);
+
+	if (i == count)
+		return;
+
+	// The padding makes the last block full, but the outputs aren't padded
+	MyLineF::SegmentRelations tailRelations[V::Width];
+	QPointF tailPoints[V::Width];
+	const int nTail = count - i;
+	if (intersectionPoints)
+		std::copy(intersectionPoints + i, intersectionPoints + count, tailPoints);
+
+	flsiV2Block<V>(lines1.offset(i), lines2.offset(i), 0, tailRelations, intersectionPoints ? tailPoints : nullptr,
+			[&](int k, const QPointF& p) { return pairs.toOriginal(i+k, p); });
+
+	std::copy(tailRelations, tailRelations + nTail, relations + i);
+	if (intersectionPoints)
+		std::copy(tailPoints, tailPoints + nTail, intersectionPoints + i);
+#else
+	for (int i = 0; i < count; ++i)
+	{
+		QPointF p;
+		relations[i] = lines1.at(i).intersects_flsiV2(lines2.at(i), intersectionPoints ? &p : nullptr);
+		if (intersectionPoints && (relations[i] & MyLineF::LinesIntersect))
+			intersectionPoints[i] = toOriginal(i, p);
+	}
+#endif
+}
@@ -0,0 +1,165 @@
+#ifndef SEGMENTBATCH_H
+#define SEGMENTBATCH_H
+
+#include "mylinef.h"
+
+#include <QVector>
+
+/*
+	Non-owning, structure-of-arrays view of N line segments.
+	Segment i is {(x1[i], y1[i]), (x2[i], y2[i])}
+*/
+struct SegmentSpan
+{
+	const qreal* x1;
+	const qreal* y1;
+	const qreal* x2;
+	const qreal* y2;
+
+	SegmentSpan offset(int i) const { return {x1+i, y1+i, x2+i, y2+i}; }
+	MyLineF at(int i) const { return MyLineF(x1[i], y1[i], x2[i], y2[i]); }
+};
+
+// Structure-of-arrays storage for N line segments
+class SegmentArrays
+{
+public:
+	SegmentArrays() = default;
+	explicit SegmentArrays(const QVector<MyLineF>& segments);
+
+	int count() const { return m_x1.count(); }
+	void reserve(int n);
+	void append(const QLineF& segment);
+
+	MyLineF at(int i) const { return MyLineF(m_x1[i], m_y1[i], m_x2[i], m_y2[i]); }
+	SegmentSpan span() const { return {m_x1.constData(), m_y1.constData(), m_x2.constData(), m_y2.constData()}; }
+
+private:
+	QVector<qreal> m_x1;
+	QVector<qreal> m_y1;
+	QVector<qreal> m_x2;
+	QVector<qreal> m_y2;
+};
+
+// Same as SegmentSpan, in single precision
+struct FloatSegmentSpan
+{
+	const float* x1;
+	const float* y1;
+	const float* x2;
+	const float* y2;
+
+	FloatSegmentSpan offset(int i) const { return {x1+i, y1+i, x2+i, y2+i}; }
+	MyLineF at(int i) const { return MyLineF(x1[i], y1[i], x2[i], y2[i]); }
+};
+
+/*
+	Single-precision copies of N pairs of line segments, for the float32 kernels.
+
+	Rounding coordinates like -3400 to float would leave only about 0.0002 of precision, so pairs
+	are first moved into local coordinates, in clusters of clusterSize consecutive pairs:
+	- Translate moves the center of the cluster's bounding box to the origin, so the precision
+	  depends on the size of the cluster instead of its distance from the origin
+	- Rescale multiplies by a power of 2 (which is exact), so that the largest local coordinate is
+	  between 0.5 and 1. This keeps the products in the kernels far from float's overflow and
+	  underflow, e.g. for segments shorter than 1e-19 or longer than 1e19.
+
+	Both segments of a pair are always in the same cluster, so the relations don't change, and
+	intersection points can be mapped back with toOriginal(). The default clusterSize of 1 gives
+	every pair its own origin, at the cost of 24 bytes per pair. Larger clusters are cheaper, but
+	they only keep the precision if the caller sorts the pairs spatially first (e.g. along a
+	space-filling curve): A cluster of unsorted pairs can span the whole data set, and then its
+	origin can be farther from some of its pairs than (0, 0) was.
+
+	NOTE: clusterSize is rounded down to a power of 2, so that finding the cluster of a pair is a shift
+
+	Segments with non-finite coordinates stay non-finite, so the kernels still treat them as
+	invalid input.
+*/
+class PreconditionedPairs
+{
+public:
+	enum { DefaultClusterSize = 1 };
+
+	// The arrays are padded to a multiple of this many pairs, so the kernels can always load full vectors
+	enum { Padding = 64 };
+
+	enum Option
+	{
+		Translate = 0x1,
+		Rescale = 0x2
+	};
+	Q_DECLARE_FLAGS(Options, Option)
+
+	PreconditionedPairs() = default;
+	PreconditionedPairs(SegmentSpan lines1, SegmentSpan lines2, int count,
+			Options options = Options(Translate) | Rescale, int clusterSize = DefaultClusterSize);
+
+	int count() const { return m_count; }
+
+	// NOTE: These are padded to a multiple of Padding, by repeating the last pair
+	FloatSegmentSpan lines1() const { return {m_coords[0].constData(), m_coords[1].constData(), m_coords[2].constData(), m_coords[3].constData()}; }
+	FloatSegmentSpan lines2() const { return {m_coords[4].constData(), m_coords[5].constData(), m_coords[6].constData(), m_coords[7].constData()}; }
+
+	// Maps a point from the local coordinates of pair i back to the original coordinates
+	QPointF toOriginal(int i, const QPointF& local) const
+	{
+		const Cluster& cluster = m_clusters[i >> m_clusterShift];
+		return QPointF(cluster.originX + local.x() * cluster.inverseScale, cluster.originY + local.y() * cluster.inverseScale);
+	}
+
+private:
+	struct Cluster
+	{
+		qreal originX;
+		qreal originY;
+		qreal inverseScale; // A power of 2
+	};
+
+	int m_count = 0;
+	int m_clusterShift = 0; // log2(clusterSize)
+	QVector<Cluster> m_clusters;
+	QVector<float> m_coords[8]; // x1, y1, x2 and y2 of lines1, then of lines2
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(PreconditionedPairs::Options)
+
+namespace Batch
+{
+
+/*
+	Calculates lines1[i].intersects_flsiV2(lines2[i], &intersectionPoints[i]) for 0 <= i < count.
+
+	The results are bit-identical to the scalar function, including leaving intersectionPoints[i]
+	untouched whenever the scalar function would. intersectionPoints may be null.
+*/
+void intersects_flsiV2(SegmentSpan lines1, SegmentSpan lines2, int count,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints = nullptr);
+
+/*
+	Calculates lines1[i].intersects_gaussElim(lines2[i], &intersectionPoints[i]) for 0 <= i < count.
+
+	Unlike the scalar function, the pivot selection, the rank-deficiency test and the
+	back-substitution are all branch-free, so every pair takes the same path through the code.
+	2, 4 or 8 pairs are processed at a time (SSE2, AVX or AVX-512), including the remainder.
+	The results are bit-identical to the scalar function.
+*/
+void intersects_gaussElim(SegmentSpan lines1, SegmentSpan lines2, int count,
+		MyLineF::SegmentRelations* relations, QPointF* intersectionPoints = nullptr);
+
+/*
+	Calculates intersects_flsiV2() for every pair in single precision, in their local coordinates,
+	and maps the intersection points back to the original coordinates. FloatN has twice as many
+	lanes as DoubleN, so this processes twice as many pairs per instruction as the SegmentSpan
+	overload, and reads half as many bytes.
+
+	The results are NOT bit-identical to the scalar function: The fuzzy compares use the tolerances
+	of qFuzzyCompare(float) and FLT_EPSILON, and the points are about as precise as float allows
+	within each cluster. Without SIMD, this falls back to the scalar function in local coordinates.
+*/
+void intersects_flsiV2(const PreconditionedPairs& pairs, MyLineF::SegmentRelations* relations,
+		QPointF* intersectionPoints = nullptr);
+
+}
+
+#endif // SEGMENTBATCH_H
@@ -0,0 +1,398 @@
+#include "segmentbvh.h"
+#include "allpairs.h"
+#include "preparedline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+
+/*
+	The distance along the Hilbert curve that fills a 65536x65536 grid, for the cell (x, y).
+	Nearby cells tend to have nearby indices.
+*/
+quint32 hilbertIndex(quint32 x, quint32 y)
+{
+	const quint32 n = 1u << 16;
+
+	quint32 d = 0;
+	for (quint32 s = n/2; s > 0; s /= 2)
+	{
+		const quint32 rx = (x & s) ? 1 : 0;
+		const quint32 ry = (y & s) ? 1 : 0;
+		d += s * s * ((3 * rx) ^ ry);
+
+		// Rotate the quadrant so that the curve inside it starts and ends at the right corners
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = n-1 - x;
+				y = n-1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+/*
+	Where the query first meets the segment, as a fraction of the query's length.
+	Clamped to [0, 1], because intersects_flsiV2() may put the intersection point just outside the
+	query due to rounding errors.
+*/
+qreal hitParameter(const QLineF& query, const QLineF& segment, const SegmentHit& hit)
+{
+	const QPointF d = query.p2() - query.p1();
+	const qreal lengthSquared = QPointF::dotProduct(d, d);
+	if (lengthSquared == 0)
+		return 0;
+
+	const auto project = [&](const QPointF& p) { return QPointF::dotProduct(p - query.p1(), d) / lengthSquared; };
+
+	qreal t;
+	if (hit.relations.testFlag(MyLineF::Parallel))
+		t = qMin(project(segment.p1()), project(segment.p2()));
+	else
+		t = project(hit.point);
+
+	return qBound(qreal(0), t, qreal(1));
+}
+
+// The first-hit order: Nearest first, then lowest index first
+bool isBetterHit(qreal t1, int index1, qreal t2, int index2)
+{
+	return t1 < t2 || (t1 == t2 && index1 < index2);
+}
+
+}
+
+/*
+	The query segment p + t*d (0 <= t <= 1), for clipping against bounding boxes.
+
+	The boxes are padded by `margin` because intersects_flsiV2() is fuzzy: It can report
+	SegmentsIntersect for segments that miss each other by a tiny distance (for example,
+	almost-collinear segments).
+*/
+struct SegmentBvh::Ray
+{
+	Ray(const QLineF& segment, qreal margin) :
+		px(segment.x1()),
+		py(segment.y1()),
+		dx(segment.dx()),
+		dy(segment.dy()),
+		invDx(1 / dx),
+		invDy(1 / dy),
+		margin(margin)
+	{}
+
+	// Returns true if some part of the ray is inside the padded box, and stores the smallest such t
+	bool clip(qreal minX, qreal minY, qreal maxX, qreal maxY, qreal* tEntry) const
+	{
+		qreal tNear = 0;
+		qreal tFar = 1;
+
+		// NOTE: Empty boxes have min > max, so they are always missed
+		if (dx != 0)
+		{
+			const qreal nearX = (dx > 0) ? minX - margin : maxX + margin;
+			const qreal farX = (dx > 0) ? maxX + margin : minX - margin;
+			tNear = qMax(tNear, (nearX - px) * invDx);
+			tFar = qMin(tFar, (farX - px) * invDx);
+		}
+		else if (px < minX - margin || px > maxX + margin)
+			return false;
+
+		if (dy != 0)
+		{
+			const qreal nearY = (dy > 0) ? minY - margin : maxY + margin;
+			const qreal farY = (dy > 0) ? maxY + margin : minY - margin;
+			tNear = qMax(tNear, (nearY - py) * invDy);
+			tFar = qMin(tFar, (farY - py) * invDy);
+		}
+		else if (py < minY - margin || py > maxY + margin)
+			return false;
+
+		*tEntry = tNear;
+		return tNear <= tFar;
+	}
+
+	qreal px, py;
+	qreal dx, dy;
+	qreal invDx, invDy;
+	qreal margin;
+};
+
+SegmentBvh::SegmentBvh(const QVector<MyLineF>& segments) :
+	m_extent(0)
+{
+	// Map the centres of the segments onto the Hilbert curve's grid
+	qreal left = std::numeric_limits<qreal>::max(), right = std::numeric_limits<qreal>::lowest();
+	qreal top = left, bottom = right;
+	for (const auto& segment : segments)
+	{
+		if (AllPairs::isDegenerate(segment))
+			continue;
+
+		const QPointF centre = (segment.p1() + segment.p2()) / 2;
+		left = qMin(left, centre.x());
+		right = qMax(right, centre.x());
+		top = qMin(top, centre.y());
+		bottom = qMax(bottom, centre.y());
+		m_extent = std::max({m_extent, qAbs(segment.x1()), qAbs(segment.y1()), qAbs(segment.x2()), qAbs(segment.y2())});
+	}
+	const qreal gridMax = (1 << 16) - 1;
+	const qreal scaleX = (right > left) ? gridMax / (right - left) : 0;
+	const qreal scaleY = (bottom > top) ? gridMax / (bottom - top) : 0;
+
+	QVector<std::pair<quint32, int>> keys;
+	keys.reserve(segments.count());
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		if (AllPairs::isDegenerate(segments[i]))
+			continue;
+
+		const QPointF centre = (segments[i].p1() + segments[i].p2()) / 2;
+		const quint32 x = quint32((centre.x() - left) * scaleX);
+		const quint32 y = quint32((centre.y() - top) * scaleY);
+		keys << std::make_pair(hilbertIndex(x, y), i);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	m_segments.reserve(keys.count());
+	m_indices.reserve(keys.count());
+	for (const auto& key : keys)
+	{
+		m_segments << segments[key.second];
+		m_indices << key.second;
+	}
+
+	const int n = m_segments.count();
+	if (n == 0)
+		return;
+
+	// Reserve the whole tree up front
+	int nNodes = 0;
+	for (int levelCount = n; levelCount > 1 || nNodes == 0; )
+	{
+		levelCount = (levelCount + NodeSize-1) / NodeSize;
+		nNodes += levelCount;
+	}
+	m_nodes.reserve(nNodes);
+
+	Node emptyNode;
+	std::fill_n(emptyNode.minX, int(NodeSize), std::numeric_limits<qreal>::infinity());
+	std::fill_n(emptyNode.minY, int(NodeSize), std::numeric_limits<qreal>::infinity());
+	std::fill_n(emptyNode.maxX, int(NodeSize), -std::numeric_limits<qreal>::infinity());
+	std::fill_n(emptyNode.maxY, int(NodeSize), -std::numeric_limits<qreal>::infinity());
+
+	// Leaves: Each slot holds the bounding box of one segment
+	int levelCount = (n + NodeSize-1) / NodeSize;
+	m_levelStart << 0;
+	for (int k = 0; k < levelCount; ++k)
+	{
+		Node node = emptyNode;
+		for (int slot = 0; slot < NodeSize && k*NodeSize + slot < n; ++slot)
+		{
+			const MyLineF& segment = m_segments[k*NodeSize + slot];
+			node.minX[slot] = qMin(segment.x1(), segment.x2());
+			node.minY[slot] = qMin(segment.y1(), segment.y2());
+			node.maxX[slot] = qMax(segment.x1(), segment.x2());
+			node.maxY[slot] = qMax(segment.y1(), segment.y2());
+		}
+		m_nodes << node;
+	}
+
+	// Inner nodes: Each slot holds the union of all the slots of one child
+	while (levelCount > 1)
+	{
+		const int childStart = m_levelStart.last();
+		const int childCount = levelCount;
+		levelCount = (childCount + NodeSize-1) / NodeSize;
+		m_levelStart << m_nodes.count();
+
+		for (int k = 0; k < levelCount; ++k)
+		{
+			Node node = emptyNode;
+			for (int slot = 0; slot < NodeSize && k*NodeSize + slot < childCount; ++slot)
+			{
+				const Node& child = m_nodes.at(childStart + k*NodeSize + slot);
+				node.minX[slot] = *std::min_element(child.minX, child.minX + NodeSize);
+				node.minY[slot] = *std::min_element(child.minY, child.minY + NodeSize);
+				node.maxX[slot] = *std::max_element(child.maxX, child.maxX + NodeSize);
+				node.maxY[slot] = *std::max_element(child.maxY, child.maxY + NodeSize);
+			}
+			m_nodes << node;
+		}
+	}
+}
+
+qint64 SegmentBvh::memoryUsage() const
+{
+	return sizeof(*this)
+			+ qint64(m_nodes.capacity()) * sizeof(Node)
+			+ qint64(m_levelStart.capacity()) * sizeof(int)
+			+ qint64(m_segments.capacity()) * sizeof(MyLineF)
+			+ qint64(m_indices.capacity()) * sizeof(int);
+}
+
+QVector<SegmentHit> SegmentBvh::findIntersecting(const QLineF& query) const
+{
+	QVector<SegmentHit> hits;
+	if (m_nodes.isEmpty() || AllPairs::isDegenerate(query))
+		return hits;
+
+	const PreparedLine preparedQuery(query);
+	const Ray ray(query, 1e-9 * (m_extent + std::max({qAbs(query.x1()), qAbs(query.y1()), qAbs(query.x2()), qAbs(query.y2())})));
+
+	// ASSUMPTION: The tree has fewer than 2^32 segments, so the stack never holds more than
+	//             depth()*(NodeSize-1) + 1 entries
+	struct Entry { int level; int node; };
+	Entry stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = Entry{depth()-1, 0};
+
+	while (stackSize > 0)
+	{
+		const Entry entry = stack[--stackSize];
+		const Node& node = m_nodes[m_levelStart[entry.level] + entry.node];
+		for (int slot = 0; slot < NodeSize; ++slot)
+		{
+			qreal tEntry;
+			if (!ray.clip(node.minX[slot], node.minY[slot], node.maxX[slot], node.maxY[slot], &tEntry))
+				continue;
+
+			const int child = entry.node*NodeSize + slot;
+			if (entry.level > 0)
+			{
+				stack[stackSize++] = Entry{entry.level-1, child};
+				continue;
+			}
+
+			SegmentHit hit{m_indices[child], MyLineF::SegmentRelations(), QPointF(Q_QNAN, Q_QNAN)};
+			hit.relations = preparedQuery.intersects_flsiV2(m_segments[child], &hit.point);
+			if (hit.relations.testFlag(MyLineF::SegmentsIntersect))
+				hits << hit;
+		}
+	}
+
+	std::sort(hits.begin(), hits.end(), [](const SegmentHit& a, const SegmentHit& b) { return a.index < b.index; });
+	return hits;
+}
+
+/*
+	Visits the children that the ray enters first before the others, and skips every child that
+	the ray only enters after the best hit so far.
+*/
+bool SegmentBvh::findFirstHit(const QLineF& query, SegmentHit* hit) const
+{
+	if (m_nodes.isEmpty() || AllPairs::isDegenerate(query))
+		return false;
+
+	const PreparedLine preparedQuery(query);
+	const Ray ray(query, 1e-9 * (m_extent + std::max({qAbs(query.x1()), qAbs(query.y1()), qAbs(query.x2()), qAbs(query.y2())})));
+
+	SegmentHit best{-1, MyLineF::SegmentRelations(), QPointF(Q_QNAN, Q_QNAN)};
+	qreal bestT = std::numeric_limits<qreal>::infinity();
+
+	struct Entry { int level; int node; qreal tEntry; };
+	Entry stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = Entry{depth()-1, 0, 0};
+
+	while (stackSize > 0)
+	{
+		const Entry entry = stack[--stackSize];
+		if (entry.tEntry > bestT)
+			continue;
+
+		const Node& node = m_nodes[m_levelStart[entry.level] + entry.node];
+		Entry children[NodeSize];
+		int nChildren = 0;
+		for (int slot = 0; slot < NodeSize; ++slot)
+		{
+			qreal tEntry;
+			if (!ray.clip(node.minX[slot], node.minY[slot], node.maxX[slot], node.maxY[slot], &tEntry) || tEntry > bestT)
+				continue;
+
+			const int child = entry.node*NodeSize + slot;
+			if (entry.level > 0)
+			{
+				children[nChildren++] = Entry{entry.level-1, child, tEntry};
+				continue;
+			}
+
+			SegmentHit candidate{m_indices[child], MyLineF::SegmentRelations(), QPointF(Q_QNAN, Q_QNAN)};
+			candidate.relations = preparedQuery.intersects_flsiV2(m_segments[child], &candidate.point);
+			if (!candidate.relations.testFlag(MyLineF::SegmentsIntersect))
+				continue;
+
+			const qreal t = hitParameter(query, m_segments[child], candidate);
+			if (isBetterHit(t, candidate.index, bestT, best.index))
+			{
+				best = candidate;
+				bestT = t;
+			}
+		}
+
+		// Push the farthest child first, so that the nearest one is popped next
+		for (int i = 1; i < nChildren; ++i)
+		{
+			for (int j = i; j > 0 && children[j].tEntry > children[j-1].tEntry; --j)
+				std::swap(children[j], children[j-1]);
+		}
+		for (int i = 0; i < nChildren; ++i)
+			stack[stackSize++] = children[i];
+	}
+
+	if (best.index < 0)
+		return false;
+	if (hit)
+		*hit = best;
+	return true;
+}
+
+QVector<SegmentHit> SegmentBvh::findIntersecting_linear(const QVector<MyLineF>& segments, const QLineF& query)
+{
+	QVector<SegmentHit> hits;
+	if (AllPairs::isDegenerate(query))
+		return hits;
+
+	const MyLineF myQuery(query.p1(), query.p2());
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		if (AllPairs::isDegenerate(segments[i]))
+			continue;
+
+		SegmentHit hit{i, MyLineF::SegmentRelations(), QPointF(Q_QNAN, Q_QNAN)};
+		hit.relations = myQuery.intersects_flsiV2(segments[i], &hit.point);
+		if (hit.relations.testFlag(MyLineF::SegmentsIntersect))
+			hits << hit;
+	}
+	return hits;
+}
+
+bool SegmentBvh::findFirstHit_linear(const QVector<MyLineF>& segments, const QLineF& query, SegmentHit* hit)
+{
+	const auto hits = findIntersecting_linear(segments, query);
+	if (hits.isEmpty())
+		return false;
+
+	int best = 0;
+	qreal bestT = hitParameter(query, segments[hits[0].index], hits[0]);
+	for (int i = 1; i < hits.count(); ++i)
+	{
+		const qreal t = hitParameter(query, segments[hits[i].index], hits[i]);
+		if (isBetterHit(t, hits[i].index, bestT, hits[best].index))
+		{
+			best = i;
+			bestT = t;
+		}
+	}
+	if (hit)
+		*hit = hits[best];
+	return true;
+}
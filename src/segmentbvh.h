@@ -0,0 +1,87 @@
+#ifndef SEGMENTBVH_H
+#define SEGMENTBVH_H
+
+#include "mylinef.h"
+
+#include <QVector>
+
+// One segment found by a one-vs-many query
+struct SegmentHit
+{
+	int index; // Index into the segments that the SegmentBvh was built from
+	MyLineF::SegmentRelations relations;
+	QPointF point;
+};
+
+/*
+	Immutable bounding volume hierarchy over a fixed set of line segments, for testing one query
+	segment against all of them (e.g. a cursor ray against all the edges in a scene).
+
+	The tree is bulk-loaded as a packed R-tree: The segments are sorted along a Hilbert curve
+	through the centres of their bounding boxes, then grouped NodeSize at a time, level by level,
+	until only the root is left. Since every level is full (except for its last node), the
+	children of a node are found by their position alone, so the nodes only need to store
+	their children's bounding boxes.
+
+	The nodes are stored level by level in one flat array, from the leaves up to the root. Each
+	node is aligned to a cache line.
+*/
+class SegmentBvh
+{
+public:
+	// NOTE: Degenerate segments (see AllPairs::isDegenerate()) are left out of the tree, and
+	//       degenerate queries don't hit anything
+	explicit SegmentBvh(const QVector<MyLineF>& segments);
+
+	int count() const { return m_indices.count(); }
+	int nodeCount() const { return m_nodes.count(); }
+	int depth() const { return m_levelStart.count(); }
+
+	// The number of bytes allocated for the tree, including the sorted copy of the segments
+	qint64 memoryUsage() const;
+
+	/*
+		Finds every segment s for which MyLineF(query).intersects_flsiV2(s) reports
+		SegmentsIntersect, in the same order as the segments were given to the constructor.
+	*/
+	QVector<SegmentHit> findIntersecting(const QLineF& query) const;
+
+	/*
+		Finds the intersecting segment that is hit first when travelling from query.p1() to
+		query.p2(). If several segments are hit at the same point, the one with the lowest index
+		wins. For collinear overlaps, the hit is where the overlap starts.
+
+		Returns false if the query doesn't intersect any segments.
+	*/
+	bool findFirstHit(const QLineF& query, SegmentHit* hit) const;
+
+	// Both queries by testing every segment. This is the reference for the tree.
+	static QVector<SegmentHit> findIntersecting_linear(const QVector<MyLineF>& segments, const QLineF& query);
+	static bool findFirstHit_linear(const QVector<MyLineF>& segments, const QLineF& query, SegmentHit* hit);
+
+private:
+	enum { NodeSize = 4 };
+
+	// The bounding boxes of up to NodeSize children, in structure-of-arrays form.
+	// Unused slots hold empty boxes, which never overlap anything.
+	struct alignas(64) Node
+	{
+		qreal minX[NodeSize];
+		qreal minY[NodeSize];
+		qreal maxX[NodeSize];
+		qreal maxY[NodeSize];
+	};
+
+	struct Ray;
+
+	QVector<Node> m_nodes;
+	QVector<int> m_levelStart; // Level 0 holds the leaves; the last level holds only the root
+
+	// The segments in Hilbert order: The children of leaf k are m_segments[k*NodeSize + slot]
+	QVector<MyLineF> m_segments;
+	QVector<int> m_indices;
+
+	qreal m_extent; // Used to pad the boxes against rounding errors in intersects_flsiV2()
+};
+
+#endif // SEGMENTBVH_H
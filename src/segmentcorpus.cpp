@@ -0,0 +1,186 @@
+#include "segmentcorpus.h"
+
+#include <cstring>
+#include <type_traits>
+
+// ASSUMPTION: MyLineF is exactly 4 qreals, so a pair record can be used in place as a SegmentPair
+static_assert(sizeof(SegmentPair) == 8*sizeof(qreal) && std::is_standard_layout<SegmentPair>::value,
+		"SegmentPair doesn't match the corpus record layout");
+static_assert(sizeof(QPointF) == 2*sizeof(qreal), "QPointF doesn't match the corpus point layout");
+
+static const char magic[8] = {'Q', 'S', 'E', 'G', 'P', 'A', 'I', 'R'};
+
+//========
+// Writer
+//========
+bool SegmentCorpus::Writer::open(const QString& path, Contents contents)
+{
+	close();
+	m_contents = contents;
+	m_count = 0;
+	m_errorString.clear();
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+	m_errorString = "Corpus files can only be written on little-endian machines";
+	return false;
+#endif
+
+	m_file.setFileName(path);
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		m_errorString = QString("Can't create %1: %2").arg(path).arg(m_file.errorString());
+		return false;
+	}
+	if ( (contents & ExpectedPoints) && !(m_pointsFile.open() && m_pointsFile.resize(0)) )
+	{
+		m_errorString = QString("Can't create a temporary file: %1").arg(m_pointsFile.errorString());
+		m_file.close();
+		return false;
+	}
+	if ( (contents & ExpectedRelations) && !(m_relationsFile.open() && m_relationsFile.resize(0)) )
+	{
+		m_errorString = QString("Can't create a temporary file: %1").arg(m_relationsFile.errorString());
+		m_file.close();
+		m_pointsFile.close();
+		return false;
+	}
+
+	// Placeholder; the real header is written by close(), when the count is known
+	const Header header{};
+	m_ok = m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+	return m_ok;
+}
+
+void SegmentCorpus::Writer::append(const SegmentPair& pair, MyLineF::SegmentRelations relations, const QPointF& point)
+{
+	if (!m_file.isOpen())
+		return;
+
+	const qreal coords[8] =
+	{
+		pair.l1.x1(), pair.l1.y1(), pair.l1.x2(), pair.l1.y2(),
+		pair.l2.x1(), pair.l2.y1(), pair.l2.x2(), pair.l2.y2()
+	};
+	m_ok &= m_file.write(reinterpret_cast<const char*>(coords), sizeof(coords)) == sizeof(coords);
+
+	if (m_contents & ExpectedPoints)
+	{
+		const qreal xy[2] = {point.x(), point.y()};
+		m_ok &= m_pointsFile.write(reinterpret_cast<const char*>(xy), sizeof(xy)) == sizeof(xy);
+	}
+	if (m_contents & ExpectedRelations)
+	{
+		const char byte = char(int(relations));
+		m_ok &= m_relationsFile.write(&byte, 1) == 1;
+	}
+
+	++m_count;
+}
+
+bool SegmentCorpus::Writer::close()
+{
+	if (!m_file.isOpen())
+		return m_ok;
+
+	// Append the optional sections, in a fixed order
+	const auto appendSection = [this](QTemporaryFile& section)
+	{
+		if (!section.isOpen())
+			return;
+
+		section.seek(0);
+		while (m_ok && !section.atEnd())
+		{
+			const QByteArray block = section.read(1 << 20);
+			m_ok &= m_file.write(block) == qint64(block.size());
+		}
+		section.close();
+	};
+	appendSection(m_pointsFile);
+	appendSection(m_relationsFile);
+
+	Header header{};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = formatVersion;
+	header.contents = quint32(int(m_contents));
+	header.count = m_count;
+	m_ok &= m_file.seek(0);
+	m_ok &= m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+
+	m_file.close();
+	if (!m_ok && m_errorString.isEmpty())
+		m_errorString = QString("Failed to write %1").arg(m_file.fileName());
+	return m_ok;
+}
+
+//========
+// Reader
+//========
+bool SegmentCorpus::Reader::open(const QString& path)
+{
+	// Closing the file also unmaps it
+	m_file.close();
+	m_count = 0;
+	m_pairs = nullptr;
+	m_points = nullptr;
+	m_relations = nullptr;
+	m_errorString.clear();
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+	m_errorString = "Corpus files can only be read on little-endian machines";
+	return false;
+#endif
+
+	m_file.setFileName(path);
+	if (!m_file.open(QIODevice::ReadOnly))
+	{
+		m_errorString = QString("Can't open %1: %2").arg(path).arg(m_file.errorString());
+		return false;
+	}
+
+	// Closes (and unmaps) the file, so that a failed open() doesn't hold on to it
+	const auto fail = [this](const QString& errorString)
+	{
+		m_errorString = errorString;
+		m_file.close();
+		return false;
+	};
+
+	const qint64 fileSize = m_file.size();
+	const uchar* data = fileSize >= qint64(sizeof(Header)) ? m_file.map(0, fileSize) : nullptr;
+	if (!data)
+		return fail(QString("Can't map %1: %2").arg(path).arg(m_file.errorString()));
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+		return fail(QString("%1 is not a segment corpus").arg(path));
+	if (header.version != formatVersion)
+	{
+		return fail(QString("%1 has format version %2; only version %3 is supported")
+				.arg(path).arg(header.version).arg(formatVersion));
+	}
+
+	// NOTE: Checked before anything is multiplied by it, so that a corrupt count can't overflow
+	const quint64 maxCount = quint64(fileSize - qint64(sizeof(Header))) / sizeof(SegmentPair);
+	if (header.count > maxCount)
+	{
+		return fail(QString("%1 is truncated or corrupt: The header says %2 pairs, but there is only room for %3")
+				.arg(path).arg(header.count).arg(maxCount));
+	}
+
+	const Contents contents(int(header.contents));
+	const qint64 count = qint64(header.count);
+	const qint64 pointsOffset = sizeof(Header) + count*qint64(sizeof(SegmentPair));
+	const qint64 relationsOffset = pointsOffset + ((contents & ExpectedPoints) ? count*qint64(sizeof(QPointF)) : 0);
+	const qint64 expectedSize = relationsOffset + ((contents & ExpectedRelations) ? count : 0);
+	if (fileSize != expectedSize)
+		return fail(QString("%1 is truncated or corrupt: %2 bytes instead of %3").arg(path).arg(fileSize).arg(expectedSize));
+
+	m_count = count;
+	m_contents = contents;
+	m_pairs = reinterpret_cast<const SegmentPair*>(data + sizeof(Header));
+	m_points = (contents & ExpectedPoints) ? reinterpret_cast<const QPointF*>(data + pointsOffset) : nullptr;
+	m_relations = (contents & ExpectedRelations) ? data + relationsOffset : nullptr;
+	return true;
+}
@@ -0,0 +1,114 @@
+#ifndef SEGMENTCORPUS_H
+#define SEGMENTCORPUS_H
+
+#include "tests.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+
+/*
+	A binary file of recorded segment pairs, so that real workloads can be replayed.
+
+	Layout (all little-endian):
+		Header   64 bytes (see SegmentCorpus::Header)
+		Pairs    count * 8 doubles: {l1.x1, l1.y1, l1.x2, l1.y2, l2.x1, l2.y1, l2.x2, l2.y2}
+		Points   count * 2 doubles, if the ExpectedPoints flag is set (NaN where there was no point)
+		Results  count * 1 byte of MyLineF::SegmentRelations, if the ExpectedRelations flag is set
+
+	Each section is one contiguous array, so that the pairs can be used in place as SegmentPair.
+*/
+namespace SegmentCorpus
+{
+
+enum Content
+{
+	PairsOnly = 0,
+	ExpectedRelations = 1,
+	ExpectedPoints = 2
+};
+Q_DECLARE_FLAGS(Contents, Content)
+
+struct Header
+{
+	char magic[8];      // "QSEGPAIR"
+	quint32 version;    // formatVersion
+	quint32 contents;   // Contents
+	quint64 count;      // Number of pairs
+	quint8 reserved[40];
+};
+static_assert(sizeof(Header) == 64, "The pairs must start on a cache line boundary");
+
+const quint32 formatVersion = 1;
+
+/*
+	Writes a corpus file, one pair at a time. The optional sections go into temporary files until
+	close(), so the whole corpus never needs to be in memory.
+*/
+class Writer
+{
+	Q_DISABLE_COPY(Writer)
+
+public:
+	Writer() = default;
+	~Writer() { close(); }
+
+	bool open(const QString& path, Contents contents);
+
+	// The expected results are ignored unless open() was told to record them
+	void append(const SegmentPair& pair,
+			MyLineF::SegmentRelations relations = MyLineF::SegmentRelations(),
+			const QPointF& point = QPointF(Q_QNAN, Q_QNAN));
+
+	// Completes the file. Returns false if any write failed.
+	bool close();
+
+	QString errorString() const { return m_errorString; }
+
+private:
+	QFile m_file;
+	QTemporaryFile m_pointsFile;
+	QTemporaryFile m_relationsFile;
+	Contents m_contents;
+	quint64 m_count = 0;
+	bool m_ok = false;
+	QString m_errorString;
+};
+
+/*
+	A read-only, memory-mapped corpus file. Nothing is copied: The pages are read by the OS as
+	they are accessed, so the file can be much larger than RAM.
+*/
+class Reader
+{
+	Q_DISABLE_COPY(Reader)
+
+public:
+	Reader() = default;
+
+	bool open(const QString& path);
+	QString errorString() const { return m_errorString; }
+
+	qint64 count() const { return m_count; }
+	Contents contents() const { return m_contents; }
+
+	const SegmentPair* pairs() const { return m_pairs; }
+
+	// null if the corpus has no such section
+	const QPointF* expectedPoints() const { return m_points; }
+	const quint8* expectedRelations() const { return m_relations; }
+
+private:
+	QFile m_file;
+	qint64 m_count = 0;
+	Contents m_contents;
+	const SegmentPair* m_pairs = nullptr;
+	const QPointF* m_points = nullptr;
+	const quint8* m_relations = nullptr;
+	QString m_errorString;
+};
+
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(SegmentCorpus::Contents)
+
+#endif // SEGMENTCORPUS_H
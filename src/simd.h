@@ -0,0 +1,364 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+	Thin wrappers around the x86 SIMD intrinsics, so that the batch kernels can be written once as
+	templates and instantiated for each vector width and precision. FloatN has twice as many lanes
+	as DoubleN.
+
+	- Every comparison returns a lane mask of the same type as its operands (all bits set = true)
+	- Only operations that round exactly like their scalar counterparts are provided, so that the
+	  batch kernels can reproduce the scalar results bit-for-bit
+	- fma() is always fused: It uses the FMA instructions if available, or std::fma() per lane otherwise
+*/
+
+#include <QtGlobal>
+
+#include <cmath>
+
+#if defined(__AVX__) || defined(__FMA__)
+#  include <immintrin.h>
+#endif
+#if defined(__AVX__)
+#  define SIMD_HAVE_AVX 1
+#endif
+#if defined(__AVX512F__)
+#  define SIMD_HAVE_AVX512 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define SIMD_HAVE_SSE2 1
+#endif
+
+namespace Simd
+{
+
+#ifdef SIMD_HAVE_SSE2
+struct Double2
+{
+	typedef double Scalar;
+	enum { Width = 2 };
+	__m128d v;
+
+	static Double2 load(const double* p) { return {_mm_loadu_pd(p)}; }
+	static Double2 broadcast(double d) { return {_mm_set1_pd(d)}; }
+	static Double2 zero() { return {_mm_setzero_pd()}; }
+	void store(double* p) const { _mm_storeu_pd(p, v); }
+
+	friend Double2 operator+(Double2 a, Double2 b) { return {_mm_add_pd(a.v, b.v)}; }
+	friend Double2 operator-(Double2 a, Double2 b) { return {_mm_sub_pd(a.v, b.v)}; }
+	friend Double2 operator*(Double2 a, Double2 b) { return {_mm_mul_pd(a.v, b.v)}; }
+	friend Double2 operator/(Double2 a, Double2 b) { return {_mm_div_pd(a.v, b.v)}; }
+	friend Double2 operator&(Double2 a, Double2 b) { return {_mm_and_pd(a.v, b.v)}; }
+	friend Double2 operator|(Double2 a, Double2 b) { return {_mm_or_pd(a.v, b.v)}; }
+	friend Double2 operator-(Double2 a) { return {_mm_xor_pd(_mm_set1_pd(-0.0), a.v)}; }
+
+	friend Double2 fma(Double2 a, Double2 b, Double2 c)
+	{
+#ifdef __FMA__
+		return {_mm_fmadd_pd(a.v, b.v, c.v)};
+#else
+		alignas(16) double la[2], lb[2], lc[2];
+		a.store(la); b.store(lb); c.store(lc);
+		return {_mm_set_pd(std::fma(la[1], lb[1], lc[1]), std::fma(la[0], lb[0], lc[0]))};
+#endif
+	}
+
+	friend Double2 andNot(Double2 notThis, Double2 b) { return {_mm_andnot_pd(notThis.v, b.v)}; }
+	friend Double2 abs(Double2 a) { return {_mm_andnot_pd(_mm_set1_pd(-0.0), a.v)}; }
+	friend Double2 min(Double2 a, Double2 b) { return {_mm_min_pd(a.v, b.v)}; }
+	friend Double2 max(Double2 a, Double2 b) { return {_mm_max_pd(a.v, b.v)}; }
+
+	friend Double2 lessThan(Double2 a, Double2 b) { return {_mm_cmplt_pd(a.v, b.v)}; }
+	friend Double2 lessEqual(Double2 a, Double2 b) { return {_mm_cmple_pd(a.v, b.v)}; }
+	friend Double2 greaterThan(Double2 a, Double2 b) { return {_mm_cmpgt_pd(a.v, b.v)}; }
+	friend Double2 greaterEqual(Double2 a, Double2 b) { return {_mm_cmpge_pd(a.v, b.v)}; }
+	friend Double2 equal(Double2 a, Double2 b) { return {_mm_cmpeq_pd(a.v, b.v)}; }
+
+	// SSE2 has no blendv instruction, so emulate it with bitwise operations
+	friend Double2 select(Double2 mask, Double2 ifTrue, Double2 ifFalse)
+	{ return {_mm_or_pd(_mm_and_pd(mask.v, ifTrue.v), _mm_andnot_pd(mask.v, ifFalse.v))}; }
+
+	// NOTE: x - x is 0 for finite x, but NaN for Inf and NaN
+	friend Double2 isFinite(Double2 a) { return {_mm_cmpeq_pd(_mm_sub_pd(a.v, a.v), _mm_setzero_pd())}; }
+
+	// Bit N of the result is set if lane N of the mask is true
+	friend int bitmask(Double2 mask) { return _mm_movemask_pd(mask.v); }
+};
+#endif
+
+#ifdef SIMD_HAVE_AVX
+struct Double4
+{
+	typedef double Scalar;
+	enum { Width = 4 };
+	__m256d v;
+
+	static Double4 load(const double* p) { return {_mm256_loadu_pd(p)}; }
+	static Double4 broadcast(double d) { return {_mm256_set1_pd(d)}; }
+	static Double4 zero() { return {_mm256_setzero_pd()}; }
+	void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+	friend Double4 operator+(Double4 a, Double4 b) { return {_mm256_add_pd(a.v, b.v)}; }
+	friend Double4 operator-(Double4 a, Double4 b) { return {_mm256_sub_pd(a.v, b.v)}; }
+	friend Double4 operator*(Double4 a, Double4 b) { return {_mm256_mul_pd(a.v, b.v)}; }
+	friend Double4 operator/(Double4 a, Double4 b) { return {_mm256_div_pd(a.v, b.v)}; }
+	friend Double4 operator&(Double4 a, Double4 b) { return {_mm256_and_pd(a.v, b.v)}; }
+	friend Double4 operator|(Double4 a, Double4 b) { return {_mm256_or_pd(a.v, b.v)}; }
+	friend Double4 operator-(Double4 a) { return {_mm256_xor_pd(_mm256_set1_pd(-0.0), a.v)}; }
+
+	friend Double4 fma(Double4 a, Double4 b, Double4 c)
+	{
+#ifdef __FMA__
+		return {_mm256_fmadd_pd(a.v, b.v, c.v)};
+#else
+		alignas(32) double la[4], lb[4], lc[4];
+		a.store(la); b.store(lb); c.store(lc);
+		return {_mm256_set_pd(std::fma(la[3], lb[3], lc[3]), std::fma(la[2], lb[2], lc[2]),
+				std::fma(la[1], lb[1], lc[1]), std::fma(la[0], lb[0], lc[0]))};
+#endif
+	}
+
+	friend Double4 andNot(Double4 notThis, Double4 b) { return {_mm256_andnot_pd(notThis.v, b.v)}; }
+	friend Double4 abs(Double4 a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+	friend Double4 min(Double4 a, Double4 b) { return {_mm256_min_pd(a.v, b.v)}; }
+	friend Double4 max(Double4 a, Double4 b) { return {_mm256_max_pd(a.v, b.v)}; }
+
+	friend Double4 lessThan(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+	friend Double4 lessEqual(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)}; }
+	friend Double4 greaterThan(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+	friend Double4 greaterEqual(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ)}; }
+	friend Double4 equal(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)}; }
+
+	friend Double4 select(Double4 mask, Double4 ifTrue, Double4 ifFalse)
+	{ return {_mm256_blendv_pd(ifFalse.v, ifTrue.v, mask.v)}; }
+
+	friend Double4 isFinite(Double4 a) { return {_mm256_cmp_pd(_mm256_sub_pd(a.v, a.v), _mm256_setzero_pd(), _CMP_EQ_OQ)}; }
+
+	friend int bitmask(Double4 mask) { return _mm256_movemask_pd(mask.v); }
+};
+#endif
+
+#ifdef SIMD_HAVE_AVX512
+/*
+	AVX-512 comparisons produce a __mmask8 instead of a vector. To keep the same interface as the
+	narrower types, masks are widened into all-ones/all-zeros lanes.
+*/
+struct Double8
+{
+	typedef double Scalar;
+	enum { Width = 8 };
+	__m512d v;
+
+	static Double8 load(const double* p) { return {_mm512_loadu_pd(p)}; }
+	static Double8 broadcast(double d) { return {_mm512_set1_pd(d)}; }
+	static Double8 zero() { return {_mm512_setzero_pd()}; }
+	void store(double* p) const { _mm512_storeu_pd(p, v); }
+
+	friend Double8 operator+(Double8 a, Double8 b) { return {_mm512_add_pd(a.v, b.v)}; }
+	friend Double8 operator-(Double8 a, Double8 b) { return {_mm512_sub_pd(a.v, b.v)}; }
+	friend Double8 operator*(Double8 a, Double8 b) { return {_mm512_mul_pd(a.v, b.v)}; }
+	friend Double8 operator/(Double8 a, Double8 b) { return {_mm512_div_pd(a.v, b.v)}; }
+	friend Double8 operator&(Double8 a, Double8 b) { return fromBits(_mm512_and_si512(bits(a), bits(b))); }
+	friend Double8 operator|(Double8 a, Double8 b) { return fromBits(_mm512_or_si512(bits(a), bits(b))); }
+	friend Double8 operator-(Double8 a) { return fromBits(_mm512_xor_si512(bits(broadcast(-0.0)), bits(a))); }
+
+	friend Double8 fma(Double8 a, Double8 b, Double8 c) { return {_mm512_fmadd_pd(a.v, b.v, c.v)}; }
+
+	friend Double8 andNot(Double8 notThis, Double8 b) { return fromBits(_mm512_andnot_si512(bits(notThis), bits(b))); }
+	friend Double8 abs(Double8 a) { return {_mm512_abs_pd(a.v)}; }
+	friend Double8 min(Double8 a, Double8 b) { return {_mm512_min_pd(a.v, b.v)}; }
+	friend Double8 max(Double8 a, Double8 b) { return {_mm512_max_pd(a.v, b.v)}; }
+
+	friend Double8 lessThan(Double8 a, Double8 b) { return fromMask(_mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ)); }
+	friend Double8 lessEqual(Double8 a, Double8 b) { return fromMask(_mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ)); }
+	friend Double8 greaterThan(Double8 a, Double8 b) { return fromMask(_mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ)); }
+	friend Double8 greaterEqual(Double8 a, Double8 b) { return fromMask(_mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ)); }
+	friend Double8 equal(Double8 a, Double8 b) { return fromMask(_mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ)); }
+
+	friend Double8 select(Double8 mask, Double8 ifTrue, Double8 ifFalse)
+	{ return {_mm512_mask_blend_pd(toMask(mask), ifFalse.v, ifTrue.v)}; }
+
+	friend Double8 isFinite(Double8 a) { return equal(a - a, zero()); }
+
+	friend int bitmask(Double8 mask) { return toMask(mask); }
+
+private:
+	static __m512i bits(Double8 a) { return _mm512_castpd_si512(a.v); }
+	static Double8 fromBits(__m512i i) { return {_mm512_castsi512_pd(i)}; }
+	static Double8 fromMask(__mmask8 m) { return fromBits(_mm512_maskz_set1_epi64(m, -1)); }
+	static __mmask8 toMask(Double8 mask) { return _mm512_test_epi64_mask(bits(mask), bits(mask)); }
+};
+#endif
+
+#ifdef SIMD_HAVE_SSE2
+struct Float4
+{
+	typedef float Scalar;
+	enum { Width = 4 };
+	__m128 v;
+
+	static Float4 load(const float* p) { return {_mm_loadu_ps(p)}; }
+	static Float4 broadcast(float f) { return {_mm_set1_ps(f)}; }
+	static Float4 zero() { return {_mm_setzero_ps()}; }
+	void store(float* p) const { _mm_storeu_ps(p, v); }
+
+	friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+	friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+	friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+	friend Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+	friend Float4 operator&(Float4 a, Float4 b) { return {_mm_and_ps(a.v, b.v)}; }
+	friend Float4 operator|(Float4 a, Float4 b) { return {_mm_or_ps(a.v, b.v)}; }
+	friend Float4 operator-(Float4 a) { return {_mm_xor_ps(_mm_set1_ps(-0.0f), a.v)}; }
+
+	friend Float4 fma(Float4 a, Float4 b, Float4 c)
+	{
+#ifdef __FMA__
+		return {_mm_fmadd_ps(a.v, b.v, c.v)};
+#else
+		alignas(16) float la[4], lb[4], lc[4];
+		a.store(la); b.store(lb); c.store(lc);
+		return {_mm_set_ps(std::fma(la[3], lb[3], lc[3]), std::fma(la[2], lb[2], lc[2]),
+				std::fma(la[1], lb[1], lc[1]), std::fma(la[0], lb[0], lc[0]))};
+#endif
+	}
+
+	friend Float4 andNot(Float4 notThis, Float4 b) { return {_mm_andnot_ps(notThis.v, b.v)}; }
+	friend Float4 abs(Float4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+	friend Float4 min(Float4 a, Float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+	friend Float4 max(Float4 a, Float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+
+	friend Float4 lessThan(Float4 a, Float4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+	friend Float4 lessEqual(Float4 a, Float4 b) { return {_mm_cmple_ps(a.v, b.v)}; }
+	friend Float4 greaterThan(Float4 a, Float4 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+	friend Float4 greaterEqual(Float4 a, Float4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+	friend Float4 equal(Float4 a, Float4 b) { return {_mm_cmpeq_ps(a.v, b.v)}; }
+
+	friend Float4 select(Float4 mask, Float4 ifTrue, Float4 ifFalse)
+	{ return {_mm_or_ps(_mm_and_ps(mask.v, ifTrue.v), _mm_andnot_ps(mask.v, ifFalse.v))}; }
+
+	friend Float4 isFinite(Float4 a) { return {_mm_cmpeq_ps(_mm_sub_ps(a.v, a.v), _mm_setzero_ps())}; }
+
+	friend int bitmask(Float4 mask) { return _mm_movemask_ps(mask.v); }
+};
+#endif
+
+#ifdef SIMD_HAVE_AVX
+struct Float8
+{
+	typedef float Scalar;
+	enum { Width = 8 };
+	__m256 v;
+
+	static Float8 load(const float* p) { return {_mm256_loadu_ps(p)}; }
+	static Float8 broadcast(float f) { return {_mm256_set1_ps(f)}; }
+	static Float8 zero() { return {_mm256_setzero_ps()}; }
+	void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+	friend Float8 operator+(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+	friend Float8 operator-(Float8 a, Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+	friend Float8 operator*(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+	friend Float8 operator/(Float8 a, Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+	friend Float8 operator&(Float8 a, Float8 b) { return {_mm256_and_ps(a.v, b.v)}; }
+	friend Float8 operator|(Float8 a, Float8 b) { return {_mm256_or_ps(a.v, b.v)}; }
+	friend Float8 operator-(Float8 a) { return {_mm256_xor_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+
+	friend Float8 fma(Float8 a, Float8 b, Float8 c)
+	{
+#ifdef __FMA__
+		return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+#else
+		alignas(32) float la[8], lb[8], lc[8];
+		a.store(la); b.store(lb); c.store(lc);
+		alignas(32) float result[8];
+		for (int k = 0; k < 8; ++k)
+			result[k] = std::fma(la[k], lb[k], lc[k]);
+		return load(result);
+#endif
+	}
+
+	friend Float8 andNot(Float8 notThis, Float8 b) { return {_mm256_andnot_ps(notThis.v, b.v)}; }
+	friend Float8 abs(Float8 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+	friend Float8 min(Float8 a, Float8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+	friend Float8 max(Float8 a, Float8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+
+	friend Float8 lessThan(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+	friend Float8 lessEqual(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+	friend Float8 greaterThan(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+	friend Float8 greaterEqual(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+	friend Float8 equal(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+
+	friend Float8 select(Float8 mask, Float8 ifTrue, Float8 ifFalse)
+	{ return {_mm256_blendv_ps(ifFalse.v, ifTrue.v, mask.v)}; }
+
+	friend Float8 isFinite(Float8 a) { return {_mm256_cmp_ps(_mm256_sub_ps(a.v, a.v), _mm256_setzero_ps(), _CMP_EQ_OQ)}; }
+
+	friend int bitmask(Float8 mask) { return _mm256_movemask_ps(mask.v); }
+};
+#endif
+
+#ifdef SIMD_HAVE_AVX512
+// Masks are widened into lanes, like in Double8
+struct Float16
+{
+	typedef float Scalar;
+	enum { Width = 16 };
+	__m512 v;
+
+	static Float16 load(const float* p) { return {_mm512_loadu_ps(p)}; }
+	static Float16 broadcast(float f) { return {_mm512_set1_ps(f)}; }
+	static Float16 zero() { return {_mm512_setzero_ps()}; }
+	void store(float* p) const { _mm512_storeu_ps(p, v); }
+
+	friend Float16 operator+(Float16 a, Float16 b) { return {_mm512_add_ps(a.v, b.v)}; }
+	friend Float16 operator-(Float16 a, Float16 b) { return {_mm512_sub_ps(a.v, b.v)}; }
+	friend Float16 operator*(Float16 a, Float16 b) { return {_mm512_mul_ps(a.v, b.v)}; }
+	friend Float16 operator/(Float16 a, Float16 b) { return {_mm512_div_ps(a.v, b.v)}; }
+	friend Float16 operator&(Float16 a, Float16 b) { return fromBits(_mm512_and_si512(bits(a), bits(b))); }
+	friend Float16 operator|(Float16 a, Float16 b) { return fromBits(_mm512_or_si512(bits(a), bits(b))); }
+	friend Float16 operator-(Float16 a) { return fromBits(_mm512_xor_si512(bits(broadcast(-0.0f)), bits(a))); }
+
+	friend Float16 fma(Float16 a, Float16 b, Float16 c) { return {_mm512_fmadd_ps(a.v, b.v, c.v)}; }
+
+	friend Float16 andNot(Float16 notThis, Float16 b) { return fromBits(_mm512_andnot_si512(bits(notThis), bits(b))); }
+	friend Float16 abs(Float16 a) { return {_mm512_abs_ps(a.v)}; }
+	friend Float16 min(Float16 a, Float16 b) { return {_mm512_min_ps(a.v, b.v)}; }
+	friend Float16 max(Float16 a, Float16 b) { return {_mm512_max_ps(a.v, b.v)}; }
+
+	friend Float16 lessThan(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ)); }
+	friend Float16 lessEqual(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ)); }
+	friend Float16 greaterThan(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ)); }
+	friend Float16 greaterEqual(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ)); }
+	friend Float16 equal(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ)); }
+
+	friend Float16 select(Float16 mask, Float16 ifTrue, Float16 ifFalse)
+	{ return {_mm512_mask_blend_ps(toMask(mask), ifFalse.v, ifTrue.v)}; }
+
+	friend Float16 isFinite(Float16 a) { return equal(a - a, zero()); }
+
+	friend int bitmask(Float16 mask) { return toMask(mask); }
+
+private:
+	static __m512i bits(Float16 a) { return _mm512_castps_si512(a.v); }
+	static Float16 fromBits(__m512i i) { return {_mm512_castsi512_ps(i)}; }
+	static Float16 fromMask(__mmask16 m) { return fromBits(_mm512_maskz_set1_epi32(m, -1)); }
+	static __mmask16 toMask(Float16 mask) { return _mm512_test_epi32_mask(bits(mask), bits(mask)); }
+};
+#endif
+
+// The widest vector type available in this build
+#if defined(SIMD_HAVE_AVX512)
+typedef Double8 DoubleN;
+typedef Float16 FloatN;
+#elif defined(SIMD_HAVE_AVX)
+typedef Double4 DoubleN;
+typedef Float8 FloatN;
+#elif defined(SIMD_HAVE_SSE2)
+typedef Double2 DoubleN;
+typedef Float4 FloatN;
+#endif
+
+}
+
+#endif // SIMD_H
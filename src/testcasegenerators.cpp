@@ -0,0 +1,326 @@
+#include "testcasegenerators.h"
+#include "counterrng.h"
+#include "segmentcorpus.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+/*
+	Fills `out` with uniform doubles in [0, 1), 53 random bits each.
+	Every distribution uses its own range of streams, so the distributions are independent.
+*/
+template <int N>
+void unitReals(const CounterRng& rng, qint64 index, quint32 firstStream, qreal (&out)[N])
+{
+	static_assert(N % 2 == 0, "Each block of random bits makes 2 doubles");
+
+	const auto toUnit = [](quint32 high, quint32 low)
+	{
+		return std::ldexp(qreal(((quint64(high) << 32) | low) >> 11), -53);
+	};
+	for (int i = 0; i < N/2; ++i)
+	{
+		const auto bits = rng(quint64(index), firstStream + i);
+		out[2*i] = toUnit(bits[0], bits[1]);
+		out[2*i + 1] = toUnit(bits[2], bits[3]);
+	}
+}
+
+/*
+	Each coordinate is the ratio of 2 random integers in [0, 2^31 - 1], like std::rand()/std::rand()
+	with glibc. This includes Inf and NaN coordinates.
+*/
+SegmentPair randomRatioPair(const CounterRng& rng, qint64 index)
+{
+	qreal coords[8];
+	for (quint32 stream = 0; stream < 4; ++stream)
+	{
+		const auto bits = rng(quint64(index), stream);
+		coords[2*stream] = qreal(bits[0] >> 1) / (bits[1] >> 1);
+		coords[2*stream + 1] = qreal(bits[2] >> 1) / (bits[3] >> 1);
+	}
+
+	return SegmentPair
+	{
+		MyLineF(coords[0], coords[1], coords[2], coords[3]),
+		MyLineF(coords[4], coords[5], coords[6], coords[7])
+	};
+}
+
+SegmentPair uniformPair(const CounterRng& rng, qint64 index)
+{
+	qreal u[8];
+	unitReals(rng, index, 16, u);
+	for (qreal& coord : u)
+		coord = 2*coord - 1;
+
+	return SegmentPair{MyLineF(u[0], u[1], u[2], u[3]), MyLineF(u[4], u[5], u[6], u[7])};
+}
+
+/*
+	l2 is l1's direction rotated by a small angle, centred on a point of l1's line. The lines always
+	cross within l2, and within l1 about half of the time.
+*/
+SegmentPair nearParallelPair(const CounterRng& rng, qint64 index)
+{
+	qreal u[8];
+	unitReals(rng, index, 32, u);
+
+	const QPointF p1(2*u[0] - 1, 2*u[1] - 1);
+	const qreal phi = 2 * M_PI * u[2];
+	const qreal length1 = 0.1 + u[3];
+	const QPointF direction1(std::cos(phi), std::sin(phi));
+	const MyLineF l1(p1, p1 + length1*direction1);
+
+	// Rotate the direction instead of adding to phi, so that tiny angles aren't lost to rounding
+	const qreal theta = (u[4] < 0.5 ? -1 : 1) * std::pow(10.0, -2 - 14*u[5]);
+	const QPointF direction2( direction1.x()*std::cos(theta) - direction1.y()*std::sin(theta),
+			direction1.x()*std::sin(theta) + direction1.y()*std::cos(theta) );
+
+	const QPointF crossing = l1.pointAt(-0.5 + 2*u[6]);
+	const qreal halfLength2 = (0.1 + u[7]) / 2;
+	const MyLineF l2(crossing - halfLength2*direction2, crossing + halfLength2*direction2);
+
+	return SegmentPair{l1, l2};
+}
+
+/*
+	2 segments on the same horizontal, vertical or diagonal line. The coordinates are small
+	integers, so the segments are exactly collinear. About half of the pairs overlap or touch;
+	the rest are separated by a gap.
+*/
+SegmentPair collinearPair(const CounterRng& rng, qint64 index)
+{
+	static const QPointF directions[] = {{1, 0}, {0, 1}, {1, 1}, {2, -1}};
+
+	const auto bits = rng(quint64(index));
+	const QPointF origin(int(bits[0] & 0x3FF) - 512, int((bits[0] >> 10) & 0x3FF) - 512);
+	const QPointF direction = directions[bits[1] % 4];
+
+	// Positions along the line, with no zero-length segments
+	int t[4];
+	for (int i = 0; i < 4; ++i)
+		t[i] = int((bits[2 + i/2] >> (8 * (i%2))) & 0x1F);
+	if (t[1] == t[0])
+		++t[1];
+	if (t[3] == t[2])
+		++t[3];
+
+	return SegmentPair
+	{
+		MyLineF(origin + t[0]*direction, origin + t[1]*direction),
+		MyLineF(origin + t[2]*direction, origin + t[3]*direction)
+	};
+}
+
+// Like collinearPair(), but the first endpoint of l2 is always within l1
+SegmentPair collinearOverlappingPair(const CounterRng& rng, qint64 index)
+{
+	static const QPointF directions[] = {{1, 0}, {0, 1}, {1, 1}, {2, -1}};
+
+	const auto bits = rng(quint64(index), 48);
+	const QPointF origin(int(bits[0] & 0x3FF) - 512, int((bits[0] >> 10) & 0x3FF) - 512);
+	const QPointF direction = directions[bits[1] % 4];
+
+	int t[4];
+	t[0] = int(bits[2] & 0x1F);
+	t[1] = int((bits[2] >> 8) & 0x1F);
+	if (t[1] == t[0])
+		++t[1];
+	t[2] = qMin(t[0], t[1]) + int(bits[3] % quint32(qAbs(t[1] - t[0]) + 1));
+	t[3] = int((bits[3] >> 8) & 0x1F);
+	if (t[3] == t[2])
+		++t[3];
+
+	return SegmentPair
+	{
+		MyLineF(origin + t[0]*direction, origin + t[1]*direction),
+		MyLineF(origin + t[2]*direction, origin + t[3]*direction)
+	};
+}
+
+/*
+	Uniform pairs in a box of size 1 to 1000, moved 100 to 1e8 away from the origin. Like in
+	"07. QTBUG-75146 Trigger", the coordinates have far fewer significant bits left for the
+	geometry than their magnitude suggests.
+*/
+SegmentPair largeOffsetPair(const CounterRng& rng, qint64 index)
+{
+	qreal u[10];
+	unitReals(rng, index, 64, u);
+
+	const qreal size = std::pow(10.0, 3*u[8]);
+	const qreal distance = std::pow(10.0, 2 + 6*u[9]);
+	const auto bits = rng(quint64(index), 69);
+	const QPointF offset((bits[0] & 1) ? distance : -distance, (bits[0] & 2) ? distance : -distance);
+
+	QPointF points[4];
+	for (int i = 0; i < 4; ++i)
+		points[i] = offset + size*QPointF(2*u[2*i] - 1, 2*u[2*i + 1] - 1);
+
+	return SegmentPair{MyLineF(points[0], points[1]), MyLineF(points[2], points[3])};
+}
+
+/*
+	All 4 endpoints within epsilon/2^k (0 <= k <= 8) of a point in [-1, 1)^2. Many of the endpoints'
+	offsets round away entirely, giving zero-length or exactly collinear segments.
+*/
+SegmentPair subEpsilonPair(const CounterRng& rng, qint64 index)
+{
+	qreal u[10];
+	unitReals(rng, index, 80, u);
+
+	const QPointF centre(2*u[8] - 1, 2*u[9] - 1);
+	const auto bits = rng(quint64(index), 85);
+	const qreal scale = std::ldexp(std::numeric_limits<qreal>::epsilon(), -int(bits[0] % 9));
+
+	QPointF points[4];
+	for (int i = 0; i < 4; ++i)
+		points[i] = centre + scale*QPointF(2*u[2*i] - 1, 2*u[2*i + 1] - 1);
+
+	return SegmentPair{MyLineF(points[0], points[1]), MyLineF(points[2], points[3])};
+}
+
+class FixedSetGenerator : public TestCaseGenerator
+{
+public:
+	explicit FixedSetGenerator(const QVector<SegmentPair>& testSet) :
+		TestCaseGenerator(testSet.count()),
+		m_testSet(testSet)
+	{}
+
+	void generate(qint64 first, int n, SegmentPair* out) const override
+	{
+		for (int i = 0; i < n; ++i)
+			out[i] = m_testSet[int(first) + i];
+	}
+
+protected:
+	const SegmentPair* storage() const override { return m_testSet.constData(); }
+
+private:
+	QVector<SegmentPair> m_testSet;
+};
+
+class RandomGenerator : public TestCaseGenerator
+{
+public:
+	typedef SegmentPair (*PairFunc)(const CounterRng& rng, qint64 index);
+
+	RandomGenerator(PairFunc pairFunc, qint64 count, uint seed, bool swapSegments) :
+		TestCaseGenerator(count),
+		m_pairFunc(pairFunc),
+		m_rng(seed),
+		m_swapSegments(swapSegments)
+	{}
+
+	void generate(qint64 first, int n, SegmentPair* out) const override
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			out[i] = m_pairFunc(m_rng, first + i);
+			if (m_swapSegments)
+				std::swap(out[i].l1, out[i].l2);
+		}
+	}
+
+private:
+	PairFunc m_pairFunc;
+	CounterRng m_rng;
+	bool m_swapSegments;
+};
+
+class CorpusGenerator : public TestCaseGenerator
+{
+public:
+	explicit CorpusGenerator(std::unique_ptr<SegmentCorpus::Reader> corpus) :
+		TestCaseGenerator(corpus->count()),
+		m_corpus(std::move(corpus))
+	{}
+
+	void generate(qint64 first, int n, SegmentPair* out) const override
+	{
+		std::copy(m_corpus->pairs() + first, m_corpus->pairs() + first + n, out);
+	}
+
+	bool expectedResult(qint64 index, MyLineF::SegmentRelations* relations, QPointF* point) const override
+	{
+		if (m_corpus->expectedRelations())
+			*relations = MyLineF::SegmentRelations(QFlag(m_corpus->expectedRelations()[index]));
+		if (m_corpus->expectedPoints())
+			*point = m_corpus->expectedPoints()[index];
+		return m_corpus->expectedRelations() || m_corpus->expectedPoints();
+	}
+
+protected:
+	const SegmentPair* storage() const override { return m_corpus->pairs(); }
+
+private:
+	std::unique_ptr<SegmentCorpus::Reader> m_corpus;
+};
+
+}
+
+std::unique_ptr<TestCaseGenerator>
+TestCases::presetGenerator(bool parallel, bool swapSegments)
+{
+	QVector<SegmentPair> testSet;
+	for (auto key : presets.keys())
+	{
+		if (parallel ^ (key.contains("Parallel") || key.contains("Trigger")))
+			continue;
+
+		auto coords = presets[key];
+
+		MyLineF l1(coords.l1x1, coords.l1y1, coords.l1x2, coords.l1y2);
+		MyLineF l2(coords.l2x1, coords.l2y1, coords.l2x2, coords.l2y2);
+
+		if (swapSegments)
+			std::swap(l1, l2);
+
+		testSet << SegmentPair{l1, l2};
+	}
+	return std::unique_ptr<TestCaseGenerator>(new FixedSetGenerator(testSet));
+}
+
+std::unique_ptr<TestCaseGenerator>
+TestCases::randomGenerator(Distribution distribution, qint64 count, uint seed, bool swapSegments)
+{
+	RandomGenerator::PairFunc pairFunc = nullptr;
+	switch (distribution)
+	{
+	case RandomRatio: pairFunc = &randomRatioPair; break;
+	case Uniform: pairFunc = &uniformPair; break;
+	case NearParallel: pairFunc = &nearParallelPair; break;
+	case Collinear: pairFunc = &collinearPair; break;
+	case CollinearOverlapping: pairFunc = &collinearOverlappingPair; break;
+	case LargeOffset: pairFunc = &largeOffsetPair; break;
+	case SubEpsilon: pairFunc = &subEpsilonPair; break;
+	}
+	Q_ASSERT(pairFunc);
+	return std::unique_ptr<TestCaseGenerator>(new RandomGenerator(pairFunc, count, seed, swapSegments));
+}
+
+std::unique_ptr<TestCaseGenerator>
+TestCases::corpusGenerator(const QString& path, QString* errorString)
+{
+	std::unique_ptr<SegmentCorpus::Reader> corpus(new SegmentCorpus::Reader);
+	if (!corpus->open(path))
+	{
+		*errorString = corpus->errorString();
+		return nullptr;
+	}
+	return std::unique_ptr<TestCaseGenerator>(new CorpusGenerator(std::move(corpus)));
+}
+
+std::unique_ptr<TestCaseGenerator>
+TestCases::emptyGenerator()
+{
+	return std::unique_ptr<TestCaseGenerator>(new FixedSetGenerator(QVector<SegmentPair>()));
+}
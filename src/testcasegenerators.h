@@ -0,0 +1,83 @@
+#ifndef TESTCASEGENERATORS_H
+#define TESTCASEGENERATORS_H
+
+#include "tests.h"
+
+#include <memory>
+
+/*
+	A test set that is generated on demand, in chunks, instead of being stored as a whole.
+
+	Test case i is a pure function of i (and the seed), so any chunk can be generated by any thread,
+	in any order, and the set is the same no matter how it is divided up. Memory use depends on the
+	chunk size, not on count().
+*/
+class TestCaseGenerator
+{
+public:
+	virtual ~TestCaseGenerator() = default;
+
+	qint64 count() const { return m_count; }
+
+	// Writes test cases [first, first + n) to out[0, n).
+	// ASSUMPTION: 0 <= first && first + n <= count()
+	virtual void generate(qint64 first, int n, SegmentPair* out) const = 0;
+
+	// Test cases [first, first + n): Straight from the generator's own storage if it has any,
+	// otherwise generated into *buffer
+	const SegmentPair* chunk(qint64 first, int n, QVector<SegmentPair>* buffer) const
+	{
+		if (const SegmentPair* stored = storage())
+			return stored + first;
+
+		buffer->resize(n);
+		generate(first, n, buffer->data());
+		return buffer->constData();
+	}
+
+	// The results that were recorded along with test case `index`, if any. A relation or point
+	// that wasn't recorded is left untouched.
+	virtual bool expectedResult(qint64 index, MyLineF::SegmentRelations* relations, QPointF* point) const
+	{
+		Q_UNUSED(index) Q_UNUSED(relations) Q_UNUSED(point)
+		return false;
+	}
+
+protected:
+	explicit TestCaseGenerator(qint64 count) : m_count(count) {}
+
+	// All the test cases, if they are already in memory (or memory-mapped)
+	virtual const SegmentPair* storage() const { return nullptr; }
+
+private:
+	qint64 m_count;
+};
+
+namespace TestCases
+{
+
+enum Distribution
+{
+	RandomRatio,          // Each coordinate is rand()/rand(): Heavy-tailed, and includes Inf and NaN
+	Uniform,              // Each coordinate is uniform in [-1, 1)
+	NearParallel,         // Crossing segments, with log-uniform angles between 1e-16 and 1e-2 radians
+	Collinear,            // Small-integer segments on the same line, with or without a gap
+	CollinearOverlapping, // Like Collinear, but the segments always overlap
+	LargeOffset,          // Small segments far from the origin, like "07. QTBUG-75146 Trigger"
+	SubEpsilon            // Segments shorter than the rounding error of their coordinates
+};
+
+// The presets whose names do (or don't) mark them as parallel
+std::unique_ptr<TestCaseGenerator> presetGenerator(bool parallel, bool swapSegments);
+
+std::unique_ptr<TestCaseGenerator> randomGenerator(Distribution distribution, qint64 count, uint seed, bool swapSegments);
+
+// Replays a SegmentCorpus file, in place. Returns null (and sets *errorString) if it can't be opened.
+std::unique_ptr<TestCaseGenerator> corpusGenerator(const QString& path, QString* errorString);
+
+// No test cases
+std::unique_ptr<TestCaseGenerator> emptyGenerator();
+
+}
+
+#endif // TESTCASEGENERATORS_H
@@ -1,89 +1,439 @@
 #include "tests.h"
+#include "allpairs.h"
+#include "benchmarkresults.h"
+#include "benchmarkutils.h"
+#include "exactpredicates.h"
+#include "gridintersection.h"
+#include "incrementalintersections.h"
+#include "pathcounters.h"
+#include "perfcounters.h"
+#include "preparedline.h"
+#include "quantizedsegments.h"
+#include "referenceintersection.h"
+#include "segmentbatch.h"
+#include "segmentbvh.h"
+#include "testcasegenerators.h"
+#include "uniformgrid.h"
+#include "worstcasesearch.h"
 
 #include <QDebug>
 #include <QElapsedTimer>
 #include <QMetaEnum>
+#include <QRunnable>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
 
 typedef std::function<int(const MyLineF*, const MyLineF&, QPointF*)> IntersectionFunc;
 
+typedef void (*BatchIntersectionFunc)(SegmentSpan, SegmentSpan, int, MyLineF::SegmentRelations*, QPointF*);
+
+// Adapts a batch function to the IntersectionFunc signature by passing a batch of 1 pair
+template <BatchIntersectionFunc batchFunc>
+static int intersectOnePair(const MyLineF* l1, const MyLineF& l2, QPointF* intersectionPoint)
+{
+	const qreal c1[] = {l1->x1(), l1->y1(), l1->x2(), l1->y2()};
+	const qreal c2[] = {l2.x1(), l2.y1(), l2.x2(), l2.y2()};
+
+	MyLineF::SegmentRelations relations;
+	batchFunc({&c1[0], &c1[1], &c1[2], &c1[3]}, {&c2[0], &c2[1], &c2[2], &c2[3]}, 1, &relations, intersectionPoint);
+	return relations;
+}
+
+// Same as IntersectionFunc, but can be a template argument, so that calls to it can be resolved at compile time
+typedef int (*DirectIntersectionFunc)(const MyLineF*, const MyLineF&, QPointF*);
+
+// Adapts a member function to the DirectIntersectionFunc signature. The result is always SegmentRelations.
+template <typename Result, Result (MyLineF::*memberFunc)(const QLineF&, QPointF*) const>
+static int callMember(const MyLineF* l1, const MyLineF& l2, QPointF* intersectionPoint)
+{
+	return toSegmentRelations((l1->*memberFunc)(l2, intersectionPoint));
+}
+
+struct SpeedResult
+{
+	Bench::SampleStats nsPerCall;
+	Bench::SampleStats cyclesPerCall;
+	qreal eventsPerCall[PerfCounters::EventCount]; // Over all timed samples; only valid if PerfCounters were passed
+};
+
+/*
+	Times func() over the test set: 1 untimed warm-up sample, then nSamples timed samples of
+	nIterations/nSamples calls each. If `counters` is not null, it counts the timed samples.
+	If computePoint is false, func() gets nullptr instead of a point to write.
+
+	func() is a template argument instead of a std::function, so the calls have the same overhead as
+	in real code. The results are passed to Bench::doNotOptimize(), so the calls can't be
+	eliminated as dead code.
+*/
+template <DirectIntersectionFunc func, bool computePoint = true>
+static SpeedResult measureSpeed(const QVector<SegmentPair>& testSet, int nIterations, int nSamples, PerfCounters* counters)
+{
+	const int callsPerSample = qMax(1, nIterations / nSamples);
+	SpeedResult result;
+
+	QVector<qreal> nsPerCall;
+	QVector<qreal> cyclesPerCall;
+	QElapsedTimer timer;
+	int k = 0;
+	for (int sample = -1; sample < nSamples; ++sample)
+	{
+		if (sample == 0 && counters)
+			counters->start();
+
+		timer.start();
+		const quint64 startCycles = Bench::readCycleCounter();
+		for (int j = 0; j < callsPerSample; ++j)
+		{
+			QPointF p(Q_QNAN, Q_QNAN);
+			const int relations = func( &(testSet[k].l1), testSet[k].l2, computePoint ? &p : nullptr);
+			Bench::doNotOptimize(relations);
+			Bench::doNotOptimize(p);
+
+			if (++k == testSet.count())
+				k = 0;
+		}
+		const quint64 cycles = Bench::readCycleCounter() - startCycles;
+		const qreal duration = timer.nsecsElapsed();
+
+		// Sample -1 is the warm-up
+		if (sample >= 0)
+		{
+			nsPerCall << duration/callsPerSample;
+			cyclesPerCall << qreal(cycles)/callsPerSample;
+		}
+	}
+
+	if (counters)
+	{
+		counters->stop();
+		for (int i = 0; i < PerfCounters::EventCount; ++i)
+			result.eventsPerCall[i] = counters->value(static_cast<PerfCounters::Event>(i)) / (qreal(nSamples) * callsPerSample);
+	}
+	result.nsPerCall = Bench::summarize(nsPerCall);
+	result.cyclesPerCall = Bench::summarize(cyclesPerCall);
+	return result;
+}
+
+/*
+	Like measureSpeed(), but over `count` test cases that can be far larger than the caches, visited
+	in `order` (or sequentially, if it is null). nIterations is rounded up to 2 passes over the
+	test cases, so that every sample really streams them from wherever they reside.
+
+	NOTE: Visiting in `order` also reads the indices, i.e. another 4 bytes per call, sequentially
+*/
+template <DirectIntersectionFunc func>
+static Bench::SampleStats measureSweep(const SegmentPair* testSet, const int* order, int count, int nIterations, int nSamples)
+{
+	const int callsPerSample = qMax(1, int(qMax<qint64>(2 * qint64(count), nIterations) / nSamples));
+
+	QVector<qreal> nsPerCall;
+	QElapsedTimer timer;
+	int k = 0;
+	for (int sample = -1; sample < nSamples; ++sample)
+	{
+		timer.start();
+		for (int j = 0; j < callsPerSample; ++j)
+		{
+			const SegmentPair& testCase = testSet[order ? order[k] : k];
+			QPointF p(Q_QNAN, Q_QNAN);
+			const int relations = func(&testCase.l1, testCase.l2, &p);
+			Bench::doNotOptimize(relations);
+			Bench::doNotOptimize(p);
+
+			if (++k == count)
+				k = 0;
+		}
+		const qreal duration = timer.nsecsElapsed();
+
+		// Sample -1 is the warm-up
+		if (sample >= 0)
+			nsPerCall << duration/callsPerSample;
+	}
+	return Bench::summarize(nsPerCall);
+}
+
+/*
+	Like measureSpeed(), but for functions that process all `count` test cases in one call: 1 untimed
+	warm-up sample, then nSamples timed samples of enough passes for nIterations test cases in total
+	(but at least 1 pass per sample). The results are per test case.
+*/
+static Bench::SampleStats measurePasses(const std::function<void()>& pass, int count, int nIterations, int nSamples)
+{
+	const int passesPerSample = qMax(1, nIterations / (nSamples * count));
+
+	QVector<qreal> nsPerCall;
+	QElapsedTimer timer;
+	for (int sample = -1; sample < nSamples; ++sample)
+	{
+		timer.start();
+		for (int j = 0; j < passesPerSample; ++j)
+			pass();
+		const qreal duration = timer.nsecsElapsed();
+
+		// Sample -1 is the warm-up
+		if (sample >= 0)
+			nsPerCall << duration / (qreal(passesPerSample) * count);
+	}
+	return Bench::summarize(nsPerCall);
+}
+
 struct TestFunctionInfo
 {
 	QString name;
 	IntersectionFunc func;
+	DirectIntersectionFunc directFunc;
+	SpeedResult (*measureSpeed)(const QVector<SegmentPair>& testSet, int nIterations, int nSamples, PerfCounters* counters);
+	SpeedResult (*measureSpeedWithoutPoint)(const QVector<SegmentPair>& testSet, int nIterations, int nSamples, PerfCounters* counters);
+	Bench::SampleStats (*measureSweep)(const SegmentPair* testSet, const int* order, int count, int nIterations, int nSamples);
 };
 
+template <DirectIntersectionFunc func>
+static TestFunctionInfo makeTestFunction(const QString& name)
+{
+	return TestFunctionInfo{name, func, func, &measureSpeed<func>, &measureSpeed<func, false>, &measureSweep<func>};
+}
+
 const QVector<TestFunctionInfo> testFunctions
 {
-	{"intersects_crossHypot ", &MyLineF::intersects_crossHypot},
-	{"intersects_flsiOrig   ", &MyLineF::intersects_flsiOrig},
-	{"intersects_flsiTweaked", &MyLineF::intersects_flsiTweaked},
-	{"intersects_flsiV2     ", &MyLineF::intersects_flsiV2},
-	{"intersects_gaussElim  ", &MyLineF::intersects_gaussElim}
+	makeTestFunction<&callMember<QLineF::IntersectionType, &MyLineF::intersects_crossHypot>>("intersects_crossHypot "),
+	makeTestFunction<&callMember<QLineF::IntersectionType, &MyLineF::intersects_flsiOrig>>("intersects_flsiOrig   "),
+	makeTestFunction<&callMember<QLineF::IntersectionType, &MyLineF::intersects_flsiTweaked>>("intersects_flsiTweaked"),
+	makeTestFunction<&callMember<MyLineF::SegmentRelations, &MyLineF::intersects_flsiV2>>("intersects_flsiV2     "),
+	makeTestFunction<&callMember<MyLineF::SegmentRelations, &MyLineF::intersects_adaptive>>("intersects_adaptive   "),
+	makeTestFunction<&intersectOnePair<&Batch::intersects_gaussElim>>("Batch::gaussElim      "),
+	makeTestFunction<&callMember<MyLineF::SegmentRelations, &MyLineF::intersects_gaussElim>>("intersects_gaussElim  "),
+	makeTestFunction<&callMember<MyLineF::SegmentRelations, &MyLineF::intersects_hybrid>>("intersects_hybrid     ")
+};
+
+// Adapts a classify-only member function to the DirectIntersectionFunc signature. The point is never written.
+template <MyLineF::SegmentRelations (MyLineF::*memberFunc)(const QLineF&) const>
+static int callClassifier(const MyLineF* l1, const MyLineF& l2, QPointF* intersectionPoint)
+{
+	Q_UNUSED(intersectionPoint)
+	return (l1->*memberFunc)(l2);
+}
+
+struct ClassifyTestFunctionInfo
+{
+	TestFunctionInfo classifier;
+	QString fullName; // The function in testFunctions that it classifies like
+};
+
+const QVector<ClassifyTestFunctionInfo> classifyTestFunctions
+{
+	{makeTestFunction<&callClassifier<&MyLineF::classify_flsiV2>>("classify_flsiV2       "), "intersects_flsiV2"},
+	{makeTestFunction<&callClassifier<&MyLineF::classify_gaussElim>>("classify_gaussElim    "), "intersects_gaussElim"}
+};
+
+struct BatchTestFunctionInfo
+{
+	QString name;
+	IntersectionFunc scalarFunc;
+	BatchIntersectionFunc batchFunc;
+};
+
+const QVector<BatchTestFunctionInfo> batchTestFunctions
+{
+	{"intersects_flsiV2   ", &MyLineF::intersects_flsiV2, &Batch::intersects_flsiV2},
+	{"intersects_gaussElim", &MyLineF::intersects_gaussElim, &Batch::intersects_gaussElim}
+};
+
+// Ways to run the float32 version of Batch::intersects_flsiV2(), which the accuracy and batch
+// benchmarks compare with the double version
+struct Float32VariantInfo
+{
+	QString name;
+	PreconditionedPairs::Options options;
+	int clusterSize;
+};
+
+const QVector<Float32VariantInfo> float32Variants
+{
+	{"flsiV2 float32 (64)   ", PreconditionedPairs::Options(PreconditionedPairs::Translate) | PreconditionedPairs::Rescale, 64},
+	{"flsiV2 float32 (1)    ", PreconditionedPairs::Options(PreconditionedPairs::Translate) | PreconditionedPairs::Rescale, 1},
+	{"flsiV2 float32 (raw)  ", PreconditionedPairs::Options(), 1}
 };
 
-static QVector<SegmentPair>
-getTestSet_presets(bool parallel, bool swapSegments)
+// The relations that a function can get wrong. LinesIntersect follows from them.
+static const MyLineF::SegmentRelations classificationFlags = MyLineF::SegmentsIntersect | MyLineF::Parallel;
+
+// The number of test cases that a thread claims at a time
+static const int shardSize = 1 << 16;
+
+// The most test cases that the speed and batch benchmarks keep in memory (4 MiB)
+static const int maxWorkingSetSize = 1 << 16;
+
+// The working-set benchmarks start from this many bytes (which fits in any L1 cache), and by
+// default go up to 8 times the last-level cache, but no further than maxDefaultSweepSize
+static const qint64 minSweepSize = 16 * 1024;
+static const qint64 maxDefaultSweepSize = qint64(1) << 30;
+
+// Claims shards from a shared counter until there are none left
+class ShardWorker : public QRunnable
 {
-	const QStringList allKeys = presets.keys();
+public:
+	ShardWorker(QAtomicInt* nextShard, int nShards, const std::function<void(int)>& func) :
+		m_nextShard(nextShard),
+		m_nShards(nShards),
+		m_func(func)
+	{}
 
-	QVector<SegmentPair> testSet;
-	for (auto key : allKeys)
+	void run() override
 	{
-		if (parallel ^ (key.contains("Parallel") || key.contains("Trigger")))
-			continue;
+		for (int shard = m_nextShard->fetchAndAddRelaxed(1); shard < m_nShards; shard = m_nextShard->fetchAndAddRelaxed(1))
+			m_func(shard);
+	}
 
-//		qDebug() << key;
-		auto coords = presets[key];
+private:
+	QAtomicInt* m_nextShard;
+	const int m_nShards;
+	const std::function<void(int)>& m_func;
+};
 
-		MyLineF l1(coords.l1x1, coords.l1y1, coords.l1x2, coords.l1y2);
-		MyLineF l2(coords.l2x1, coords.l2y1, coords.l2x2, coords.l2y2);
+/*
+	Calls func(shard) for 0 <= shard < nShards, spread across up to nThreads threads. Idle threads
+	claim the next unprocessed shard, so a slow shard doesn't hold up the others.
 
-		if (swapSegments)
-			std::swap(l1, l2);
+	ASSUMPTION: func() can be called concurrently, and its results don't depend on which thread
+	            runs which shard
+*/
+static void
+forEachShard(int nShards, int nThreads, const std::function<void(int)>& func)
+{
+	QAtomicInt nextShard(0);
+	QThreadPool pool;
+	pool.setMaxThreadCount(nThreads);
+	for (int i = 0; i < qMin(nThreads, nShards); ++i)
+		pool.start(new ShardWorker(&nextShard, nShards, func));
+	pool.waitForDone();
+}
 
-		testSet << SegmentPair{l1, l2};
+std::unique_ptr<TestCaseGenerator>
+Benchmarker::getGenerator(Benchmarker::Category category) const
+{
+	switch (category)
+	{
+	case Benchmarker::PresetParallel: return TestCases::presetGenerator(true, false);
+	case Benchmarker::PresetParallelSwapped: return TestCases::presetGenerator(true, true);
+	case Benchmarker::PresetNonParallel: return TestCases::presetGenerator(false, false);
+	case Benchmarker::PresetNonParallelSwapped: return TestCases::presetGenerator(false, true);
+	case Benchmarker::MonteCarlo: return TestCases::randomGenerator(TestCases::RandomRatio, m_nMonteCarloCases, m_randomSeed, false);
+	case Benchmarker::MonteCarloSwapped: return TestCases::randomGenerator(TestCases::RandomRatio, m_nMonteCarloCases, m_randomSeed, true);
+	case Benchmarker::Collinear: return TestCases::randomGenerator(TestCases::Collinear, m_nMonteCarloCases, m_randomSeed, false);
+	case Benchmarker::Uniform: return TestCases::randomGenerator(TestCases::Uniform, m_nMonteCarloCases, m_randomSeed, false);
+	case Benchmarker::NearParallel: return TestCases::randomGenerator(TestCases::NearParallel, m_nMonteCarloCases, m_randomSeed, false);
+	case Benchmarker::CollinearOverlapping: return TestCases::randomGenerator(TestCases::CollinearOverlapping, m_nMonteCarloCases, m_randomSeed, false);
+	case Benchmarker::LargeOffset: return TestCases::randomGenerator(TestCases::LargeOffset, m_nMonteCarloCases, m_randomSeed, false);
+	case Benchmarker::SubEpsilon: return TestCases::randomGenerator(TestCases::SubEpsilon, m_nMonteCarloCases, m_randomSeed, false);
+	case Benchmarker::Corpus:
+		if (!m_corpusFile.isEmpty())
+		{
+			QString errorString;
+			if (auto generator = TestCases::corpusGenerator(m_corpusFile, &errorString))
+				return generator;
+			QTextStream(stdout) << QString("Can't replay the corpus (%1)\n").arg(errorString);
+		}
+		return TestCases::emptyGenerator();
 	}
-	return testSet;
+	Q_UNREACHABLE();
 }
 
-static QVector<SegmentPair>
-getTestSet_monteCarlo(int nTestCases, uint seed, bool swapSegments)
+/*
+	The first test cases of the category, up to maxWorkingSetSize of them. The speed benchmarks
+	cycle through these, so memory use (and the cache footprint) doesn't grow with the case count.
+
+	NOTE: This is a copy, even for a memory-mapped corpus, so the speed, classify, batch and other
+	      benchmarks that use it only see the first maxWorkingSetSize pairs of a corpus. Only the
+	      accuracy benchmarks cover the whole file.
+*/
+QVector<SegmentPair>
+Benchmarker::getTestSet(Benchmarker::Category category) const
 {
-	std::srand(seed);
-	QVector<SegmentPair> testSet;
+	const auto generator = getGenerator(category);
+	QVector<SegmentPair> testSet(int(qMin<qint64>(generator->count(), maxWorkingSetSize)));
 
-	auto randomFloat = []()->qreal
+	const int nShards = (testSet.count() + shardSize-1) / shardSize;
+	forEachShard(nShards, m_threadCount, [&](int shard)
 	{
-		return qreal(std::rand()) / std::rand();
-	};
+		const int begin = shard * shardSize;
+		generator->generate(begin, qMin(testSet.count(), begin + shardSize) - begin, testSet.data() + begin);
+	});
+	return testSet;
+}
 
-	for (int i = 0; i < nTestCases; ++i)
-	{
-		MyLineF l1(randomFloat(), randomFloat(), randomFloat(), randomFloat());
-		MyLineF l2(randomFloat(), randomFloat(), randomFloat(), randomFloat());
+QStringList
+Benchmarker::algorithmNames()
+{
+	QStringList names;
+	for (const auto& funcInfo : testFunctions)
+		names << funcInfo.name.trimmed();
+	return names;
+}
+
+bool
+Benchmarker::isSelected(Benchmarker::Category category) const
+{
+	return m_categories.isEmpty() || m_categories.contains(category);
+}
 
-		if (swapSegments)
-			std::swap(l1, l2);
+bool
+Benchmarker::isSelected(const QString& algorithm) const
+{
+	return m_algorithms.isEmpty() || m_algorithms.contains(algorithm.trimmed());
+}
 
-		testSet << SegmentPair{l1, l2};
+void
+Benchmarker::addResult(const QString& benchmark, Benchmarker::Category category, const QString& algorithm,
+		const QMap<QString, qreal>& metrics) const
+{
+	if (m_results)
+	{
+		m_results->add(BenchmarkRecord{benchmark, QMetaEnum::fromType<Benchmarker::Category>().valueToKey(category),
+				algorithm.trimmed(), metrics});
 	}
-	return testSet;
 }
 
-QVector<SegmentPair>
-Benchmarker::getTestSet(Benchmarker::Category category) const
+/*
+	The share of the calls since PathCounters::reset() that took each path, e.g.
+	"\t\tintersects_flsiV2: parallel 0.1%, ..." Only the paths that were taken are listed.
+*/
+static QString
+pathCounterString()
 {
-	switch (category)
+	QMap<QString, QStringList> functionPaths;
+	QMap<QString, quint64> functionTotals;
+	for (int i = 0; i < PathCounters::PathCount; ++i)
 	{
-	case Benchmarker::PresetParallel: return getTestSet_presets(true, false);
-	case Benchmarker::PresetParallelSwapped: return getTestSet_presets(true, true);
-	case Benchmarker::PresetNonParallel: return getTestSet_presets(false, false);
-	case Benchmarker::PresetNonParallelSwapped: return getTestSet_presets(false, true);
-	case Benchmarker::MonteCarlo: return getTestSet_monteCarlo(m_nMonteCarloCases, m_randomSeed, false);
-	case Benchmarker::MonteCarloSwapped: return getTestSet_monteCarlo(m_nMonteCarloCases, m_randomSeed, true);
+		const auto path = static_cast<PathCounters::Path>(i);
+		const QStringList parts = QString(PathCounters::name(path)).split(':');
+		functionTotals[parts[0]] += PathCounters::total(path);
 	}
-	Q_UNREACHABLE();
+
+	for (int i = 0; i < PathCounters::PathCount; ++i)
+	{
+		const auto path = static_cast<PathCounters::Path>(i);
+		const quint64 count = PathCounters::total(path);
+		if (count == 0)
+			continue;
+
+		const QStringList parts = QString(PathCounters::name(path)).split(':');
+		functionPaths[parts[0]] << QString("%1 %2%").arg(parts[1].trimmed()).arg(100.0 * count / functionTotals[parts[0]]);
+	}
+
+	QString result;
+	for (auto function : functionPaths.keys())
+		result += QString("\t\t%1: %2\n").arg(function, functionPaths[function].join(", "));
+	return result;
 }
 
 void Benchmarker::runSpeedBenchmarks() const
@@ -93,30 +443,290 @@ void Benchmarker::runSpeedBenchmarks() const
 			<< "Speed Benchmarks"  "\n"
 			<< "================"  "\n";
 
-	QElapsedTimer timer;
+	std::unique_ptr<PerfCounters> counters;
+	if (m_usePerfCounters)
+	{
+		counters.reset(new PerfCounters);
+		if (!counters->isAnyAvailable())
+		{
+			QTextStream(stdout) << QString("Hardware performance counters are not available (%1)\n\n").arg(counters->errorString());
+			counters.reset();
+		}
+	}
+
+	// Counters that couldn't be opened are shown as "n/a"
+	auto eventString = [&](const SpeedResult& result, PerfCounters::Event event) -> QString
+	{
+		return counters->isAvailable(event) ? QString::number(result.eventsPerCall[event]) : QString("n/a");
+	};
+
 	auto benchmarkEnum = QMetaEnum::fromType<Benchmarker::Category>();
 
 	for (int i = 0; i < benchmarkEnum.keyCount(); ++i)
 	{
 		// ASSUMPTION: Enum values start from 0 and increase by 1
 		const auto category = static_cast<Benchmarker::Category>(i);
+		if (!isSelected(category))
+			continue;
+
 		const auto testSet = getTestSet(category);
+		if (testSet.isEmpty())
+			continue; // No corpus
 
 		QTextStream(stdout) << benchmarkEnum.valueToKey(category) << '\n';
 
 		for (auto funcInfo : testFunctions)
 		{
-			timer.start();
-			for (int j = 0; j < m_iterationsPerFunction; ++j)
+			if (!isSelected(funcInfo.name))
+				continue;
+
+			PathCounters::reset();
+			const auto result = funcInfo.measureSpeed(testSet, m_iterationsPerFunction, m_nSamplesPerFunction, counters.get());
+
+			QString line = QString("\t%1:\t%2 ns per call (MAD %3, p99 %4)")
+					.arg(funcInfo.name)
+					.arg(result.nsPerCall.median)
+					.arg(result.nsPerCall.mad)
+					.arg(result.nsPerCall.p99);
+			if (Bench::haveCycleCounter())
+			{
+				line += QString(", %1 cycles per call (MAD %2, p99 %3)")
+						.arg(result.cyclesPerCall.median)
+						.arg(result.cyclesPerCall.mad)
+						.arg(result.cyclesPerCall.p99);
+			}
+			QTextStream(stdout) << line << '\n';
+
+			if (counters)
+			{
+				const bool haveIpc = counters->isAvailable(PerfCounters::Cycles) && counters->isAvailable(PerfCounters::Instructions);
+				QTextStream(stdout) << QString("\t\t%1 IPC, %2 instructions, %3 branch misses, %4 L1d misses per call\n")
+						.arg(haveIpc ? QString::number(result.eventsPerCall[PerfCounters::Instructions] / result.eventsPerCall[PerfCounters::Cycles]) : QString("n/a"))
+						.arg(eventString(result, PerfCounters::Instructions))
+						.arg(eventString(result, PerfCounters::BranchMisses))
+						.arg(eventString(result, PerfCounters::L1dMisses));
+			}
+
+			if (PathCounters::isEnabled())
+				QTextStream(stdout) << pathCounterString();
+
+			QMap<QString, qreal> metrics
+			{
+				{"ns_median", result.nsPerCall.median},
+				{"ns_mad", result.nsPerCall.mad},
+				{"ns_p99", result.nsPerCall.p99}
+			};
+			if (Bench::haveCycleCounter())
+			{
+				metrics["cycles_median"] = result.cyclesPerCall.median;
+				metrics["cycles_mad"] = result.cyclesPerCall.mad;
+				metrics["cycles_p99"] = result.cyclesPerCall.p99;
+			}
+			if (counters)
+			{
+				const char* const eventNames[PerfCounters::EventCount] = {"cycles", "instructions", "branch_misses", "l1d_misses"};
+				for (int e = 0; e < PerfCounters::EventCount; ++e)
+				{
+					if (counters->isAvailable(static_cast<PerfCounters::Event>(e)))
+						metrics[eventNames[e]] = result.eventsPerCall[e];
+				}
+			}
+			addResult("speed", category, funcInfo.name, metrics);
+		}
+
+		// How often intersects_adaptive() can't classify with its floating-point filter alone
+		int nSlowCases = 0;
+		for (const auto& testCase : testSet)
+		{
+			const quint64 nSlowPaths = Exact::slowPathCount();
+			testCase.l1.intersects_adaptive(testCase.l2);
+			if (Exact::slowPathCount() != nSlowPaths)
+				++nSlowCases;
+		}
+		QTextStream(stdout) << QString("\t(intersects_adaptive needed exact arithmetic for %1 of %2 test cases)\n")
+				.arg(nSlowCases).arg(testSet.count());
+		QTextStream(stdout) << '\n';
+	}
+}
+
+/*
+	Shows what the intersection point costs: Times every function with and without a point to
+	write (i.e. with nullptr), and the classify-only functions, which never calculate it.
+*/
+void Benchmarker::runClassifyBenchmarks() const
+{
+	QTextStream(stdout)
+			<< "========================="  "\n"
+			<< "Classification Benchmarks"  "\n"
+			<< "========================="  "\n";
+
+	auto benchmarkEnum = QMetaEnum::fromType<Benchmarker::Category>();
+	for (int i = 0; i < benchmarkEnum.keyCount(); ++i)
+	{
+		// ASSUMPTION: Enum values start from 0 and increase by 1
+		const auto category = static_cast<Benchmarker::Category>(i);
+		if (!isSelected(category))
+			continue;
+
+		const auto testSet = getTestSet(category);
+		if (testSet.isEmpty())
+			continue; // No corpus
+
+		QTextStream(stdout) << benchmarkEnum.valueToKey(category) << '\n';
+
+		for (auto funcInfo : testFunctions)
+		{
+			if (!isSelected(funcInfo.name))
+				continue;
+
+			const qreal withPoint = funcInfo.measureSpeed(testSet, m_iterationsPerFunction, m_nSamplesPerFunction, nullptr).nsPerCall.median;
+			const qreal withoutPoint = funcInfo.measureSpeedWithoutPoint(testSet, m_iterationsPerFunction, m_nSamplesPerFunction, nullptr).nsPerCall.median;
+			QTextStream(stdout) << QString("\t%1:\t%2 ns per call with the point, %3 ns without (the point costs %4%)\n")
+					.arg(funcInfo.name).arg(withPoint).arg(withoutPoint).arg(100 * (withPoint - withoutPoint) / withPoint);
+
+			addResult("classify", category, funcInfo.name,
+			{
+				{"ns_median", withoutPoint},
+				{"ns_median_with_point", withPoint}
+			});
+		}
+
+		// The reference relations, for the misclassification counts (calculated once, if needed)
+		QVector<MyLineF::SegmentRelations> refRelations;
+
+		for (auto classifyInfo : classifyTestFunctions)
+		{
+			if (!isSelected(classifyInfo.fullName))
+				continue;
+
+			if (refRelations.isEmpty())
+			{
+				refRelations.reserve(testSet.count());
+				for (const auto& testCase : testSet)
+				{
+					QPointF refPoint;
+					refRelations << Reference::intersects(testCase.l1, testCase.l2, &refPoint);
+				}
+			}
+
+			const auto& classifier = classifyInfo.classifier;
+			const auto fullFuncIt = std::find_if(testFunctions.cbegin(), testFunctions.cend(),
+					[&](const TestFunctionInfo& info) { return info.name.trimmed() == classifyInfo.fullName; });
+			Q_ASSERT(fullFuncIt != testFunctions.cend());
+
+			int nMismatches = 0;
+			int nMisclassified = 0;
+			for (int j = 0; j < testSet.count(); ++j)
 			{
-				int k = j % testSet.count();
-				QPointF p(Q_QNAN, Q_QNAN);
+				const SegmentPair& testCase = testSet[j];
+				QPointF p;
+				const int relations = classifier.directFunc(&testCase.l1, testCase.l2, nullptr);
+				nMismatches += (relations != fullFuncIt->directFunc(&testCase.l1, testCase.l2, &p));
 
-				funcInfo.func( &(testSet[k].l1), testSet[k].l2, &p);
-				// TODO: Ensure dead code elimination doesn't occur?
+				// Counted like the accuracy benchmarks count them
+				nMisclassified += refRelations[j] && (relations & classificationFlags) != (refRelations[j] & classificationFlags);
+			}
+
+			const qreal duration = classifier.measureSpeedWithoutPoint(testSet, m_iterationsPerFunction, m_nSamplesPerFunction, nullptr).nsPerCall.median;
+			QTextStream(stdout) << QString("\t%1:\t%2 ns per call, %3 of %4 relations differ from %5, %6 misclassified\n")
+					.arg(classifier.name).arg(duration).arg(nMismatches).arg(testSet.count()).arg(classifyInfo.fullName).arg(nMisclassified);
+
+			addResult("classify", category, classifier.name,
+			{
+				{"ns_median", duration},
+				{"mismatches", qreal(nMismatches)},
+				{"misclassified", qreal(nMisclassified)}
+			});
+		}
+		QTextStream(stdout) << '\n';
+	}
+}
+
+// The number of test cases in the largest working set (see setMaxSweepSize())
+int
+Benchmarker::maxSweepCount() const
+{
+	qint64 maxSize = m_maxSweepSize;
+	if (maxSize <= 0)
+	{
+		const qint64 cacheSize = Bench::lastLevelCacheSize();
+		maxSize = (cacheSize > 0) ? qMin(8 * cacheSize, maxDefaultSweepSize) : maxDefaultSweepSize;
+	}
+	return int(qMin<qint64>(maxSize / qint64(sizeof(SegmentPair)), std::numeric_limits<int>::max()));
+}
+
+/*
+	Shows how the speed depends on where the test cases reside: Times every function over working
+	sets from L1-resident to several times the last-level cache, visiting them sequentially and in
+	a random order. Unlike in the speed benchmarks, the test cases aren't reused from the cache.
+*/
+void Benchmarker::runWorkingSetBenchmarks() const
+{
+	QTextStream(stdout)
+			<< "======================"  "\n"
+			<< "Working-Set Benchmarks"  "\n"
+			<< "======================"  "\n";
+
+	const qint64 cacheSize = Bench::lastLevelCacheSize();
+	const int minCount = int(minSweepSize / sizeof(SegmentPair));
+	const int maxCount = maxSweepCount();
+	QTextStream(stdout) << QString("Last-level cache: %1 KiB. Working sets: %2 to %3 KiB, %4 bytes per test case.\n\n")
+			.arg(cacheSize > 0 ? QString::number(cacheSize / 1024) : QString("unknown"))
+			.arg(minSweepSize / 1024).arg(qint64(maxCount) * qint64(sizeof(SegmentPair)) / 1024).arg(sizeof(SegmentPair));
+
+	auto benchmarkEnum = QMetaEnum::fromType<Benchmarker::Category>();
+	for (int i = 0; i < benchmarkEnum.keyCount(); ++i)
+	{
+		// ASSUMPTION: Enum values start from 0 and increase by 1
+		const auto category = static_cast<Benchmarker::Category>(i);
+		if (!isSelected(category))
+			continue;
+
+		auto testSet = getTestSet(category);
+		const int nUnique = testSet.count();
+		if (nUnique == 0)
+			continue; // No corpus
+
+		// NOTE: The category's test cases are repeated to fill the largest working set, so the smaller
+		//       ones are just its first test cases. The data repeats, but the addresses don't.
+		testSet.resize(qMax(nUnique, maxCount));
+		for (int j = nUnique; j < testSet.count(); ++j)
+			testSet[j] = testSet[j - nUnique];
+
+		QTextStream(stdout) << benchmarkEnum.valueToKey(category) << '\n';
+
+		for (int count = minCount; count <= maxCount; count *= 2)
+		{
+			const qint64 size = qint64(count) * qint64(sizeof(SegmentPair));
+			QTextStream(stdout) << QString("\t%1 KiB (%2 test cases)\n").arg(size / 1024).arg(count);
+
+			QVector<int> order(count);
+			std::iota(order.begin(), order.end(), 0);
+			std::shuffle(order.begin(), order.end(), std::mt19937(m_randomSeed));
+
+			for (auto funcInfo : testFunctions)
+			{
+				if (!isSelected(funcInfo.name))
+					continue;
+
+				const auto sequential = funcInfo.measureSweep(testSet.constData(), nullptr, count, m_iterationsPerFunction, m_nSamplesPerFunction);
+				const auto random = funcInfo.measureSweep(testSet.constData(), order.constData(), count, m_iterationsPerFunction, m_nSamplesPerFunction);
+
+				// Bytes of test cases per ns, i.e. GB/s
+				const qreal sequentialRate = sizeof(SegmentPair) / sequential.median;
+				const qreal randomRate = sizeof(SegmentPair) / random.median;
+				QTextStream(stdout) << QString("\t\t%1:\t%2 ns per call sequential, %3 ns random (%4 and %5 GB/s)\n")
+						.arg(funcInfo.name).arg(sequential.median).arg(random.median).arg(sequentialRate).arg(randomRate);
+
+				addResult("workingset", category, QString("%1 @ %2 KiB").arg(funcInfo.name.trimmed()).arg(size / 1024),
+				{
+					{"ns_median", sequential.median},
+					{"ns_mad", sequential.mad},
+					{"ns_median_random", random.median},
+					{"ns_mad_random", random.mad},
+					{"bytes", qreal(size)}
+				});
 			}
-			qreal duration = timer.nsecsElapsed();
-			QTextStream(stdout) << QString("\t%1:\t%2 ns per call\n").arg(funcInfo.name).arg(duration/m_iterationsPerFunction);
 		}
 		QTextStream(stdout) << '\n';
 	}
@@ -138,10 +748,36 @@ struct AccuracyCheck
 				.arg(segments.l2.p2().y());
 	}
 
+	// The worst case
 	SegmentPair segments;
 	qreal diff;
+	qreal ulps;
+
+	// Test cases where the SegmentsIntersect or Parallel flag differs from the reference
+	qint64 nMisclassified;
 };
 
+/*
+	|p - reference| in units of the last place of reference's larger coordinate.
+
+	NOTE: The ulp is no smaller than the smallest normal double. Otherwise, it would be denormal
+	      near (0, 0), and any error above about 1e-15 would be infinitely many ulps. Errors above
+	      about 40 can still overflow, so the result is capped at the largest finite double.
+*/
+static qreal
+ulpsFrom(const QPointF& p, const QPointF& reference)
+{
+	const qreal magnitude = qMax(qAbs(reference.x()), qAbs(reference.y()));
+	const qreal ulp = qMax(std::nextafter(magnitude, std::numeric_limits<qreal>::infinity()) - magnitude,
+			std::numeric_limits<qreal>::min());
+	return qMin(qMax(qAbs(p.x() - reference.x()), qAbs(p.y() - reference.y())) / ulp, std::numeric_limits<qreal>::max());
+}
+
+/*
+	Every function is compared with Reference::intersects(), so no function's own errors are
+	mistaken for accuracy, and the order of testFunctions doesn't matter.
+	Test cases with non-finite coordinates are skipped, as they have no reference result.
+*/
 void Benchmarker::runAccuracyBenchmarks() const
 {
 	QTextStream(stdout)
@@ -154,42 +790,937 @@ void Benchmarker::runAccuracyBenchmarks() const
 	{
 		// ASSUMPTION: Enum values start from 0 and increase by 1
 		const auto category = static_cast<Benchmarker::Category>(i);
-		const auto testSet = getTestSet(category);
+		if (!isSelected(category))
+			continue;
+
+		// NOTE: Each shard generates its own chunk of test cases, so that the whole set never needs
+		//       to be in memory at once
+		const auto generator = getGenerator(category);
+		const int nTestCases = int(generator->count());
 
 		QTextStream(stdout)
 				<< benchmarkEnum.valueToKey(category)
-				<< QString(": %1 test cases\n").arg(testSet.count());
+				<< QString(": %1 test cases\n").arg(nTestCases);
+
+		// Each shard finds its own worst cases
+		const int nShards = (nTestCases + shardSize-1) / shardSize;
+		QVector<QMap<QString, AccuracyCheck>> shardCheckMaps(nShards);
+		forEachShard(nShards, m_threadCount, [&](int shard)
+		{
+			const int begin = shard * shardSize;
+			const int count = qMin(nTestCases, begin + shardSize) - begin;
+
+			// NOTE: For a memory-mapped corpus, this points straight into the file
+			QVector<SegmentPair> buffer;
+			const SegmentPair* shardCases = generator->chunk(begin, count, &buffer);
+
+			// NOTE: The batch kernels need structure-of-arrays, but the file is an array of SegmentPair,
+			//       so this is a copy of the shard (up to shardSize pairs, i.e. 4 MiB)
+			SegmentArrays lines1;
+			SegmentArrays lines2;
+			lines1.reserve(count);
+			lines2.reserve(count);
+			for (int j = 0; j < count; ++j)
+			{
+				lines1.append(shardCases[j].l1);
+				lines2.append(shardCases[j].l2);
+			}
+
+			// Calculate the reference results once for the whole shard
+			QVector<MyLineF::SegmentRelations> refRelations(count);
+			QVector<QPointF> refPoints(count, QPointF(Q_QNAN, Q_QNAN));
+			Reference::intersects(lines1.span(), lines2.span(), count, refRelations.data(), refPoints.data());
+
+			// result(j, &p) returns the relations for test case j, and sets p
+			QMap<QString, AccuracyCheck>& checkMap = shardCheckMaps[shard];
+			const auto checkResults = [&](const QString& name, const std::function<int(int, QPointF*)>& result)
+			{
+				AccuracyCheck check{};
+				for (int j = 0; j < count; ++j)
+				{
+					if (!refRelations[j])
+						continue; // Invalid input
+
+					QPointF p(Q_QNAN, Q_QNAN);
+					const int relations = result(j, &p);
+					if ((relations & classificationFlags) != (refRelations[j] & classificationFlags))
+						++check.nMisclassified;
+
+					const qreal diff = (refPoints[j]-p).manhattanLength();
+					if (diff > check.diff)
+					{
+						check.segments = shardCases[j];
+						check.diff = diff;
+						check.ulps = ulpsFrom(p, refPoints[j]);
+					}
+				}
+				checkMap[name] = check;
+			};
 
+			for (const auto& testFunction : testFunctions)
+			{
+				if (!isSelected(testFunction.name))
+					continue;
+
+				checkResults(testFunction.name, [&](int j, QPointF* p)
+				{
+					return testFunction.func( &(shardCases[j].l1), shardCases[j].l2, p);
+				});
+			}
+
+			// The float32 kernel, with and without preconditioning
+			if (isSelected("intersects_flsiV2"))
+			{
+				QVector<MyLineF::SegmentRelations> floatRelations(count);
+				QVector<QPointF> floatPoints(count);
+				for (const auto& variant : float32Variants)
+				{
+					const PreconditionedPairs pairs(lines1.span(), lines2.span(), count, variant.options, variant.clusterSize);
+					floatPoints.fill(QPointF(Q_QNAN, Q_QNAN));
+					Batch::intersects_flsiV2(pairs, floatRelations.data(), floatPoints.data());
+
+					checkResults(variant.name, [&](int j, QPointF* p)
+					{
+						*p = floatPoints[j];
+						return int(floatRelations[j]);
+					});
+				}
+			}
+
+			// Results that were recorded with the test cases (e.g. by the application that they were
+			// captured from) are checked like another function
+			MyLineF::SegmentRelations unused;
+			QPointF unusedPoint;
+			if (count > 0 && generator->expectedResult(begin, &unused, &unusedPoint))
+			{
+				checkResults("(recorded)            ", [&](int j, QPointF* p)
+				{
+					// Relations that weren't recorded can't be misclassified
+					MyLineF::SegmentRelations relations = refRelations[j];
+					generator->expectedResult(begin + j, &relations, p);
+					return int(relations);
+				});
+			}
+		});
+
+		// Merge in shard order, so that ties are resolved the same way for any number of threads
 		QMap<QString, AccuracyCheck> checkMap;
+		for (const auto& shardCheckMap : shardCheckMaps)
+		{
+			for (auto key : shardCheckMap.keys())
+			{
+				AccuracyCheck& check = checkMap[key];
+				const qint64 nMisclassified = check.nMisclassified + shardCheckMap[key].nMisclassified;
+				if (shardCheckMap[key].diff > check.diff)
+					check = shardCheckMap[key];
+				check.nMisclassified = nMisclassified;
+			}
+		}
 
-		for (int j = 0; j < testSet.count(); ++j)
+		for (auto key : checkMap.keys())
+		{
+			QTextStream(stdout)
+					<< QString("\t%1:\tMax diff is %2 (%3 ulps), %4 misclassified\n")
+							.arg(key).arg(checkMap[key].diff).arg(checkMap[key].ulps).arg(checkMap[key].nMisclassified)
+					<< "\t\t" << checkMap[key].printSegmentCoords() << "\n\n";
+
+			addResult("accuracy", category, key,
+			{
+				{"max_diff", checkMap[key].diff},
+				{"max_ulps", checkMap[key].ulps},
+				{"misclassified", qreal(checkMap[key].nMisclassified)},
+				{"test_cases", qreal(nTestCases)}
+			});
+		}
+	}
+}
+
+
+void Benchmarker::runBatchBenchmarks() const
+{
+	QTextStream(stdout)
+			<< "================"  "\n"
+			<< "Batch Benchmarks"  "\n"
+			<< "================"  "\n";
+
+	// Tile small test sets so that the batch kernel isn't dominated by its scalar remainder loop
+	const int minBatchSize = 4096;
+
+	QElapsedTimer timer;
+	auto benchmarkEnum = QMetaEnum::fromType<Benchmarker::Category>();
+
+	for (int i = 0; i < benchmarkEnum.keyCount(); ++i)
+	{
+		// ASSUMPTION: Enum values start from 0 and increase by 1
+		const auto category = static_cast<Benchmarker::Category>(i);
+		if (!isSelected(category))
+			continue;
+
+		const auto testSet = getTestSet(category);
+		if (testSet.isEmpty())
+			continue; // No corpus
+
+		SegmentArrays lines1, lines2;
+		for (int j = 0; j < qMax(testSet.count(), minBatchSize); ++j)
+		{
+			const auto& pair = testSet[j % testSet.count()];
+			lines1.append(pair.l1);
+			lines2.append(pair.l2);
+		}
+		const int batchSize = lines1.count();
+		const int nBatches = qMax(1, m_iterationsPerFunction / batchSize);
+		const qreal nPairs = qreal(nBatches) * batchSize;
+
+		QVector<MyLineF::SegmentRelations> scalarRelations(batchSize);
+		QVector<QPointF> scalarPoints(batchSize);
+		QVector<MyLineF::SegmentRelations> batchRelations(batchSize);
+		QVector<QPointF> batchPoints(batchSize);
+
+		QTextStream(stdout) << benchmarkEnum.valueToKey(category) << '\n';
+
+		for (auto funcInfo : batchTestFunctions)
 		{
-			QPointF pRef;
+			if (!isSelected(funcInfo.name))
+				continue;
+
+			scalarPoints.fill(QPointF(Q_QNAN, Q_QNAN));
+			batchPoints.fill(QPointF(Q_QNAN, Q_QNAN));
 
-			// ASSUMPTION: Gaussian elimination is the last function in the vector.
-			//             We're using it as the gold standard.
-			for (int k = testFunctions.count()-1; k >= 0; --k)
+			timer.start();
+			for (int j = 0; j < nBatches; ++j)
 			{
-				QPointF p(Q_QNAN, Q_QNAN);
-				testFunctions[k].func( &(testSet[j].l1), testSet[j].l2, &p);
+				for (int k = 0; k < batchSize; ++k)
+				{
+					const MyLineF l1 = lines1.at(k);
+					scalarRelations[k] = MyLineF::SegmentRelations(QFlag(funcInfo.scalarFunc(&l1, lines2.at(k), &scalarPoints[k])));
+				}
+			}
+			const qreal scalarDuration = timer.nsecsElapsed();
+			QTextStream(stdout) << QString("\t%1 (scalar):\t%2 pairs per second\n").arg(funcInfo.name).arg(1e9*nPairs/scalarDuration);
 
-				if (testFunctions[k].name.contains("gauss"))
-					pRef = p;
+			timer.start();
+			for (int j = 0; j < nBatches; ++j)
+				funcInfo.batchFunc(lines1.span(), lines2.span(), batchSize, batchRelations.data(), batchPoints.data());
+			const qreal batchDuration = timer.nsecsElapsed();
+			QTextStream(stdout) << QString("\t%1 (batch) :\t%2 pairs per second\n").arg(funcInfo.name).arg(1e9*nPairs/batchDuration);
 
-				qreal diff = (pRef-p).manhattanLength();
-				if (diff > checkMap[testFunctions[k].name].diff)
-					checkMap[testFunctions[k].name] = AccuracyCheck{testSet[j], diff};
+			// The results must be bit-identical, so compare the bits instead of using a tolerance
+			int nMismatches = 0;
+			for (int k = 0; k < batchSize; ++k)
+			{
+				if (scalarRelations[k] != batchRelations[k] || !isSamePoint(scalarPoints[k], batchPoints[k]))
+					++nMismatches;
 			}
+			QTextStream(stdout) << QString("\t\t%1 of %2 batch results differ from the scalar results\n").arg(nMismatches).arg(batchSize);
+
+			addResult("batch", category, funcInfo.name,
+			{
+				{"scalar_pairs_per_second", 1e9*nPairs/scalarDuration},
+				{"batch_pairs_per_second", 1e9*nPairs/batchDuration},
+				{"mismatches", qreal(nMismatches)}
+			});
 		}
-		for (auto key : checkMap.keys())
+
+		// NOTE: Not bit-identical, so see the accuracy benchmarks for how far these differ
+		if (isSelected("intersects_flsiV2"))
+		{
+			for (const auto& variant : float32Variants)
+			{
+				timer.start();
+				const PreconditionedPairs pairs(lines1.span(), lines2.span(), batchSize, variant.options, variant.clusterSize);
+				const qreal preconditionDuration = timer.nsecsElapsed();
+
+				timer.start();
+				for (int j = 0; j < nBatches; ++j)
+					Batch::intersects_flsiV2(pairs, batchRelations.data(), batchPoints.data());
+				const qreal batchDuration = timer.nsecsElapsed();
+
+				// Preconditioning is done once per batch, so it is amortized over the calls of only 1 batch
+				const qreal preconditionedRate = 1e9 * batchSize / (preconditionDuration + batchDuration / nBatches);
+				QTextStream(stdout) << QString("\t%1:\t%2 pairs per second, %3 including the preconditioning\n")
+						.arg(variant.name).arg(1e9*nPairs/batchDuration).arg(preconditionedRate);
+
+				addResult("batch", category, variant.name,
+				{
+					{"batch_pairs_per_second", 1e9*nPairs/batchDuration},
+					{"preconditioned_pairs_per_second", preconditionedRate}
+				});
+			}
+		}
+		QTextStream(stdout) << '\n';
+	}
+}
+
+/*
+	Compares QuantizedSegments with the plain storage, on as many test cases as the largest working
+	set of the working-set benchmarks, so that memory bandwidth matters: Bytes per pair, pairs per
+	second, and how many relations quantization changed (or might have).
+*/
+void Benchmarker::runQuantizedBenchmarks() const
+{
+	QTextStream(stdout)
+			<< "===================="  "\n"
+			<< "Quantized Benchmarks"  "\n"
+			<< "===================="  "\n";
+
+	auto benchmarkEnum = QMetaEnum::fromType<Benchmarker::Category>();
+	for (int i = 0; i < benchmarkEnum.keyCount(); ++i)
+	{
+		// ASSUMPTION: Enum values start from 0 and increase by 1
+		const auto category = static_cast<Benchmarker::Category>(i);
+		if (!isSelected(category))
+			continue;
+
+		auto testSet = getTestSet(category);
+		const int nUnique = testSet.count();
+		if (nUnique == 0)
+			continue; // No corpus
+
+		// NOTE: Repeated like in the working-set benchmarks
+		const int count = qMax(nUnique, maxSweepCount());
+		testSet.resize(count);
+		for (int j = nUnique; j < count; ++j)
+			testSet[j] = testSet[j - nUnique];
+
+		SegmentArrays lines1, lines2;
+		lines1.reserve(count);
+		lines2.reserve(count);
+		for (const auto& pair : testSet)
+		{
+			lines1.append(pair.l1);
+			lines2.append(pair.l2);
+		}
+		const QuantizedSegments<qint32> lines1x32(lines1.span(), count), lines2x32(lines2.span(), count);
+		const QuantizedSegments<qint16> lines1x16(lines1.span(), count), lines2x16(lines2.span(), count);
+
+		// The relations of the original segments
+		QVector<MyLineF::SegmentRelations> expected(count);
+		QVector<MyLineF::SegmentRelations> relations(count);
+		QVector<bool> uncertain(count);
+
+		QTextStream(stdout) << benchmarkEnum.valueToKey(category) << QString(": %1 test cases\n").arg(count);
+
+		const auto printResult = [&](const QString& name, qint64 bytes, const Bench::SampleStats& nsPerPair)
+		{
+			QTextStream(stdout) << QString("\t%1:\t%2 bytes per pair, %3 ns per pair (MAD %4, p99 %5), %6 pairs per second\n")
+					.arg(name).arg(qreal(bytes) / count).arg(nsPerPair.median).arg(nsPerPair.mad).arg(nsPerPair.p99).arg(1e9 / nsPerPair.median);
+		};
+
+		const Bench::SampleStats plainStats = measurePasses([&]
+		{
+			for (int j = 0; j < count; ++j)
+				expected[j] = testSet[j].l1.intersects_flsiV2(testSet[j].l2);
+		}, count, m_iterationsPerFunction, m_nSamplesPerFunction);
+		printResult("QVector<SegmentPair> (scalar)", qint64(count) * sizeof(SegmentPair), plainStats);
+		addResult("quantized", category, "QVector<SegmentPair>", {{"ns_median", plainStats.median}, {"pairs_per_second", 1e9 / plainStats.median}});
+
+		const Bench::SampleStats arraysStats = measurePasses([&]
+		{
+			Batch::intersects_flsiV2(lines1.span(), lines2.span(), count, relations.data());
+		}, count, m_iterationsPerFunction, m_nSamplesPerFunction);
+		printResult("SegmentArrays (batch)        ", 2 * 4 * qint64(count) * sizeof(qreal), arraysStats);
+		addResult("quantized", category, "SegmentArrays", {{"ns_median", arraysStats.median}, {"pairs_per_second", 1e9 / arraysStats.median}});
+
+		// NOTE: Timed without the uncertainty flags, like the other 2, which don't have any
+		const auto checkQuantized = [&](const QString& name, qint64 bytes, const std::function<void(bool*)>& intersect)
+		{
+			const Bench::SampleStats stats = measurePasses([&] { intersect(nullptr); }, count, m_iterationsPerFunction, m_nSamplesPerFunction);
+			printResult(name, bytes, stats);
+			intersect(uncertain.data());
+
+			// Uncertain relations may differ from the expected ones, but the certain ones never should
+			int nUncertain = 0;
+			int nChanged = 0;
+			int nWronglyCertain = 0;
+			for (int j = 0; j < count; ++j)
+			{
+				nUncertain += uncertain[j];
+				nChanged += (relations[j] != expected[j]);
+				nWronglyCertain += (!uncertain[j] && relations[j] != expected[j]);
+			}
+			QTextStream(stdout) << QString("\t\t%1 relations changed by quantization, %2 flagged as uncertain, %3 changed without being flagged\n")
+					.arg(nChanged).arg(nUncertain).arg(nWronglyCertain);
+
+			addResult("quantized", category, name.trimmed(),
+			{
+				{"ns_median", stats.median},
+				{"pairs_per_second", 1e9 / stats.median},
+				{"bytes_per_pair", qreal(bytes) / count},
+				{"changed", qreal(nChanged)},
+				{"uncertain", qreal(nUncertain)},
+				{"mismatches", qreal(nWronglyCertain)}
+			});
+		};
+
+		checkQuantized("QuantizedSegments<qint32>    ", lines1x32.byteCount() + lines2x32.byteCount(), [&](bool* flags)
+		{
+			Batch::intersects_flsiV2(lines1x32, lines2x32, relations.data(), nullptr, flags);
+		});
+		checkQuantized("QuantizedSegments<qint16>    ", lines1x16.byteCount() + lines2x16.byteCount(), [&](bool* flags)
+		{
+			Batch::intersects_flsiV2(lines1x16, lines2x16, relations.data(), nullptr, flags);
+		});
+		QTextStream(stdout) << '\n';
+	}
+}
+
+/*
+	Segments with random positions and directions in the unit square. Their lengths are scaled
+	with 1/sqrt(nSegments), so that the number of intersecting pairs grows linearly.
+*/
+static QVector<MyLineF>
+getRandomSegments(int nSegments, uint seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<qreal> position(0, 1);
+	std::uniform_real_distribution<qreal> angle(0, 2*M_PI);
+	std::uniform_real_distribution<qreal> length(0, 2/std::sqrt(qreal(nSegments)));
+
+	QVector<MyLineF> segments;
+	segments.reserve(nSegments);
+	for (int i = 0; i < nSegments; ++i)
+	{
+		const QPointF p1(position(rng), position(rng));
+		const qreal a = angle(rng);
+		const qreal l = length(rng);
+		segments << MyLineF(p1, p1 + l*QPointF(std::cos(a), std::sin(a)));
+	}
+	return segments;
+}
+
+/*
+	Like getRandomSegments(), but the start points are normally distributed around a few random
+	cluster centres. The lengths are scaled so that clusters are dense.
+*/
+static QVector<MyLineF>
+getClusteredSegments(int nSegments, uint seed)
+{
+	const int nClusters = 16;
+	const qreal spread = 0.02;
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<qreal> position(0, 1);
+	std::normal_distribution<qreal> offset(0, spread);
+	std::uniform_real_distribution<qreal> angle(0, 2*M_PI);
+	std::uniform_real_distribution<qreal> length(0, 2*spread*std::sqrt(qreal(nClusters)/nSegments));
+
+	QVector<QPointF> centres;
+	for (int i = 0; i < nClusters; ++i)
+		centres << QPointF(position(rng), position(rng));
+
+	QVector<MyLineF> segments;
+	segments.reserve(nSegments);
+	for (int i = 0; i < nSegments; ++i)
+	{
+		const QPointF p1 = centres[i % nClusters] + QPointF(offset(rng), offset(rng));
+		const qreal a = angle(rng);
+		const qreal l = length(rng);
+		segments << MyLineF(p1, p1 + l*QPointF(std::cos(a), std::sin(a)));
+	}
+	return segments;
+}
+
+void Benchmarker::runAllPairsBenchmarks() const
+{
+	QTextStream(stdout)
+			<< "===================="  "\n"
+			<< "All-Pairs Benchmarks"  "\n"
+			<< "===================="  "\n";
+
+	// Brute force is O(N^2), so stop it early
+	const int maxBruteForceCount = 16000;
+
+	struct Distribution
+	{
+		QString name;
+		QVector<MyLineF> (*generator)(int, uint);
+	};
+	const QVector<Distribution> distributions
+	{
+		{"Random", &getRandomSegments},
+		{"Clustered", &getClusteredSegments}
+	};
+
+	auto toPairSet = [](const QVector<SegmentIntersection>& results)
+	{
+		std::set<std::pair<int, int>> pairs;
+		for (const auto& result : results)
+			pairs.insert({result.index1, result.index2});
+		return pairs;
+	};
+
+	QElapsedTimer timer;
+	for (const auto& distribution : distributions)
+	{
+		for (int n = 1000; n <= m_maxAllPairsSegmentCount; n *= 2)
 		{
-			if (key.contains("gauss"))
+			const auto segments = distribution.generator(n, m_randomSeed);
+
+			timer.start();
+			const auto sweepResults = AllPairs::sweepLine(segments);
+			const qreal sweepDuration = timer.nsecsElapsed();
+
+			timer.start();
+			const UniformGrid grid(segments);
+			qint64 nCandidates = 0;
+			const auto gridResults = grid.findAllIntersections(&MyLineF::intersects_flsiV2, &nCandidates);
+			const qreal gridDuration = timer.nsecsElapsed();
+
+			QTextStream(stdout) << QString("%1: %2 segments, %3 intersecting pairs\n")
+					.arg(distribution.name).arg(n).arg(sweepResults.count());
+			QTextStream(stdout) << QString("\t%1:\t%2 ms\n").arg("sweepLine  ").arg(sweepDuration/1e6);
+			QTextStream(stdout) << QString("\t%1:\t%2 ms (%3x%4 cells, %5 candidate pairs, %6 candidates per second, %7% hit rate)\n")
+					.arg("uniformGrid").arg(gridDuration/1e6)
+					.arg(grid.columnCount()).arg(grid.rowCount())
+					.arg(nCandidates).arg(1e9*nCandidates/gridDuration)
+					.arg(nCandidates ? 100.0*gridResults.count()/nCandidates : 0);
+
+			// Moves one endpoint at a time, as when dragging them around in the GUI
+			const int nMoves = 1000;
+			std::mt19937 rng(m_randomSeed);
+			std::uniform_int_distribution<int> pick(0, n-1);
+			std::normal_distribution<qreal> nudge(0, 1/std::sqrt(qreal(n))); // About as long as a segment
+			QVector<MyLineF> movedSegments = segments;
+			QVector<int> moves;
+			QVector<MyLineF> newSegments;
+			for (int i = 0; i < nMoves; ++i)
+			{
+				const int index = pick(rng);
+				movedSegments[index].setP2(movedSegments[index].p2() + QPointF(nudge(rng), nudge(rng)));
+				moves << index;
+				newSegments << movedSegments[index];
+			}
+
+			timer.start();
+			IncrementalIntersections incremental(segments);
+			const qreal incrementalBuildDuration = timer.nsecsElapsed();
+
+			qint64 nMoveCandidates = 0;
+			timer.start();
+			for (int i = 0; i < nMoves; ++i)
+				nMoveCandidates += incremental.setSegment(moves[i], newSegments[i]);
+			const qreal moveDuration = timer.nsecsElapsed();
+
+			QTextStream(stdout) << QString("\t%1:\t%2 ms, then %3 us per moved segment (%4 candidate pairs per move)\n")
+					.arg("incremental").arg(incrementalBuildDuration/1e6).arg(moveDuration/nMoves/1e3)
+					.arg(qreal(nMoveCandidates)/nMoves);
+
+			// NOTE: uniformGrid() is the reference here, because bruteForce() would take too long for large N
+			const auto movedPairs = toPairSet(UniformGrid(movedSegments).findAllIntersections());
+			const auto incrementalPairs = toPairSet(incremental.intersections());
+			std::vector<std::pair<int, int>> differentPairs;
+			std::set_symmetric_difference(movedPairs.begin(), movedPairs.end(), incrementalPairs.begin(), incrementalPairs.end(),
+					std::back_inserter(differentPairs));
+			QTextStream(stdout) << QString("\t\t%1 of %2 pairs differ from uniformGrid after the moves\n")
+					.arg(int(differentPairs.size())).arg(int(movedPairs.size()));
+
+			// All engines use the same pairwise test, so they must find the same pairs
+			if (n <= maxBruteForceCount)
+			{
+				timer.start();
+				const auto bruteForceResults = AllPairs::bruteForce(segments);
+				const qreal bruteForceDuration = timer.nsecsElapsed();
+				QTextStream(stdout) << QString("\t%1:\t%2 ms\n").arg("bruteForce ").arg(bruteForceDuration/1e6);
+
+				const auto sweepPairs = toPairSet(sweepResults);
+				const auto gridPairs = toPairSet(gridResults);
+				int nSweepMissed = 0;
+				int nGridMissed = 0;
+				for (const auto& result : bruteForceResults)
+				{
+					nSweepMissed += !sweepPairs.count({result.index1, result.index2});
+					nGridMissed += !gridPairs.count({result.index1, result.index2});
+				}
+				QTextStream(stdout) << QString("\t\t%1 of %2 pairs were missed by sweepLine, %3 by uniformGrid\n")
+						.arg(nSweepMissed).arg(bruteForceResults.count()).arg(nGridMissed);
+			}
+			QTextStream(stdout) << '\n';
+		}
+	}
+}
+
+void Benchmarker::runOneVsManyBenchmarks() const
+{
+	QTextStream(stdout)
+			<< "======================"  "\n"
+			<< "One-vs-Many Benchmarks"  "\n"
+			<< "======================"  "\n";
+
+	// Long "cursor rays" that cross a large part of the scene
+	const int nQueries = 1000;
+	QVector<QLineF> queries;
+	std::mt19937 rng(m_randomSeed);
+	std::uniform_real_distribution<qreal> position(0, 1);
+	for (int i = 0; i < nQueries; ++i)
+		queries << QLineF(position(rng), position(rng), position(rng), position(rng));
+
+	auto isSameHit = [](const SegmentHit& a, const SegmentHit& b)
+	{
+		return a.index == b.index && a.relations == b.relations;
+	};
+
+	QElapsedTimer timer;
+	for (int n = 1000; n <= m_maxAllPairsSegmentCount; n *= 2)
+	{
+		const auto segments = getRandomSegments(n, m_randomSeed);
+
+		timer.start();
+		const SegmentBvh bvh(segments);
+		const qreal buildDuration = timer.nsecsElapsed();
+
+		QVector<QVector<SegmentHit>> allHits(nQueries);
+		timer.start();
+		for (int i = 0; i < nQueries; ++i)
+			allHits[i] = bvh.findIntersecting(queries[i]);
+		const qreal allHitsDuration = timer.nsecsElapsed();
+
+		// NOTE: An index of -1 means that nothing was hit
+		QVector<SegmentHit> firstHits(nQueries, SegmentHit{-1, MyLineF::SegmentRelations(), QPointF()});
+		timer.start();
+		for (int i = 0; i < nQueries; ++i)
+			bvh.findFirstHit(queries[i], &firstHits[i]);
+		const qreal firstHitDuration = timer.nsecsElapsed();
+
+		// The linear scans are the reference
+		int nMismatches = 0;
+		qint64 nHits = 0;
+		timer.start();
+		for (int i = 0; i < nQueries; ++i)
+		{
+			const auto hits = SegmentBvh::findIntersecting_linear(segments, queries[i]);
+			nHits += hits.count();
+			nMismatches += !std::equal(hits.begin(), hits.end(), allHits[i].begin(), allHits[i].end(), isSameHit);
+		}
+		const qreal allHitsLinearDuration = timer.nsecsElapsed();
+
+		timer.start();
+		for (int i = 0; i < nQueries; ++i)
+		{
+			SegmentHit hit{-1, MyLineF::SegmentRelations(), QPointF()};
+			SegmentBvh::findFirstHit_linear(segments, queries[i], &hit);
+			nMismatches += !isSameHit(hit, firstHits[i]);
+		}
+		const qreal firstHitLinearDuration = timer.nsecsElapsed();
+
+		// Every query against every segment, with the per-segment invariants calculated for every
+		// pair, once per query, or once per query and once per segment
+		QPointF point;
+		qint64 nPairHits = 0;
+		timer.start();
+		for (int i = 0; i < nQueries; ++i)
+		{
+			const MyLineF myQuery(queries[i].p1(), queries[i].p2());
+			for (const auto& segment : segments)
+				nPairHits += myQuery.intersects_flsiV2(segment, &point).testFlag(MyLineF::SegmentsIntersect);
+		}
+		const qreal unpreparedDuration = timer.nsecsElapsed();
+
+		timer.start();
+		for (int i = 0; i < nQueries; ++i)
+		{
+			const PreparedLine preparedQuery(queries[i]);
+			for (const auto& segment : segments)
+				nPairHits += preparedQuery.intersects_flsiV2(segment, &point).testFlag(MyLineF::SegmentsIntersect);
+		}
+		const qreal preparedQueryDuration = timer.nsecsElapsed();
+
+		timer.start();
+		QVector<PreparedLine> preparedSegments;
+		preparedSegments.reserve(n);
+		for (const auto& segment : segments)
+			preparedSegments << PreparedLine(segment);
+		const qreal prepareDuration = timer.nsecsElapsed();
+
+		timer.start();
+		for (int i = 0; i < nQueries; ++i)
+		{
+			const PreparedLine preparedQuery(queries[i]);
+			for (const auto& segment : preparedSegments)
+				nPairHits += preparedQuery.intersects_flsiV2(segment, &point).testFlag(MyLineF::SegmentsIntersect);
+		}
+		const qreal preparedBothDuration = timer.nsecsElapsed();
+
+		// The prepared results must be bit-identical to intersects_flsiV2()
+		int nPreparedMismatches = 0;
+		for (int i = 0; i < nQueries; ++i)
+		{
+			const MyLineF myQuery(queries[i].p1(), queries[i].p2());
+			const PreparedLine preparedQuery(queries[i]);
+			for (int j = 0; j < n; ++j)
+			{
+				QPointF expectedPoint(Q_QNAN, Q_QNAN), point1(Q_QNAN, Q_QNAN), point2(Q_QNAN, Q_QNAN);
+				const auto expected = myQuery.intersects_flsiV2(segments[j], &expectedPoint);
+				const auto relations1 = preparedQuery.intersects_flsiV2(segments[j], &point1);
+				const auto relations2 = preparedQuery.intersects_flsiV2(preparedSegments[j], &point2);
+				nPreparedMismatches += (relations1 != expected || !isSamePoint(point1, expectedPoint));
+				nPreparedMismatches += (relations2 != expected || !isSamePoint(point2, expectedPoint));
+			}
+		}
+		const qint64 nPairs = qint64(nQueries) * n;
+
+		QTextStream(stdout) << QString("%1 segments: Built in %2 ms, %3 bytes per segment (%4 nodes, depth %5)\n")
+				.arg(n).arg(buildDuration/1e6).arg(qreal(bvh.memoryUsage())/n).arg(bvh.nodeCount()).arg(bvh.depth());
+		QTextStream(stdout) << QString("\t%1:\t%2 us per query (linear scan: %3 us), %4 hits per query\n")
+				.arg("findIntersecting").arg(allHitsDuration/nQueries/1e3).arg(allHitsLinearDuration/nQueries/1e3)
+				.arg(qreal(nHits)/nQueries);
+		QTextStream(stdout) << QString("\t%1:\t%2 us per query (linear scan: %3 us)\n")
+				.arg("findFirstHit    ").arg(firstHitDuration/nQueries/1e3).arg(firstHitLinearDuration/nQueries/1e3);
+		QTextStream(stdout) << QString("\t\t%1 of %2 queries differ from the linear scan\n")
+				.arg(nMismatches).arg(2*nQueries);
+		QTextStream(stdout) << QString("\t%1:\t%2 ns per pair (prepared query: %3 ns, prepared query and segments: %4 ns + %5 ns per segment), %6 hits per query\n")
+				.arg("PreparedLine    ").arg(unpreparedDuration/nPairs).arg(preparedQueryDuration/nPairs)
+				.arg(preparedBothDuration/nPairs).arg(prepareDuration/n).arg(qreal(nPairHits)/(3*nQueries));
+		QTextStream(stdout) << QString("\t\t%1 of %2 prepared results differ from intersects_flsiV2()\n\n")
+				.arg(nPreparedMismatches).arg(2*nPairs);
+	}
+}
+
+/*
+	Each walk starts from a test case of one of the random distributions that are most likely to
+	cause trouble, and runs for an equal share of the evaluations. The walks are independent, so
+	the findings are the same for any number of threads.
+*/
+void Benchmarker::runWorstCaseSearch() const
+{
+	QTextStream(stdout)
+			<< "================="  "\n"
+			<< "Worst-Case Search"  "\n"
+			<< "================="  "\n";
+
+	const int nWalks = 256;
+	const int nEvaluationsPerWalk = qMax(1, m_iterationsPerFunction / nWalks);
+
+	// The best few findings per function are shrunk and printed
+	const int maxFindings = 3;
+
+	const TestCases::Distribution startDistributions[] =
+	{
+		TestCases::NearParallel,
+		TestCases::LargeOffset,
+		TestCases::CollinearOverlapping,
+		TestCases::Uniform
+	};
+	const int nDistributions = int(sizeof(startDistributions) / sizeof(startDistributions[0]));
+	QVector<SegmentPair> starts(nWalks);
+	for (int d = 0; d < nDistributions; ++d)
+	{
+		const auto generator = TestCases::randomGenerator(startDistributions[d], nWalks / nDistributions, m_randomSeed, false);
+		generator->generate(0, int(generator->count()), starts.data() + d * (nWalks / nDistributions));
+	}
+
+	// New presets are numbered after the existing ones
+	int nextPreset = presets.count() + 1;
+	QStringList newPresets;
+
+	QElapsedTimer timer;
+	for (auto objective : {WorstCaseSearch::PointError, WorstCaseSearch::Misclassification})
+	{
+		const QString objectiveName = (objective == WorstCaseSearch::PointError) ? "point error" : "misclassified";
+		QTextStream(stdout) << QString("Objective: %1\n").arg(objectiveName);
+
+		for (const auto& testFunction : testFunctions)
+		{
+			if (!isSelected(testFunction.name))
 				continue;
 
-			QTextStream(stdout)
-					<< QString("\t%1:\tMax diff is %2\n").arg(key).arg(checkMap[key].diff)
-					<< "\t\t" << checkMap[key].printSegmentCoords() << "\n\n";
+			const WorstCaseSearch search(testFunction.directFunc, objective, m_randomSeed);
+			QVector<WorstCaseSearch::Finding> findings(nWalks);
+			QVector<int> nEvaluations(nWalks);
+			timer.start();
+			forEachShard(nWalks, m_threadCount, [&](int walk)
+			{
+				findings[walk] = search.walk(walk, starts[walk], nEvaluationsPerWalk, &nEvaluations[walk]);
+			});
+			const qreal duration = timer.nsecsElapsed();
+			const qreal totalEvaluations = std::accumulate(nEvaluations.begin(), nEvaluations.end(), qreal(0));
+
+			// NOTE: A stable sort keeps ties in walk order, so the report doesn't depend on the threads
+			std::stable_sort(findings.begin(), findings.end(), [](const WorstCaseSearch::Finding& a, const WorstCaseSearch::Finding& b)
+			{
+				return a.score > b.score;
+			});
+
+			QVector<WorstCaseSearch::Finding> reported;
+			for (const auto& finding : findings)
+			{
+				if (reported.count() == maxFindings || !search.isFailure(finding))
+					break;
+
+				const auto shrunk = search.shrink(finding);
+				const bool isDuplicate = std::any_of(reported.begin(), reported.end(), [&](const WorstCaseSearch::Finding& other)
+				{
+					return other.coords == shrunk.coords;
+				});
+				if (!isDuplicate)
+					reported << shrunk;
+			}
+
+			QTextStream(stdout) << QString("\t%1:\t%2 million evaluations per second, %3 of %4 walks failed\n")
+					.arg(testFunction.name).arg(totalEvaluations / duration * 1e3)
+					.arg(std::count_if(findings.begin(), findings.end(), [&](const WorstCaseSearch::Finding& finding)
+					{
+						return search.isFailure(finding);
+					}))
+					.arg(nWalks);
+
+			for (const auto& finding : reported)
+			{
+				const QString description = (objective == WorstCaseSearch::PointError)
+						? QString("%1 ulps").arg(finding.score, 0, 'g', 3)
+						: QString("relations 0x%1 instead of 0x%2").arg(int(finding.relations), 0, 16).arg(int(finding.expectedRelations), 0, 16);
+				QTextStream(stdout) << QString("\t\t%1\n").arg(description);
+
+				newPresets << WorstCaseSearch::toPresetEntry(QString("%1. %2 %3")
+						.arg(nextPreset++, 2, 10, QChar('0')).arg(testFunction.name.trimmed()).arg(objectiveName), finding.coords);
+			}
 		}
+		QTextStream(stdout) << '\n';
 	}
+
+	QTextStream(stdout) << "New presets for tests.h:\n";
+	for (const auto& entry : newPresets)
+		QTextStream(stdout) << '\t' << entry << '\n';
+	QTextStream(stdout) << '\n';
 }
 
+/*
+	Snaps the test cases to a grid of 1/1024 units, so that Grid::intersects() can be compared with
+	the other functions on the same input. The presets show the exactness case by case, and the
+	random categories show it in bulk, along with the speed.
+*/
+void Benchmarker::runGridBenchmarks() const
+{
+	QTextStream(stdout)
+			<< "==============="  "\n"
+			<< "Grid Benchmarks"  "\n"
+			<< "==============="  "\n";
+
+#ifndef GRID_HAVE_INT128
+	QTextStream(stdout) << "Not available: Grid:: needs a 128-bit integer type (GCC or Clang on a 64-bit target)\n";
+#else
+	const qreal gridSize = 1.0 / 1024;
+
+	auto isDegenerate = [](const Grid::Segment& s)
+	{
+		return s.p1.x == s.p2.x && s.p1.y == s.p2.y;
+	};
+
+	QTextStream(stdout) << QString("Presets, snapped to a grid of %1 units:\n").arg(gridSize);
+	for (auto key : presets.keys())
+	{
+		const auto& c = presets[key];
+		Grid::Segment s1, s2;
+		if (   !Grid::toGrid(QLineF(c.l1x1, c.l1y1, c.l1x2, c.l1y2), gridSize, &s1)
+			|| !Grid::toGrid(QLineF(c.l2x1, c.l2y1, c.l2x2, c.l2y2), gridSize, &s2)
+			|| isDegenerate(s1) || isDegenerate(s2) )
+		{
+			QTextStream(stdout) << QString("\t%1: Degenerate on this grid\n").arg(key);
+			continue;
+		}
+
+		const MyLineF l1(Grid::fromGrid(s1, gridSize).p1(), Grid::fromGrid(s1, gridSize).p2());
+		const QLineF l2 = Grid::fromGrid(s2, gridSize);
+
+		Grid::RationalPoint exactPoint;
+		const auto relations = Grid::intersects(s1, s2, &exactPoint);
+		const QPointF point = (relations & MyLineF::LinesIntersect) ? exactPoint.toPointF(gridSize) : QPointF(Q_QNAN, Q_QNAN);
+
+		QPointF refPoint(Q_QNAN, Q_QNAN);
+		QPointF flsiPoint(Q_QNAN, Q_QNAN);
+		const auto refRelations = Reference::intersects(l1, l2, &refPoint);
+		const auto flsiRelations = l1.intersects_flsiV2(l2, &flsiPoint);
+
+		QString line = QString("\t%1: Relations 0x%2 (reference 0x%3, intersects_flsiV2 0x%4)")
+				.arg(key).arg(int(relations), 0, 16).arg(int(refRelations), 0, 16).arg(int(flsiRelations), 0, 16);
+		if (refRelations & MyLineF::LinesIntersect)
+		{
+			line += QString(", point is %1 (intersects_flsiV2: %2 ulps off)")
+					.arg(isSamePoint(point, refPoint) ? QString("the reference") : QString("%1 ulps off").arg(ulpsFrom(point, refPoint)))
+					.arg(ulpsFrom(flsiPoint, refPoint));
+		}
+		QTextStream(stdout) << line << '\n';
+	}
+	QTextStream(stdout) << '\n';
+
+	QElapsedTimer timer;
+	auto benchmarkEnum = QMetaEnum::fromType<Benchmarker::Category>();
+	for (int i = 0; i < benchmarkEnum.keyCount(); ++i)
+	{
+		// ASSUMPTION: Enum values start from 0 and increase by 1
+		const auto category = static_cast<Benchmarker::Category>(i);
+		if (!isSelected(category))
+			continue;
+
+		// Cases that don't fit in the grid, or that snap to a zero-length segment, are skipped
+		QVector<Grid::Segment> segments1, segments2;
+		QVector<SegmentPair> snappedSet;
+		for (const auto& testCase : getTestSet(category))
+		{
+			Grid::Segment s1, s2;
+			if (   !Grid::toGrid(testCase.l1, gridSize, &s1) || !Grid::toGrid(testCase.l2, gridSize, &s2)
+				|| isDegenerate(s1) || isDegenerate(s2) )
+				continue;
+
+			segments1 << s1;
+			segments2 << s2;
+			const QLineF l1 = Grid::fromGrid(s1, gridSize);
+			const QLineF l2 = Grid::fromGrid(s2, gridSize);
+			snappedSet << SegmentPair{MyLineF(l1.p1(), l1.p2()), MyLineF(l2.p1(), l2.p2())};
+		}
+		const int nCases = snappedSet.count();
+		if (nCases == 0)
+			continue;
+
+		// Exactness
+		int nRelationMismatches = 0;
+		int nPointMismatches = 0;
+		int nFlsiMisclassified = 0;
+		for (int j = 0; j < nCases; ++j)
+		{
+			Grid::RationalPoint exactPoint;
+			QPointF refPoint, flsiPoint;
+			const auto relations = Grid::intersects(segments1[j], segments2[j], &exactPoint);
+			const auto refRelations = Reference::intersects(snappedSet[j].l1, snappedSet[j].l2, &refPoint);
+			nRelationMismatches += (relations != refRelations);
+			if ((relations & MyLineF::LinesIntersect) && (refRelations & MyLineF::LinesIntersect))
+				nPointMismatches += !isSamePoint(exactPoint.toPointF(gridSize), refPoint);
+
+			const auto flsiRelations = snappedSet[j].l1.intersects_flsiV2(snappedSet[j].l2, &flsiPoint);
+			nFlsiMisclassified += ((flsiRelations & classificationFlags) != (refRelations & classificationFlags));
+		}
+
+		// Speed, with and without the exact point, on the same snapped cases
+		const int nCalls = qMax(nCases, m_iterationsPerFunction);
+		// NOTE: `call` isn't a std::function, so it can be inlined like the functions in the speed benchmarks
+		auto timeCalls = [&](auto call)
+		{
+			timer.start();
+			for (int j = 0; j < nCalls; ++j)
+				call(j % nCases);
+			return qreal(timer.nsecsElapsed()) / nCalls;
+		};
+		const qreal gridDuration = timeCalls([&](int j)
+		{
+			Grid::RationalPoint exactPoint;
+			Bench::doNotOptimize(Grid::intersects(segments1[j], segments2[j], &exactPoint));
+			Bench::doNotOptimize(exactPoint);
+		});
+		const qreal gridClassifyDuration = timeCalls([&](int j)
+		{
+			Bench::doNotOptimize(Grid::intersects(segments1[j], segments2[j]));
+		});
+		const qreal flsiDuration = timeCalls([&](int j)
+		{
+			QPointF p;
+			Bench::doNotOptimize(snappedSet[j].l1.intersects_flsiV2(snappedSet[j].l2, &p));
+			Bench::doNotOptimize(p);
+		});
+
+		QTextStream(stdout) << benchmarkEnum.valueToKey(category) << QString(": %1 snapped test cases\n").arg(nCases);
+		QTextStream(stdout) << QString("\t%1:\t%2 ns per call (without the point: %3 ns), %4 relations and %5 points differ from the reference\n")
+				.arg("Grid::intersects      ").arg(gridDuration).arg(gridClassifyDuration).arg(nRelationMismatches).arg(nPointMismatches);
+		QTextStream(stdout) << QString("\t%1:\t%2 ns per call, %3 misclassified\n\n")
+				.arg("intersects_flsiV2     ").arg(flsiDuration).arg(nFlsiMisclassified);
+	}
+#endif // GRID_HAVE_INT128
+}
@@ -5,6 +5,13 @@
 
 #include <QMap>
 #include <QMetaObject>
+#include <QStringList>
+#include <QThread>
+
+#include <memory>
+
+class BenchmarkResults;
+class TestCaseGenerator;
 
 struct EndpointCoords
 {
@@ -54,23 +61,82 @@ public:
 		PresetNonParallel,
 		PresetNonParallelSwapped,
 		MonteCarlo,
-		MonteCarloSwapped
+		MonteCarloSwapped,
+		Collinear,
+		Uniform,
+		NearParallel,
+		CollinearOverlapping,
+		LargeOffset,
+		SubEpsilon,
+		Corpus // Replays the file from setCorpusFile(), if any
 	};
 	Q_ENUM(Category)
 
 	void setIterationsPerFunction(int n) { m_iterationsPerFunction = n; }
+	void setSamplesPerFunction(int n) { m_nSamplesPerFunction = n; }
 	void setMonteCarloCaseCount(int n) { m_nMonteCarloCases = n; }
 	void setRandomSeed(uint seed) { m_randomSeed = seed; }
+	void setThreadCount(int n) { m_threadCount = n; }
+	void setPerfCountersEnabled(bool enabled) { m_usePerfCounters = enabled; }
+	void setMaxAllPairsSegmentCount(int n) { m_maxAllPairsSegmentCount = n; }
+	void setCorpusFile(const QString& path) { m_corpusFile = path; }
+
+	// The largest working set of the working-set and quantized benchmarks, in bytes. 0 means 8 times
+	// the last-level cache, up to 1 GiB.
+	void setMaxSweepSize(qint64 bytes) { m_maxSweepSize = bytes; }
+
+	// Restricts the speed, accuracy and batch benchmarks. Empty means everything.
+	void setAlgorithms(const QStringList& names) { m_algorithms = names; }
+	void setCategories(const QVector<Category>& categories) { m_categories = categories; }
+
+	// If set, the speed, accuracy and batch benchmarks also add their results to `results`
+	void setResults(BenchmarkResults* results) { m_results = results; }
+
+	// The names that setAlgorithms() accepts
+	static QStringList algorithmNames();
 
 	void runSpeedBenchmarks() const;
+
+	// Times each function with and without the intersection point, and the classify-only functions
+	void runClassifyBenchmarks() const;
+
+	// Times each function over working sets from L1-resident to larger than the last-level cache
+	void runWorkingSetBenchmarks() const;
+
+	// Compares QuantizedSegments with QVector<SegmentPair> and SegmentArrays on the largest working set
+	void runQuantizedBenchmarks() const;
+
 	void runAccuracyBenchmarks() const;
+	void runBatchBenchmarks() const;
+	void runAllPairsBenchmarks() const;
+	void runOneVsManyBenchmarks() const;
+
+	// Compares Grid::intersects() with the reference and intersects_flsiV2() on snapped test cases
+	void runGridBenchmarks() const;
+
+	// Searches for the segment pairs that each function gets most wrong, and prints them as presets
+	void runWorstCaseSearch() const;
 
 private:
+	std::unique_ptr<TestCaseGenerator> getGenerator(Category category) const;
 	QVector<SegmentPair> getTestSet(Category category) const;
+	int maxSweepCount() const;
+	bool isSelected(Category category) const;
+	bool isSelected(const QString& algorithm) const;
+	void addResult(const QString& benchmark, Category category, const QString& algorithm, const QMap<QString, qreal>& metrics) const;
 
 	int m_iterationsPerFunction = 10000000;
+	int m_nSamplesPerFunction = 100;
 	int m_nMonteCarloCases = 100000;
 	uint m_randomSeed = 1;
+	int m_threadCount = QThread::idealThreadCount();
+	bool m_usePerfCounters = false;
+	int m_maxAllPairsSegmentCount = 128000;
+	qint64 m_maxSweepSize = 0;
+	QString m_corpusFile;
+	QStringList m_algorithms;
+	QVector<Category> m_categories;
+	BenchmarkResults* m_results = nullptr;
 };
 
 #endif // TESTS_H
@@ -0,0 +1,186 @@
+#include "uniformgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+UniformGrid::UniformGrid(const QVector<MyLineF>& segments, qreal cellSize) :
+	m_segments(segments),
+	m_cellSize(cellSize > 0 ? cellSize : autoCellSize(segments)),
+	m_nColumns(1),
+	m_nRows(1)
+{
+	bool first = true;
+	for (const auto& segment : segments)
+	{
+		if (AllPairs::isDegenerate(segment))
+			continue;
+
+		const QRectF box = QRectF(segment.p1(), segment.p2()).normalized();
+		m_bounds = first ? box : m_bounds.united(box);
+		first = false;
+	}
+
+	// Guard against a cell size that is far too small for the data
+	const qreal maxCells = 1 << 26;
+	while ((m_bounds.width()/m_cellSize + 1) * (m_bounds.height()/m_cellSize + 1) > maxCells)
+		m_cellSize *= 2;
+
+	m_nColumns = int(m_bounds.width() / m_cellSize) + 1;
+	m_nRows = int(m_bounds.height() / m_cellSize) + 1;
+
+	// Counting sort: Count the segments in each cell, then place them
+	QVector<int> counts(m_nColumns * m_nRows + 1, 0);
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		if (!AllPairs::isDegenerate(segments[i]))
+			forEachCell(segments[i], [&](int cell) { ++counts[cell]; });
+	}
+
+	m_cellStart.resize(counts.count());
+	int total = 0;
+	for (int cell = 0; cell < counts.count(); ++cell)
+	{
+		m_cellStart[cell] = total;
+		total += counts[cell];
+	}
+	m_cellSegments.resize(total);
+
+	// NOTE: Segments are placed in increasing order, so each cell's indices end up sorted
+	QVector<int> next = m_cellStart;
+	for (int i = 0; i < segments.count(); ++i)
+	{
+		if (!AllPairs::isDegenerate(segments[i]))
+			forEachCell(segments[i], [&](int cell) { m_cellSegments[next[cell]++] = i; });
+	}
+}
+
+qreal UniformGrid::autoCellSize(const QVector<MyLineF>& segments)
+{
+	QVector<qreal> extents;
+	extents.reserve(segments.count());
+	qreal left = std::numeric_limits<qreal>::max(), right = std::numeric_limits<qreal>::lowest();
+	qreal top = left, bottom = right;
+	for (const auto& segment : segments)
+	{
+		if (AllPairs::isDegenerate(segment))
+			continue;
+
+		extents << qMax(qAbs(segment.dx()), qAbs(segment.dy()));
+		left = std::min({left, segment.x1(), segment.x2()});
+		right = std::max({right, segment.x1(), segment.x2()});
+		top = std::min({top, segment.y1(), segment.y2()});
+		bottom = std::max({bottom, segment.y1(), segment.y2()});
+	}
+	if (extents.isEmpty())
+		return 1;
+
+	// The median is not thrown off by a few very long segments
+	auto median = extents.begin() + extents.count()/2;
+	std::nth_element(extents.begin(), median, extents.end());
+
+	// ...but very short segments would create lots of empty cells
+	const qreal minCellSize = std::sqrt((right-left) * (bottom-top) / (4 * extents.count()));
+
+	const qreal cellSize = qMax(*median, minCellSize);
+	return cellSize > 0 ? cellSize : 1;
+}
+
+/*
+	Calls func(cellIndex) once for every cell that the segment passes through.
+
+	This is a DDA traversal that steps along the segment's major axis one column (or row) at a
+	time, and covers the range of cells along the minor axis within each step. The ranges are
+	widened by a small tolerance, so that segments which touch exactly on a cell boundary are
+	binned on both sides of it.
+*/
+template <typename Func>
+void UniformGrid::forEachCell(const QLineF& segment, Func func) const
+{
+	const qreal tolerance = 1e-9; // In units of cells
+
+	// Grid coordinates
+	qreal u1 = (segment.x1() - m_bounds.left()) / m_cellSize;
+	qreal v1 = (segment.y1() - m_bounds.top()) / m_cellSize;
+	qreal u2 = (segment.x2() - m_bounds.left()) / m_cellSize;
+	qreal v2 = (segment.y2() - m_bounds.top()) / m_cellSize;
+
+	// Step along the major axis (u), from low to high
+	const bool steep = qAbs(v2 - v1) > qAbs(u2 - u1);
+	if (steep)
+	{
+		std::swap(u1, v1);
+		std::swap(u2, v2);
+	}
+	if (u1 > u2)
+	{
+		std::swap(u1, u2);
+		std::swap(v1, v2);
+	}
+	const int majorCount = steep ? m_nRows : m_nColumns;
+	const int minorCount = steep ? m_nColumns : m_nRows;
+	const qreal slope = (u2 > u1) ? (v2 - v1) / (u2 - u1) : 0;
+
+	const int firstMajor = qBound(0, int(std::floor(u1 - tolerance)), majorCount-1);
+	const int lastMajor = qBound(0, int(std::floor(u2 + tolerance)), majorCount-1);
+	for (int major = firstMajor; major <= lastMajor; ++major)
+	{
+		// The part of the segment within this column
+		const qreal ua = qBound(u1, qreal(major), u2);
+		const qreal ub = qBound(u1, qreal(major + 1), u2);
+		const qreal va = v1 + (ua - u1) * slope;
+		const qreal vb = v1 + (ub - u1) * slope;
+
+		const int firstMinor = qBound(0, int(std::floor(qMin(va, vb) - tolerance)), minorCount-1);
+		const int lastMinor = qBound(0, int(std::floor(qMax(va, vb) + tolerance)), minorCount-1);
+		for (int minor = firstMinor; minor <= lastMinor; ++minor)
+			func(steep ? major*m_nColumns + minor : minor*m_nColumns + major);
+	}
+}
+
+/*
+	Candidate pairs are deduplicated with "mailboxing": When segment a is tested against segment b,
+	mailbox[b] is set to a, so that b is skipped in all other cells that it shares with a.
+	This only needs one int per segment, instead of a set of all tested pairs.
+*/
+QVector<SegmentIntersection>
+UniformGrid::findAllIntersections(AllPairs::RelationFunc relationFunc, qint64* candidateCount) const
+{
+	QVector<SegmentIntersection> results;
+	QVector<int> mailbox(m_segments.count(), -1);
+	qint64 nCandidates = 0;
+
+	for (int a = 0; a < m_segments.count(); ++a)
+	{
+		if (AllPairs::isDegenerate(m_segments[a]))
+			continue;
+
+		const MyLineF& segmentA = m_segments[a];
+		forEachCell(segmentA, [&](int cell)
+		{
+			// Each cell is sorted, so only the tail holds segments that come after a
+			for (int k = m_cellStart[cell+1] - 1; k >= m_cellStart[cell] && m_cellSegments[k] > a; --k)
+			{
+				const int b = m_cellSegments[k];
+				if (mailbox[b] == a)
+					continue;
+				mailbox[b] = a;
+				++nCandidates;
+
+				QPointF point(Q_QNAN, Q_QNAN);
+				const auto relations = (segmentA.*relationFunc)(m_segments[b], &point);
+				if (relations.testFlag(MyLineF::SegmentsIntersect))
+					results << SegmentIntersection{a, b, relations, point};
+			}
+		});
+	}
+
+	if (candidateCount)
+		*candidateCount = nCandidates;
+	return results;
+}
+
+QVector<SegmentIntersection>
+AllPairs::uniformGrid(const QVector<MyLineF>& segments, RelationFunc relationFunc, qreal cellSize)
+{
+	return UniformGrid(segments, cellSize).findAllIntersections(relationFunc);
+}
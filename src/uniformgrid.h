@@ -0,0 +1,61 @@
+#ifndef UNIFORMGRID_H
+#define UNIFORMGRID_H
+
+#include "allpairs.h"
+
+#include <QRectF>
+
+/*
+	Bins line segments into the cells of a uniform grid that they pass through, so that only
+	segments sharing a cell need to be tested against each other.
+
+	The grid is stored as a flat array of segment indices sorted by cell (each cell's indices are
+	contiguous), so building it doesn't allocate per cell.
+*/
+class UniformGrid
+{
+public:
+	// If cellSize <= 0, it is chosen by autoCellSize()
+	explicit UniformGrid(const QVector<MyLineF>& segments, qreal cellSize = 0);
+
+	// The median of the segments' extents along their major axis, limited to ~4 cells per segment
+	static qreal autoCellSize(const QVector<MyLineF>& segments);
+
+	qreal cellSize() const { return m_cellSize; }
+	int columnCount() const { return m_nColumns; }
+	int rowCount() const { return m_nRows; }
+
+	/*
+		Same output as AllPairs::bruteForce(). If candidateCount is not null, it receives the
+		number of pairs that were passed to relationFunc().
+	*/
+	QVector<SegmentIntersection> findAllIntersections(AllPairs::RelationFunc relationFunc = &MyLineF::intersects_flsiV2,
+			qint64* candidateCount = nullptr) const;
+
+private:
+	template <typename Func>
+	void forEachCell(const QLineF& segment, Func func) const;
+
+	const QVector<MyLineF>& m_segments;
+	QRectF m_bounds;
+	qreal m_cellSize;
+	int m_nColumns;
+	int m_nRows;
+
+	QVector<int> m_cellStart;    // Cell i holds m_cellSegments[m_cellStart[i]] .. m_cellSegments[m_cellStart[i+1]-1]
+	QVector<int> m_cellSegments;
+};
+
+namespace AllPairs
+{
+
+/*
+	Same output as bruteForce(), but only tests pairs of segments that share a cell of a
+	UniformGrid. Best for dense, evenly-spread segments of similar lengths.
+*/
+QVector<SegmentIntersection> uniformGrid(const QVector<MyLineF>& segments,
+		RelationFunc relationFunc = &MyLineF::intersects_flsiV2, qreal cellSize = 0);
+
+}
+
+#endif // UNIFORMGRID_H
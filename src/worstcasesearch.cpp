@@ -0,0 +1,271 @@
+#include "worstcasesearch.h"
+#include "allpairs.h"
+#include "referenceintersection.h"
+
+#include <QStringList>
+
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+const MyLineF::SegmentRelations classificationFlags = MyLineF::SegmentsIntersect | MyLineF::Parallel;
+
+// Point errors smaller than this aren't worth reporting
+const qreal minUlps = 2;
+
+// Mutations are between 2^-1 and 2^-maxStepExponent times the largest coordinate
+const int maxStepExponent = 64;
+
+// Sines below 2^-maxSineExponent score the same, so that a walk can't get stuck at an exactly
+// degenerate pair (e.g. a shared endpoint) that no small mutation improves on
+const qreal maxSineExponent = 64;
+
+// Shrinking keeps at least this fraction of a point error
+const qreal minShrunkFraction = 0.5;
+
+// Counters with this bit set give the extra random bits for mutating every coordinate
+const quint64 secondBlock = quint64(1) << 63;
+
+const qreal infinity = std::numeric_limits<qreal>::infinity();
+
+qreal ulpOf(qreal x)
+{
+	return std::nextafter(x, infinity) - x;
+}
+
+qreal maxMagnitude(const WorstCaseSearch::Coords& coords)
+{
+	qreal magnitude = 0;
+	for (qreal c : coords)
+		magnitude = qMax(magnitude, qAbs(c));
+	return magnitude;
+}
+
+// |a x b| / (|a| |b|), or 1 if either vector is zero (which makes the test meaningless, not degenerate)
+qreal sine(qreal ax, qreal ay, qreal bx, qreal by)
+{
+	const qreal lengths = std::hypot(ax, ay) * std::hypot(bx, by);
+	return lengths > 0 ? qAbs(ax*by - ay*bx) / lengths : 1;
+}
+
+/*
+	-log2() of the smallest sine among the 5 orientation tests that classify a pair: The 2
+	directions, and each endpoint against the other segment. Misclassifications happen where one
+	of them is close to 0, so this guides the walk towards them until it finds one.
+*/
+qreal degeneracy(const WorstCaseSearch::Coords& c)
+{
+	const qreal d1x = c[2] - c[0], d1y = c[3] - c[1];
+	const qreal d2x = c[6] - c[4], d2y = c[7] - c[5];
+	const qreal minSine = qMin(qMin(sine(d1x, d1y, d2x, d2y),
+			qMin(sine(d1x, d1y, c[4] - c[0], c[5] - c[1]), sine(d1x, d1y, c[6] - c[0], c[7] - c[1]))),
+			qMin(sine(d2x, d2y, c[0] - c[4], c[1] - c[5]), sine(d2x, d2y, c[2] - c[4], c[3] - c[5])));
+	return minSine > 0 ? qMin(-std::log2(minSine), maxSineExponent) : maxSineExponent;
+}
+
+// Rounds x to `digits` significant decimal digits
+qreal roundToDigits(qreal x, int digits)
+{
+	return QString::number(x, 'g', digits).toDouble();
+}
+
+// The fewest significant digits that round-trip
+QString shortestString(qreal x)
+{
+	for (int digits = 1; digits < 17; ++digits)
+	{
+		const QString s = QString::number(x, 'g', digits);
+		if (s.toDouble() == x)
+			return s;
+	}
+	return QString::number(x, 'g', 17);
+}
+
+}
+
+WorstCaseSearch::WorstCaseSearch(Function function, Objective objective, uint seed) :
+	m_function(function),
+	m_objective(objective),
+	m_rng(seed)
+{}
+
+WorstCaseSearch::Coords
+WorstCaseSearch::toCoords(const SegmentPair& pair)
+{
+	return Coords{pair.l1.x1(), pair.l1.y1(), pair.l1.x2(), pair.l1.y2(),
+			pair.l2.x1(), pair.l2.y1(), pair.l2.x2(), pair.l2.y2()};
+}
+
+WorstCaseSearch::Finding
+WorstCaseSearch::evaluate(const Coords& coords) const
+{
+	Finding finding;
+	finding.coords = coords;
+	finding.score = -infinity;
+	finding.point = QPointF(Q_QNAN, Q_QNAN);
+	finding.expectedPoint = QPointF(Q_QNAN, Q_QNAN);
+
+	const MyLineF l1(coords[0], coords[1], coords[2], coords[3]);
+	const MyLineF l2(coords[4], coords[5], coords[6], coords[7]);
+
+	// NOTE: A zero-length segment has no direction, so any result is as good as another
+	if (AllPairs::isDegenerate(l1) || AllPairs::isDegenerate(l2))
+		return finding;
+
+	// NOTE: Only the point objective needs the (slower) reference point
+	if (m_objective == PointError)
+		finding.expectedRelations = Reference::intersects(l1, l2, &finding.expectedPoint);
+	else
+		finding.expectedRelations = l1.intersects_adaptive(l2);
+	if (!finding.expectedRelations)
+		return finding; // Invalid input
+
+	finding.relations = MyLineF::SegmentRelations(m_function(&l1, l2, &finding.point));
+
+	switch (m_objective)
+	{
+	case PointError:
+		// Only compare points that both sides say are meaningful
+		if (!finding.relations.testFlag(MyLineF::LinesIntersect) || !finding.expectedRelations.testFlag(MyLineF::LinesIntersect))
+			finding.score = 0;
+		else if (!std::isfinite(finding.point.x()) || !std::isfinite(finding.point.y()))
+			finding.score = infinity;
+		else
+		{
+			/*
+				NOTE: The ulps are those of the largest input or reference coordinate, not of the reference
+				      point itself (unlike in the accuracy benchmarks). Otherwise, a walk could score
+				      billions of "ulps" by moving the point close to the origin, where the ulps are tiny.
+			*/
+			const qreal magnitude = qMax(maxMagnitude(coords),
+					qMax(qAbs(finding.expectedPoint.x()), qAbs(finding.expectedPoint.y())));
+			const qreal error = qMax(qAbs(finding.point.x() - finding.expectedPoint.x()),
+					qAbs(finding.point.y() - finding.expectedPoint.y()));
+			finding.score = error / ulpOf(magnitude);
+		}
+		break;
+
+	case Misclassification:
+		finding.score = ((finding.relations & classificationFlags) != (finding.expectedRelations & classificationFlags))
+				? infinity
+				: degeneracy(coords);
+		break;
+	}
+	return finding;
+}
+
+bool WorstCaseSearch::isFailure(const Finding& finding) const
+{
+	switch (m_objective)
+	{
+	case PointError: return finding.score >= minUlps;
+	case Misclassification: return finding.score == infinity;
+	}
+	return false;
+}
+
+WorstCaseSearch::Finding
+WorstCaseSearch::walk(int walkIndex, const SegmentPair& start, int maxEvaluations, int* nEvaluations) const
+{
+	Finding best = evaluate(toCoords(start));
+	Finding current = best;
+	int i = 0;
+	for (; i < maxEvaluations; ++i)
+	{
+		// NOTE: The walk selects the stream, so that every walk has its own sequence
+		const CounterRng::Block bits = m_rng(quint64(i), quint32(walkIndex));
+
+		// Moves are relative to the size of the pair, so that zeros can move too
+		const qreal magnitude = maxMagnitude(current.coords);
+		const qreal scale = magnitude > 0 ? magnitude : 1;
+
+		Coords coords = current.coords;
+		if (bits[0] % 8 == 0)
+		{
+			// Every coordinate at once, with 16 bits of a second block per step
+			const CounterRng::Block stepBits = m_rng(quint64(i) | secondBlock, quint32(walkIndex));
+			for (int k = 0; k < 8; ++k)
+			{
+				const int exponent = 1 + int((stepBits[k/2] >> (16 * (k%2))) % maxStepExponent);
+				coords[k] += ((bits[1] >> k) & 1) ? std::ldexp(scale, -exponent) : -std::ldexp(scale, -exponent);
+			}
+		}
+		else
+		{
+			const int k = (bits[0] >> 3) % 8;
+			const int exponent = 1 + int(bits[1] % maxStepExponent);
+			coords[k] += (bits[2] & 1) ? std::ldexp(scale, -exponent) : -std::ldexp(scale, -exponent);
+		}
+
+		const Finding mutant = evaluate(coords);
+
+		// Accepting ties lets the walk drift across plateaus, e.g. while the relations are unchanged
+		if (mutant.score >= current.score)
+		{
+			current = mutant;
+			if (mutant.score > best.score)
+				best = mutant;
+		}
+
+		if (m_objective == Misclassification && isFailure(best))
+		{
+			++i;
+			break; // Nothing scores higher
+		}
+	}
+
+	if (nEvaluations)
+		*nEvaluations = i;
+	return best;
+}
+
+WorstCaseSearch::Finding
+WorstCaseSearch::shrink(const Finding& finding) const
+{
+	const auto holds = [&](const Finding& candidate)
+	{
+		if (!isFailure(candidate))
+			return false;
+		return m_objective != PointError || candidate.score >= minShrunkFraction * finding.score;
+	};
+
+	if (!holds(finding))
+		return finding;
+
+	// Rounding one coordinate can allow another one to be rounded, so repeat until nothing changes
+	Finding shrunk = finding;
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (int k = 0; k < 8; ++k)
+		{
+			for (int digits = 0; digits < 17; ++digits)
+			{
+				Coords coords = shrunk.coords;
+				coords[k] = (digits == 0) ? 0 : roundToDigits(coords[k], digits);
+				if (coords[k] == shrunk.coords[k])
+					break; // Already this short
+
+				const Finding candidate = evaluate(coords);
+				if (holds(candidate))
+				{
+					shrunk = candidate;
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+	return shrunk;
+}
+
+QString WorstCaseSearch::toPresetEntry(const QString& name, const Coords& coords)
+{
+	QStringList values;
+	for (qreal c : coords)
+		values << shortestString(c);
+	return QString("{ \"%1\", {%2} },").arg(name, values.join(", "));
+}
@@ -0,0 +1,86 @@
+#ifndef WORSTCASESEARCH_H
+#define WORSTCASESEARCH_H
+
+#include "counterrng.h"
+#include "tests.h"
+
+#include <array>
+
+/*
+	Hunts for segment pairs that one intersection function gets badly wrong, instead of waiting for
+	random test cases to stumble on them.
+
+	Each walk is a (1+1) evolution strategy over the 8 endpoint coordinates: It mutates one or all
+	of them by a random power of 2 (from the size of the pair down to far below its ulps), and keeps
+	the mutant if it scores at least as well. Walk i is a pure function of the seed and i, so walks
+	can run on any thread, in any order. A walk keeps all of its state on the stack, so it never
+	allocates.
+
+	Findings are shrunk afterwards: Each coordinate is rounded to as few significant digits as
+	possible while the finding still holds, so that it can be read (and pasted into `presets`).
+*/
+class WorstCaseSearch
+{
+public:
+	enum Objective
+	{
+		// Maximises the distance between the function's point and Reference::intersects()
+		PointError,
+
+		// Finds pairs whose SegmentsIntersect or Parallel flag differs from intersects_adaptive()
+		Misclassification
+	};
+
+	// Same as DirectIntersectionFunc in tests.cpp: The result is always SegmentRelations
+	typedef int (*Function)(const MyLineF* l1, const MyLineF& l2, QPointF* intersectionPoint);
+
+	typedef std::array<qreal, 8> Coords; // In the same order as EndpointCoords
+
+	struct Finding
+	{
+		Coords coords;
+
+		/*
+			PointError: The point's error in ulps of the largest coordinate or reference coordinate.
+			            Infinite if the function's point isn't finite.
+			Misclassification: Infinite if misclassified; otherwise -log2() of the smallest sine among
+			            the orientation tests, which grows as the pair approaches a degenerate case.
+			Invalid input, including zero-length segments, scores -Inf.
+		*/
+		qreal score;
+
+		MyLineF::SegmentRelations relations;
+		MyLineF::SegmentRelations expectedRelations;
+		QPointF point;
+		QPointF expectedPoint;
+	};
+
+	WorstCaseSearch(Function function, Objective objective, uint seed);
+
+	/*
+		Runs walk number `walkIndex` from `start` for up to maxEvaluations, and returns the best pair that it
+		found. A Misclassification walk stops at its first failure. If nEvaluations isn't null, it is
+		set to the number of mutants that were evaluated.
+	*/
+	Finding walk(int walkIndex, const SegmentPair& start, int maxEvaluations, int* nEvaluations = nullptr) const;
+
+	// Rounds the coordinates to as few digits as possible while isFailure() still holds
+	Finding shrink(const Finding& finding) const;
+
+	// PointError: At least 2 ulps (smaller errors aren't worth reporting). Misclassification: Misclassified.
+	bool isFailure(const Finding& finding) const;
+
+	Finding evaluate(const Coords& coords) const;
+
+	static Coords toCoords(const SegmentPair& pair);
+
+	// e.g. `{ "14. Name", {1.5, 2, ...} },` with every coordinate in its shortest round-trip form
+	static QString toPresetEntry(const QString& name, const Coords& coords);
+
+private:
+	Function m_function;
+	Objective m_objective;
+	CounterRng m_rng;
+};
+
+#endif // WORSTCASESEARCH_H
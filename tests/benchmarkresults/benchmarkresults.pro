@@ -0,0 +1,16 @@
+QT += testlib
+QT -= gui
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_benchmarkresults
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    ../../src/benchmarkresults.cpp \
+    tst_benchmarkresults.cpp
+
+HEADERS += \
+    ../../src/benchmarkresults.h
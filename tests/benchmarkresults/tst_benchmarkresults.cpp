@@ -0,0 +1,209 @@
+#include "benchmarkresults.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <limits>
+
+Q_DECLARE_METATYPE(BenchmarkRecord)
+
+class TestBenchmarkResults : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void roundTrip();
+	void nonFiniteMetrics();
+	void nullMetricsAreSkipped();
+	void worseRecordIsRegression();
+	void missingRecordIsRegression();
+	void leftOutRecordIsNotRegression_data();
+	void leftOutRecordIsNotRegression();
+
+private:
+	// Saves `results` as JSON, and loads them back
+	BenchmarkResults reloaded(const BenchmarkResults& results);
+
+	QTemporaryDir m_dir;
+};
+
+static BenchmarkRecord
+makeRecord(const QString& algorithm, const QMap<QString, qreal>& metrics,
+		const QString& benchmark = "accuracy", const QString& category = "Uniform")
+{
+	return BenchmarkRecord{benchmark, category, algorithm, metrics};
+}
+
+static void
+compareRecords(const QVector<BenchmarkRecord>& actual, const QVector<BenchmarkRecord>& expected)
+{
+	QCOMPARE(actual.count(), expected.count());
+	for (int i = 0; i < actual.count(); ++i)
+	{
+		QCOMPARE(actual[i].benchmark, expected[i].benchmark);
+		QCOMPARE(actual[i].category, expected[i].category);
+		QCOMPARE(actual[i].algorithm, expected[i].algorithm);
+		QCOMPARE(actual[i].metrics, expected[i].metrics);
+	}
+}
+
+BenchmarkResults
+TestBenchmarkResults::reloaded(const BenchmarkResults& results)
+{
+	const QString path = m_dir.filePath("results.json");
+	QString errorString;
+	BenchmarkResults loaded;
+	if (!results.save(path, BenchmarkResults::Json, &errorString))
+		qWarning() << errorString;
+	else if (!loaded.load(path, &errorString))
+		qWarning() << errorString;
+	return loaded;
+}
+
+void
+TestBenchmarkResults::roundTrip()
+{
+	BenchmarkResults results;
+	results.setConfig("seed", "1");
+	results.setConfig("algorithms", "");
+	results.add(makeRecord("intersects_flsiV2", {{"max_ulps", 0.5}, {"misclassified", 3}}));
+	results.add(makeRecord("intersects_gaussElim", {{"ns_median", 12.345678901234567}}, "speed", "NearParallel"));
+
+	const BenchmarkResults loaded = reloaded(results);
+	QCOMPARE(loaded.config(), results.config());
+	compareRecords(loaded.records(), results.records());
+	QVERIFY(loaded.regressionsFrom(results, BenchmarkResults::Thresholds()).isEmpty());
+}
+
+void
+TestBenchmarkResults::nonFiniteMetrics()
+{
+	const qreal max = std::numeric_limits<qreal>::max();
+
+	BenchmarkResults results;
+	results.add(makeRecord("flsiV2 float32 (raw)",
+	{
+		{"max_ulps", std::numeric_limits<qreal>::infinity()},
+		{"min", -std::numeric_limits<qreal>::infinity()},
+		{"max_diff", std::numeric_limits<qreal>::quiet_NaN()}
+	}));
+
+	// Clamped and dropped when added, not only when saved
+	const QMap<QString, qreal> expected{{"max_ulps", max}, {"min", -max}};
+	QCOMPARE(results.records().first().metrics, expected);
+
+	const BenchmarkResults loaded = reloaded(results);
+	compareRecords(loaded.records(), results.records());
+
+	// The same infinite error again is no regression from the saved baseline
+	QVERIFY(results.regressionsFrom(loaded, BenchmarkResults::Thresholds()).isEmpty());
+}
+
+void
+TestBenchmarkResults::nullMetricsAreSkipped()
+{
+	// As written for infinities before they were clamped
+	const QString path = m_dir.filePath("null.json");
+	QFile file(path);
+	QVERIFY(file.open(QIODevice::WriteOnly));
+	file.write(R"({
+		"format": "QTBUG-75146-Study benchmark results",
+		"version": 1,
+		"config": {},
+		"results": [
+			{"benchmark": "accuracy", "category": "Uniform", "algorithm": "intersects_flsiV2",
+			 "metrics": {"max_ulps": null, "misclassified": 2}}
+		]
+	})");
+	file.close();
+
+	BenchmarkResults baseline;
+	QString errorString;
+	QVERIFY2(baseline.load(path, &errorString), qPrintable(errorString));
+	const QMap<QString, qreal> expected{{"misclassified", 2}};
+	QCOMPARE(baseline.records().first().metrics, expected);
+
+	// Not a regression from 0 ulps
+	BenchmarkResults results;
+	results.add(makeRecord("intersects_flsiV2", {{"max_ulps", 1e300}, {"misclassified", 2}}));
+	QVERIFY(results.regressionsFrom(baseline, BenchmarkResults::Thresholds()).isEmpty());
+}
+
+void
+TestBenchmarkResults::worseRecordIsRegression()
+{
+	BenchmarkResults baseline;
+	baseline.add(makeRecord("intersects_flsiV2", {{"max_ulps", 1}, {"misclassified", 0}}));
+	baseline.add(makeRecord("intersects_flsiV2", {{"ns_median", 10}}, "speed"));
+
+	BenchmarkResults results;
+	results.add(makeRecord("intersects_flsiV2", {{"max_ulps", 2}, {"misclassified", 0}}));
+	results.add(makeRecord("intersects_flsiV2", {{"ns_median", 10.5}}, "speed"));
+
+	BenchmarkResults::Thresholds thresholds;
+	thresholds.maxSlowdown = 0.1;
+	const QStringList regressions = results.regressionsFrom(reloaded(baseline), thresholds);
+	QCOMPARE(regressions.count(), 1);
+	QVERIFY(regressions.first().contains("max_ulps"));
+}
+
+void
+TestBenchmarkResults::missingRecordIsRegression()
+{
+	BenchmarkResults baseline;
+	baseline.add(makeRecord("intersects_flsiV2", {{"max_ulps", 1}}));
+	baseline.add(makeRecord("intersects_hybrid", {{"max_ulps", 1}}));
+	baseline.add(makeRecord("intersects_flsiV2", {{"max_ulps", 1}}, "accuracy", "LargeOffset"));
+
+	// Everything selected, but 1 function (e.g. renamed) and 1 category (e.g. crashed) are gone
+	BenchmarkResults results;
+	results.setConfig("benchmark", "accuracy");
+	results.setConfig("algorithms", "");
+	results.setConfig("categories", "");
+	results.add(makeRecord("intersects_flsiV2", {{"max_ulps", 1}}));
+	results.add(makeRecord("intersects_hybrid2", {{"max_ulps", 1}}));
+
+	const QStringList regressions = results.regressionsFrom(reloaded(baseline), BenchmarkResults::Thresholds());
+	QCOMPARE(regressions.count(), 2);
+	QVERIFY(regressions.filter("accuracy/Uniform/intersects_hybrid: missing").count() == 1);
+	QVERIFY(regressions.filter("accuracy/LargeOffset/intersects_flsiV2: missing").count() == 1);
+}
+
+void
+TestBenchmarkResults::leftOutRecordIsNotRegression_data()
+{
+	QTest::addColumn<QString>("configKey");
+	QTest::addColumn<QString>("configValue");
+	QTest::addColumn<BenchmarkRecord>("record");
+
+	QTest::newRow("benchmark") << "benchmark" << "speed,batch" << makeRecord("intersects_hybrid", {{"max_ulps", 1}});
+	QTest::newRow("category") << "categories" << "Uniform" << makeRecord("intersects_flsiV2", {{"max_ulps", 1}}, "accuracy", "LargeOffset");
+	QTest::newRow("algorithm") << "algorithms" << "intersects_flsiV2" << makeRecord("intersects_hybrid", {{"max_ulps", 1}});
+	QTest::newRow("derived algorithm") << "algorithms" << "intersects_gaussElim" << makeRecord("intersects_flsiV2 @ 16 KiB", {{"ns_median", 1}}, "workingset");
+}
+
+void
+TestBenchmarkResults::leftOutRecordIsNotRegression()
+{
+	QFETCH(QString, configKey);
+	QFETCH(QString, configValue);
+	QFETCH(BenchmarkRecord, record);
+
+	BenchmarkResults baseline;
+	baseline.add(record);
+
+	BenchmarkResults results;
+	results.setConfig(configKey, configValue);
+	QVERIFY(results.regressionsFrom(reloaded(baseline), BenchmarkResults::Thresholds()).isEmpty());
+
+	// ...but it is missing if it was selected
+	BenchmarkResults selected;
+	selected.setConfig(configKey, QString("%1,%2").arg(configValue)
+			.arg(configKey == "benchmark" ? record.benchmark : configKey == "categories" ? record.category : record.algorithm));
+	QCOMPARE(selected.regressionsFrom(baseline, BenchmarkResults::Thresholds()).count(), 1);
+}
+
+QTEST_APPLESS_MAIN(TestBenchmarkResults)
+
+#include "tst_benchmarkresults.moc"
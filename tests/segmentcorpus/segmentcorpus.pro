@@ -0,0 +1,16 @@
+QT += testlib
+QT -= gui
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_segmentcorpus
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    ../../src/segmentcorpus.cpp \
+    tst_segmentcorpus.cpp
+
+HEADERS += \
+    ../../src/segmentcorpus.h
@@ -0,0 +1,192 @@
+#include "segmentcorpus.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+Q_DECLARE_METATYPE(SegmentCorpus::Contents)
+
+class TestSegmentCorpus : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void roundTrip_data();
+	void roundTrip();
+	void truncatedFile_data();
+	void truncatedFile();
+	void corruptCount_data();
+	void corruptCount();
+
+private:
+	// Writes `pairs` (with relations and points) to a new file, and returns its path
+	QString writeCorpus(const QString& name, SegmentCorpus::Contents contents);
+
+	QTemporaryDir m_dir;
+};
+
+// Exactly representable or not, the coordinates must come back bit for bit
+static const SegmentPair pairs[] =
+{
+	{ MyLineF(1.0, 1.0, 5.0, 5.0), MyLineF(0.0, 4.0, 5.0, 4.0) },
+	{ MyLineF(0.1, -0.2, 1.0/3, 2.0/3), MyLineF(-1e300, 1e-300, 1e300, -1e-300) },
+	{ MyLineF(1.0, 1.0, 3.0, 4.0), MyLineF(5.0, 6.0, 7.0, 9.0) }
+};
+static const int pairCount = int(sizeof(pairs) / sizeof(pairs[0]));
+
+static const MyLineF::SegmentRelations relations[pairCount] =
+{
+	MyLineF::LinesIntersect | MyLineF::SegmentsIntersect,
+	MyLineF::LinesIntersect,
+	MyLineF::Parallel
+};
+
+// The last pair has no point, so the Writer's NaN default is recorded
+static const QPointF points[pairCount - 1] = { QPointF(4.0, 4.0), QPointF(0.1, 1.0/3) };
+
+static bool
+isSamePair(const SegmentPair& a, const SegmentPair& b)
+{
+	// NOTE: Not QLineF::operator==(), which is fuzzy
+	return std::memcmp(&a, &b, sizeof(SegmentPair)) == 0;
+}
+
+QString
+TestSegmentCorpus::writeCorpus(const QString& name, SegmentCorpus::Contents contents)
+{
+	const QString path = m_dir.filePath(name);
+	SegmentCorpus::Writer writer;
+	if (!writer.open(path, contents))
+		qWarning() << writer.errorString();
+	for (int i = 0; i < pairCount; ++i)
+	{
+		if (i < pairCount - 1)
+			writer.append(pairs[i], relations[i], points[i]);
+		else
+			writer.append(pairs[i], relations[i]);
+	}
+	if (!writer.close())
+		qWarning() << writer.errorString();
+	return path;
+}
+
+void
+TestSegmentCorpus::roundTrip_data()
+{
+	QTest::addColumn<SegmentCorpus::Contents>("contents");
+
+	QTest::newRow("pairs only") << SegmentCorpus::Contents(SegmentCorpus::PairsOnly);
+	QTest::newRow("relations") << SegmentCorpus::Contents(SegmentCorpus::ExpectedRelations);
+	QTest::newRow("points") << SegmentCorpus::Contents(SegmentCorpus::ExpectedPoints);
+	QTest::newRow("relations and points") << (SegmentCorpus::ExpectedRelations | SegmentCorpus::ExpectedPoints);
+}
+
+void
+TestSegmentCorpus::roundTrip()
+{
+	QFETCH(SegmentCorpus::Contents, contents);
+
+	const QString path = writeCorpus("roundtrip.qsegpair", contents);
+
+	SegmentCorpus::Reader reader;
+	QVERIFY2(reader.open(path), qPrintable(reader.errorString()));
+	QCOMPARE(reader.count(), qint64(pairCount));
+	QCOMPARE(int(reader.contents()), int(contents));
+
+	QVERIFY(reader.pairs());
+	for (int i = 0; i < pairCount; ++i)
+		QVERIFY2(isSamePair(reader.pairs()[i], pairs[i]), qPrintable(QString("pair %1").arg(i)));
+
+	if (contents & SegmentCorpus::ExpectedPoints)
+	{
+		QVERIFY(reader.expectedPoints());
+		for (int i = 0; i < pairCount - 1; ++i)
+		{
+			QVERIFY(reader.expectedPoints()[i].x() == points[i].x());
+			QVERIFY(reader.expectedPoints()[i].y() == points[i].y());
+		}
+		QVERIFY(qIsNaN(reader.expectedPoints()[pairCount - 1].x()));
+		QVERIFY(qIsNaN(reader.expectedPoints()[pairCount - 1].y()));
+	}
+	else
+	{
+		QVERIFY(!reader.expectedPoints());
+	}
+
+	if (contents & SegmentCorpus::ExpectedRelations)
+	{
+		QVERIFY(reader.expectedRelations());
+		for (int i = 0; i < pairCount; ++i)
+			QCOMPARE(int(reader.expectedRelations()[i]), int(relations[i]));
+	}
+	else
+	{
+		QVERIFY(!reader.expectedRelations());
+	}
+}
+
+void
+TestSegmentCorpus::truncatedFile_data()
+{
+	QTest::addColumn<SegmentCorpus::Contents>("contents");
+	QTest::addColumn<int>("chopped");
+
+	// Only the size check can catch a short last section; a missing pair also fails the count check
+	QTest::newRow("last byte") << (SegmentCorpus::ExpectedRelations | SegmentCorpus::ExpectedPoints) << 1;
+	QTest::newRow("last point") << SegmentCorpus::Contents(SegmentCorpus::ExpectedPoints) << int(sizeof(QPointF));
+	QTest::newRow("last pair") << SegmentCorpus::Contents(SegmentCorpus::PairsOnly) << int(sizeof(SegmentPair));
+}
+
+void
+TestSegmentCorpus::truncatedFile()
+{
+	QFETCH(SegmentCorpus::Contents, contents);
+	QFETCH(int, chopped);
+
+	const QString path = writeCorpus("truncated.qsegpair", contents);
+	QFile file(path);
+	QVERIFY(file.resize(file.size() - chopped));
+
+	SegmentCorpus::Reader reader;
+	QVERIFY(!reader.open(path));
+	QVERIFY2(reader.errorString().contains("is truncated or corrupt"), qPrintable(reader.errorString()));
+	QCOMPARE(reader.count(), qint64(0));
+	QVERIFY(!reader.pairs());
+}
+
+void
+TestSegmentCorpus::corruptCount_data()
+{
+	QTest::addColumn<quint64>("count");
+
+	QTest::newRow("one too many") << quint64(pairCount + 1);
+	QTest::newRow("overflows the size") << (quint64(1) << 62);
+	QTest::newRow("max") << std::numeric_limits<quint64>::max();
+}
+
+void
+TestSegmentCorpus::corruptCount()
+{
+	QFETCH(quint64, count);
+
+	const QString path = writeCorpus("corrupt.qsegpair", SegmentCorpus::ExpectedRelations | SegmentCorpus::ExpectedPoints);
+	QFile file(path);
+	QVERIFY(file.open(QIODevice::ReadWrite));
+	QVERIFY(file.seek(offsetof(SegmentCorpus::Header, count)));
+	QCOMPARE(file.write(reinterpret_cast<const char*>(&count), sizeof(count)), qint64(sizeof(count)));
+	file.close();
+
+	SegmentCorpus::Reader reader;
+	QVERIFY(!reader.open(path));
+	QVERIFY2(reader.errorString().contains("is truncated or corrupt"), qPrintable(reader.errorString()));
+	QCOMPARE(reader.count(), qint64(0));
+	QVERIFY(!reader.pairs());
+}
+
+QTEST_APPLESS_MAIN(TestSegmentCorpus)
+
+#include "tst_segmentcorpus.moc"